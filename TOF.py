@@ -1,8 +1,11 @@
 #!/usr/bin/env python3
 import argparse
+import queue
+import struct
 import time
 import signal
 import sys
+import threading
 
 try:
     import VL53L1X
@@ -13,6 +16,76 @@ except ImportError:
 
 stop = False
 
+# Binary sample record v1 (see hw/tof_frame.h). Little-endian, 24 bytes.
+FRAME_MAGIC = b"\xa5\x5a"
+FRAME_VERSION = 1
+FRAME_BODY = struct.Struct("<2sBBHhQBBHH")
+FRAME_SIZE = FRAME_BODY.size + 2
+
+
+def crc16_ccitt(data: bytes) -> int:
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+class FrameWriter:
+    def __init__(self):
+        self.seq = 0
+        self.out = sys.stdout.buffer
+
+    def write(self, distance_mm: int, status: int = 0, signal_kcps: int = 0, ambient_kcps: int = 0):
+        body = FRAME_BODY.pack(
+            FRAME_MAGIC,
+            FRAME_VERSION,
+            FRAME_SIZE,
+            self.seq,
+            max(-1, min(int(distance_mm), 0x7FFF)),
+            time.monotonic_ns(),
+            status & 0xFF,
+            0,
+            max(0, min(signal_kcps // 8, 0xFFFF)),
+            max(0, min(ambient_kcps // 8, 0xFFFF)),
+        )
+        self.out.write(body + struct.pack("<H", crc16_ccitt(body)))
+        self.out.flush()
+        self.seq = (self.seq + 1) & 0xFFFF
+
+
+# Ranging profile: "<short|long> <budget ms> <inter-measurement ms>".
+# Given with --profile and/or as "profile ..." lines on stdin while running.
+RANGING_MODES = {"short": 1, "long": 3}
+
+
+def parse_profile(text: str):
+    mode, budget_ms, inter_ms = text.split()
+    if mode not in RANGING_MODES:
+        raise ValueError(f"invalid ranging mode: {mode}")
+    budget_ms = int(budget_ms)
+    return RANGING_MODES[mode], budget_ms, max(budget_ms, int(inter_ms))
+
+
+def apply_profile(tof, profile, restart: bool):
+    mode, budget_ms, inter_ms = profile
+    if restart:
+        tof.stop_ranging()
+    tof.start_ranging(mode)
+    tof.set_timing(budget_ms * 1000, inter_ms)  # budget(us), inter-measure(ms)
+
+
+def read_commands(commands: "queue.Queue"):
+    for line in sys.stdin:
+        parts = line.split(None, 1)
+        if len(parts) == 2 and parts[0] == "profile":
+            try:
+                commands.put(parse_profile(parts[1]))
+            except ValueError as e:
+                print(f"ERR: invalid profile: {e}", file=sys.stderr, flush=True)
+
 
 def _handle_sigint(signum, frame):
     global stop
@@ -25,6 +98,10 @@ def parse_args():
     ap.add_argument("--addr", default="0x29", help="I2C address (hex e.g. 0x29)")
     ap.add_argument("--interval", type=float, default=0.5, help="Polling interval seconds")
     ap.add_argument("--duration", type=float, default=0.0, help="Total duration seconds (0=infinite)")
+    ap.add_argument("--format", choices=("text", "binary"), default="text",
+                    help="text: 숫자 한 줄씩 / binary: 고정 크기 프레임 (hw/tof_frame.h)")
+    ap.add_argument("--profile", default=None,
+                    help="'<short|long> <budget ms> <inter ms>'; 센서 주기로 동작하며 stdin 으로 변경 가능")
     return ap.parse_args()
 
 
@@ -42,6 +119,7 @@ def main():
     try:
         bus_no = parse_bus(args.bus)
         addr = int(args.addr, 0)
+        profile = parse_profile(args.profile) if args.profile else None
     except Exception as e:
         print(f"ERR: invalid args: {e}", file=sys.stderr)
         return 2
@@ -50,29 +128,51 @@ def main():
     tof.open()
 
     # Ranging 설정
-    tof.start_ranging(1)  # 0=Unchanged, 1=Short, 2=Medium, 3=Long
-    tof.set_timing(33000, 50)  # budget(us), inter-measure(ms)
+    interval = args.interval
+    commands = None
+    if profile:
+        apply_profile(tof, profile, restart=False)
+        # get_distance() blocks until the sensor's next measurement, so the
+        # profile's inter-measurement period paces the loop.
+        interval = 0.0
+        commands = queue.Queue()
+        threading.Thread(target=read_commands, args=(commands,), daemon=True).start()
+    else:
+        tof.start_ranging(1)  # 0=Unchanged, 1=Short, 2=Medium, 3=Long
+        tof.set_timing(33000, 50)  # budget(us), inter-measure(ms)
 
     signal.signal(signal.SIGINT, _handle_sigint)
     signal.signal(signal.SIGTERM, _handle_sigint)
 
+    writer = FrameWriter() if args.format == "binary" else None
+
     start = time.time()
     try:
         while not stop:
+            while commands is not None and not commands.empty():
+                try:
+                    apply_profile(tof, commands.get_nowait(), restart=True)
+                except Exception as e:
+                    print(f"ERR: profile change failed: {e}", file=sys.stderr, flush=True)
+
             try:
                 result = tof.get_distance()  # blocking
             except Exception as e:
                 print(f"ERR: read failed: {e}", file=sys.stderr, flush=True)
-                time.sleep(args.interval)
+                time.sleep(max(interval, 0.05))
                 continue
 
-            print(result, flush=True)  # 숫자만 출력
+            if writer:
+                writer.write(result, status=0 if result > 0 else 255)
+            else:
+                print(result, flush=True)  # 숫자만 출력
 
             # 0은 유효하지 않은 측정일 수 있으니 계속 시도
             if args.duration > 0 and (time.time() - start) >= args.duration:
                 break
 
-            time.sleep(args.interval)
+            if interval > 0:
+                time.sleep(interval)
     except KeyboardInterrupt:
         pass
     finally:
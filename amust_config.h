@@ -6,15 +6,78 @@ namespace AmustConfig {
 inline constexpr int kTofMinMm = 100;
 inline constexpr int kTofMaxMm = 120;
 
-// ToF simulation clamp (placeholder until real sensor wired)
+// ToF simulation: range of the synthetic sweep (AMUST_TOF_REPLAY=sim)
 inline constexpr int kTofSimMinMm = 100;
 inline constexpr int kTofSimMaxMm = 350;
 
-// ToF sensor reader (v0.1.0 compatible; runs `python3 TOF.py`)
+// ToF sensor reader (in-process VL53L1X driver; `python3 TOF.py` as fallback)
 // Enable with env: AMUST_ENABLE_TOF=1
+// Backend with env: AMUST_TOF_BACKEND=auto|native|python (AMUST_TOF_BUS=fake for no hardware)
 inline constexpr bool kTofEnableByDefault = false;
 inline constexpr double kTofPollIntervalSeconds = 0.5;
 
+// ToF backend supervision (restart on failed open, crash or hang)
+inline constexpr int kTofFirstSampleTimeoutMs = 5000; // open -> first sample (TOF.py start-up)
+inline constexpr int kTofHeartbeatTimeoutMs = 2000;   // max gap between samples (>= 4 periods)
+inline constexpr int kTofRestartBackoffMinMs = 500;
+inline constexpr int kTofRestartBackoffMaxMs = 30'000;
+// How long stop() blocks the GUI for the acquisition thread; a backend
+// stuck in a blocking transport read is left to finish on its own.
+inline constexpr int kTofStopTimeoutMs = 500;
+
+// ToF ranging profiles, switched at runtime (TofSensorController::setRangingProfile)
+// Idle: long mode, low rate while nobody is near. Active: short mode, back-to-back
+// ranging while the operator positions the target or an exposure runs.
+inline constexpr int kTofIdleTimingBudgetMs = 100;
+inline constexpr int kTofIdleIntervalMs = 250;
+inline constexpr int kTofActiveTimingBudgetMs = 20;
+inline constexpr int kTofActiveIntervalMs = 20;
+inline constexpr int kTofPositioningMaxMm = 300; // target nearer than this -> active
+inline constexpr int kTofIdleAfterMs = 3000;     // no near target for this long -> idle
+
+// VL53L1X GPIO1 (data ready) input on kGpioChipName; -1 = always poll.
+// Mode with env: AMUST_TOF_DRDY=auto|gpio|sim|off (sim injects edges in software)
+// GPIO1 is open-drain and needs a pull-up; the driver programs it active low.
+inline constexpr int kTofGpio1Line = 4;
+
+// ToF sensor array for distance + tilt. A single entry keeps the one-sensor
+// setup. Each sensor is either given its own address at boot by pulsing its
+// XSHUT line (xshutLine >= 0; it boots at 0x29) or sits behind a TCA9548A
+// (kTofMuxAddress != 0, muxChannel 0..7). Position is relative to the head's
+// centre. Sensors sharing a crosstalk group never range at the same time;
+// separate groups (non-overlapping fields of view) range concurrently.
+struct TofArraySensor {
+  int address;
+  int xshutLine;
+  int muxChannel;
+  double xMm;
+  double yMm;
+  int crosstalkGroup;
+};
+inline constexpr TofArraySensor kTofArray[] = {
+    {0x29, -1, -1, 0.0, 0.0, 0},
+    // e.g. three sensors on a 30 mm circle, re-addressed via XSHUT:
+    // {0x30, 5, -1, 0.0, 30.0, 0},
+    // {0x31, 6, -1, -26.0, -15.0, 0},
+    // {0x32, 13, -1, 26.0, -15.0, 0},
+};
+inline constexpr int kTofArraySize = static_cast<int>(sizeof(kTofArray) / sizeof(kTofArray[0]));
+inline constexpr int kTofMuxAddress = 0; // 0x70 when a TCA9548A is fitted
+inline constexpr double kTofMaxTiltDeg = 5.0;
+
+// ToF ROI scan: single sensor sweeps its SPAD ROI over a coarse grid (max 4x4).
+// Enable with env AMUST_TOF_SCAN=1 (or CxR, e.g. 4x2).
+inline constexpr int kTofScanColumns = 4;
+inline constexpr int kTofScanRows = 4;
+
+// ToF filtering (runs per sample on the acquisition thread)
+inline constexpr int kTofMedianWindow = 5;       // samples, rolling median
+inline constexpr bool kTofTrackerEnabled = true; // alpha-beta after the median
+inline constexpr double kTofTrackerAlpha = 0.5;
+inline constexpr double kTofTrackerBeta = 0.05;
+inline constexpr int kTofHysteresisMm = 3;       // guidance window edge hysteresis
+inline constexpr int kTofMaxHeldSamples = 5;     // invalid samples bridged before "no target"
+
 // Output time defaults / limits
 inline constexpr int kOutputDefaultMs = 300'000; // 5 minutes
 inline constexpr int kOutputMinMs = 10'000;      // 10 seconds
@@ -28,4 +91,56 @@ inline constexpr int kGpioLed2Line = 17;
 inline constexpr int kGpioLaserLine = 17;
 inline constexpr int kGpioXrayEnableLine = 27;
 
+// Optional MCP23017/PCA9555 output expander (AMUST_GPIO_BACKEND=expander, or
+// auto when fitted). Its pins are numbered 0..15: port A/0 = 0..7, port B/1 =
+// 8..15; each output gets its own pin there. -1 bus = not fitted; override
+// with AMUST_GPIO_EXPANDER_BUS=N|/dev/i2c-N|fake.
+inline constexpr int kGpioExpanderBus = -1;
+inline constexpr int kGpioExpanderAddress = 0x20;
+inline constexpr bool kGpioExpanderPca9555 = false; // false = MCP23017
+inline constexpr int kGpioExpanderLaserPin = 0;
+inline constexpr int kGpioExpanderLed1Pin = 1;
+inline constexpr int kGpioExpanderLed2Pin = 2;
+inline constexpr int kGpioExpanderXrayEnablePin = 3;
+
+// GPIO inputs on kGpioChipName, watched by the GPIO thread; -1 = not fitted.
+// Interlock is asserted while its circuit is open; either it or the e-stop
+// ends an exposure at once. The footswitch acts as START / RESUME.
+inline constexpr int kGpioInterlockLine = -1;
+inline constexpr bool kGpioInterlockActiveLow = false; // open circuit reads high
+inline constexpr int kGpioEstopLine = -1;
+inline constexpr bool kGpioEstopActiveLow = true;
+inline constexpr int kGpioFootswitchLine = -1;
+inline constexpr bool kGpioFootswitchActiveLow = true;
+inline constexpr int kGpioInputDebounceUs = 5'000;
+
+// PWM on the laser / LED outputs (GpioOutputThread::setPwm). An output with a
+// kernel PWM channel (/sys/class/pwm/pwmchipN/pwmM; chip -1 = none) is driven
+// by the PWM peripheral and no longer by its GPIO line; the others are
+// modulated in software by the GPIO thread, no faster than kPwmSoftMinPeriodUs.
+// None is mapped here; AMUST_PWM_CHANNELS=laser=N:M,led1=N:M,led2=N:M
+// replaces the mapping, and AMUST_PWM_SYSFS=<dir> replaces /sys/class/pwm
+// (mock trees for testing).
+struct PwmChannelConfig {
+  int chip;
+  int channel;
+};
+inline constexpr PwmChannelConfig kPwmLaser = {-1, 0};
+inline constexpr PwmChannelConfig kPwmLed1 = {-1, 0};
+inline constexpr PwmChannelConfig kPwmLed2 = {-1, 0};
+inline constexpr int kPwmDefaultPeriodUs = 1'000; // hardware channels while steady
+inline constexpr int kPwmSoftMinPeriodUs = 1'000;
+
+// UI frame scheduler: all periodic widget work (animation, clock, status
+// polling) is batched into at most one wakeup per frame, and none at all
+// while no visible widget has anything subscribed.
+inline constexpr int kUiFramePeriodMs = 16;
+inline constexpr int kUiTickIntervalMs = 50; // main menu status / input polling
+
+// GPIO output thread: SCHED_FIFO priority (1..99; 0 = normal scheduling) and
+// whether to mlock() its stack and queues so page faults never delay an edge
+// (the rest of the process stays pageable).
+inline constexpr int kGpioRtPriority = 80;
+inline constexpr bool kGpioRtLockMemory = true;
+
 } // namespace AmustConfig
@@ -5,27 +5,21 @@
 
 #include <QDateTime>
 #include <QFontDatabase>
+#include <QFontMetrics>
 #include <QMouseEvent>
+#include <QPaintEvent>
 #include <QPainter>
 #include <QPainterPath>
+#include <QResizeEvent>
 #include <QtMath>
 
+#include "amust_config.h"
+#include "frame_scheduler.h"
+
 namespace {
 
 constexpr double kPi = 3.14159265358979323846;
-
-QRectF fitAspect(const QRectF &outer, double aspectW, double aspectH) {
-  const double target = aspectW / aspectH;
-  const double actual = outer.width() / outer.height();
-  if (actual > target) {
-    const double w = outer.height() * target;
-    const double x = outer.x() + (outer.width() - w) * 0.5;
-    return QRectF(x, outer.y(), w, outer.height());
-  }
-  const double h = outer.width() / target;
-  const double y = outer.y() + (outer.height() - h) * 0.5;
-  return QRectF(outer.x(), y, outer.width(), h);
-}
+constexpr qint64 kPulsePeriodMs = 1600;
 
 QFont fixedFont(int pixelSize) {
   QFont f = QFontDatabase::systemFont(QFontDatabase::FixedFont);
@@ -39,38 +33,115 @@ QColor withAlpha(const QColor &c, double a01) {
   return out;
 }
 
+// Logo and text area between the chrome's top and bottom bars.
+struct BootArea {
+  QRectF contentMain;
+  QRectF mainArea;
+
+  static BootArea forChrome(const ChromeLayout &chrome) {
+    const QRectF &screen = chrome.screen;
+    const qreal padXMain = screen.width() * 0.06;
+    const qreal topPad = screen.height() * 0.03;
+    const qreal bottomPad = screen.height() * 0.02;
+    BootArea a;
+    a.contentMain = screen.adjusted(padXMain, topPad, -padXMain, -bottomPad);
+    const qreal mainTop = chrome.topLineY + a.contentMain.height() * 0.02;
+    a.mainArea = QRectF(a.contentMain.left(), mainTop, a.contentMain.width(),
+                        chrome.bottomBar.top() - mainTop);
+    return a;
+  }
+};
+
+QPointF logoCenter(const QRectF &mainArea) {
+  return QPointF(mainArea.center().x(), mainArea.top() + mainArea.height() * 0.42);
+}
+
+qreal logoSize(const QRectF &mainArea) {
+  return qMin(mainArea.width(), mainArea.height()) * 0.23;
+}
+
 } // namespace
 
-BootScreenWidget::BootScreenWidget(QWidget *parent) : QWidget(parent) {
+BootScreenWidget::BootScreenWidget(QWidget *parent)
+    : QWidget(parent), paintTimer_("boot screen") {
   setAttribute(Qt::WA_OpaquePaintEvent);
   setAutoFillBackground(false);
-
-  progressTimer_.setInterval(50);
-  connect(&progressTimer_, &QTimer::timeout, this, [this]() {
-    progress_ = (progress_ >= 100) ? 0 : (progress_ + 1);
-    update();
+  chrome_.setStaticLayer(
+      [this](QPainter &p, const ChromeLayout &chrome) { paintDeviceInfo(p, chrome); });
+
+  // Both stop once the menu replaces this screen.
+  FrameScheduler &scheduler = FrameScheduler::instance();
+  // Only repaints when the minute changes.
+  scheduler.subscribe(this, 1000, [this]() {
+    if (!clockElement_.setKey(this, timeText()))
+      paintTimer_.countSkipped();
   });
-  progressTimer_.start();
-
-  clockTimer_.setInterval(1000);
-  connect(&clockTimer_, &QTimer::timeout, this, [this]() { update(); });
-  clockTimer_.start();
-
-  pulseTimer_.setInterval(16);
-  connect(&pulseTimer_, &QTimer::timeout, this, [this]() {
-    // ~1.6s period (matches web)
-    pulsePhase_ += (2.0 * kPi) * (pulseTimer_.interval() / 1600.0);
-    if (pulsePhase_ > 2.0 * kPi)
-      pulsePhase_ -= 2.0 * kPi;
-    update();
+
+  pulseClock_.start();
+  scheduler.subscribe(this, AmustConfig::kUiFramePeriodMs, [this]() {
+    if (still_)
+      return;
+    // ~1.6s period (matches web); phase from the clock since frames can slip.
+    pulsePhase_ =
+        (2.0 * kPi) * (pulseClock_.elapsed() % kPulsePeriodMs) / double(kPulsePeriodMs);
+    if (!pulseElement_.setKey(this, QString::number(pulseAlpha())))
+      paintTimer_.countSkipped();
   });
-  pulseTimer_.start();
+}
+
+void BootScreenWidget::showStill(const QString &clockText, double pulsePhase) {
+  still_ = true;
+  stillClockText_ = clockText;
+  pulsePhase_ = pulsePhase;
+  clockElement_.setKey(this, timeText());
+  pulseElement_.setKey(this, QString::number(pulseAlpha()));
 }
 
 QString BootScreenWidget::timeText() const {
+  if (still_)
+    return stillClockText_;
   return QTime::currentTime().toString("hh:mm");
 }
 
+QString BootScreenWidget::stateText() const {
+  return QString("STATE %1").arg(deviceState_);
+}
+
+int BootScreenWidget::pulseAlpha() const {
+  const double s = 0.5 * (1.0 + std::sin(pulsePhase_));
+  const double alpha = 0.15 + (0.85 * s);
+  return qRound(255.0 * 0.7 * alpha);
+}
+
+void BootScreenWidget::resizeEvent(QResizeEvent *event) {
+  QWidget::resizeEvent(event);
+  const ChromeLayout chrome = ChromeLayout::forRect(QRectF(rect()));
+  const BootArea area = BootArea::forChrome(chrome);
+  const QRectF &topBar = chrome.topBar;
+
+  // Text can bleed a pixel past its box when antialiased.
+  stateElement_.setRect(QRectF(topBar.left(), topBar.top(), topBar.width() * 0.45, topBar.height())
+                     .toAlignedRect()
+                     .adjusted(-1, -1, 1, 1));
+  const int clockW = QFontMetrics(fixedFont(16)).horizontalAdvance(QStringLiteral("00:00")) + 8;
+  clockElement_.setRect(QRectF(topBar.center().x() - clockW * 0.5, topBar.top(), clockW, topBar.height())
+                     .toAlignedRect()
+                     .adjusted(-1, -1, 1, 1));
+  pulseElement_.setRect(QRectF(area.contentMain.left(),
+                        area.mainArea.bottom() - area.mainArea.height() * 0.12,
+                        area.contentMain.width(), 18)
+                     .toAlignedRect()
+                     .adjusted(-1, -1, 1, 1));
+  const QPointF c = logoCenter(area.mainArea);
+  const qreal r = logoSize(area.mainArea) * 0.95 + 4.0; // soft plate, plus a pen width
+  logoRect_ = QRectF(c.x() - r, c.y() - r, 2 * r, 2 * r).toAlignedRect();
+
+  // The resize repaints everything anyway; record what it will show.
+  stateElement_.setKey(this, stateText());
+  clockElement_.setKey(this, timeText());
+  pulseElement_.setKey(this, QString::number(pulseAlpha()));
+}
+
 void BootScreenWidget::mousePressEvent(QMouseEvent *event) {
   if (event->button() == Qt::LeftButton) {
     emit continueRequested();
@@ -78,109 +149,60 @@ void BootScreenWidget::mousePressEvent(QMouseEvent *event) {
   QWidget::mousePressEvent(event);
 }
 
+void BootScreenWidget::paintDeviceInfo(QPainter &p, const ChromeLayout &chrome) const {
+  const BootArea area = BootArea::forChrome(chrome);
+  const QRectF &contentMain = area.contentMain;
+  const QRectF &mainArea = area.mainArea;
+
+  const qreal infoY = mainArea.bottom() - mainArea.height() * 0.28;
+  p.setPen(Qt::white);
+  QFont title = font();
+  title.setBold(true);
+  title.setPixelSize(24);
+  p.setFont(title);
+  p.drawText(QRectF(contentMain.left(), infoY, contentMain.width(), 30), Qt::AlignHCenter, "AMUST");
+
+  p.setFont(fixedFont(13));
+  p.setPen(withAlpha(Qt::white, 0.8));
+  p.drawText(QRectF(contentMain.left(), infoY + 30, contentMain.width(), 22), Qt::AlignHCenter,
+             "High-Voltage Energy Emission Device");
+}
+
 void BootScreenWidget::paintEvent(QPaintEvent *event) {
-  Q_UNUSED(event);
+  QElapsedTimer paintTime;
+  paintTime.start();
 
   QPainter p(this);
+  const QRect dirty = event->rect();
+  const ChromeLayout &chrome = chrome_.paint(p, size(), devicePixelRatioF(), dirty);
   p.setRenderHint(QPainter::Antialiasing, true);
 
-  // Full-screen blue background (no outer frame/bezel)
-  const QRectF screen = fitAspect(QRectF(rect()), 1024.0, 600.0);
-  {
-    QLinearGradient bg(screen.topLeft(), screen.bottomLeft());
-    bg.setColorAt(0.0, QColor("#1a4d7a"));
-    bg.setColorAt(0.5, QColor("#2b7bc4"));
-    bg.setColorAt(1.0, QColor("#0f2d4a"));
-    p.fillRect(screen, bg);
-
-    QRadialGradient glow(screen.center(), screen.width() * 0.55);
-    glow.setColorAt(0.0, withAlpha(QColor("#3a8dd8"), 0.22));
-    glow.setColorAt(0.6, withAlpha(QColor("#3a8dd8"), 0.05));
-    glow.setColorAt(1.0, withAlpha(QColor("#3a8dd8"), 0.0));
-    p.fillRect(screen, glow);
-  }
-
-  // Content paddings (match web-ish)
-  const qreal padXMain = screen.width() * 0.06;
-  const qreal padXBar = screen.width() * 0.04;
-  const qreal topPad = screen.height() * 0.03;
-  const qreal bottomPad = screen.height() * 0.02;
-
-  const QRectF contentMain =
-      screen.adjusted(padXMain, topPad, -padXMain, -bottomPad);
-  const QRectF contentBar = screen.adjusted(padXBar, topPad, -padXBar, -bottomPad);
-
-  // Top bar
-  const qreal topBarH = contentBar.height() * 0.06;
-  const QRectF topBar =
-      QRectF(contentBar.left(), contentBar.top(), contentBar.width(), topBarH);
-  const qreal topLineY = topBar.bottom();
+  const BootArea area = BootArea::forChrome(chrome);
+  const QRectF &contentMain = area.contentMain;
+  const QRectF &mainArea = area.mainArea;
+  const QRectF &topBar = chrome.topBar;
+  const qreal topBarH = topBar.height();
 
   // Top left: state
-  {
+  if (dirty.intersects(stateElement_.rect())) {
     p.setFont(fixedFont(14));
     p.setPen(withAlpha(Qt::white, 0.72));
-    const QString left = QString("STATE %1").arg(deviceState_);
     p.drawText(QRectF(topBar.left(), topBar.top(), topBar.width() * 0.45, topBarH),
-               Qt::AlignVCenter | Qt::AlignLeft, left);
+               Qt::AlignVCenter | Qt::AlignLeft, stateText());
   }
 
   // Top center: time (absolute center)
-  {
+  if (dirty.intersects(clockElement_.rect())) {
     p.setFont(fixedFont(16));
     p.setPen(withAlpha(Qt::white, 0.82));
     p.drawText(QRectF(topBar.left(), topBar.top(), topBar.width(), topBarH),
                Qt::AlignVCenter | Qt::AlignHCenter, timeText());
   }
 
-  // Top right: dots
-  {
-    const int dotCount = 7;
-    const qreal r = 4.0;
-    const qreal gap = 6.0;
-    const qreal totalW = dotCount * (2 * r) + (dotCount - 1) * gap;
-    const qreal x0 = topBar.right() - totalW;
-    const qreal y0 = topBar.center().y() - r;
-    p.setPen(Qt::NoPen);
-    p.setBrush(withAlpha(Qt::white, 0.55));
-    for (int i = 0; i < dotCount; i++) {
-      p.drawEllipse(QRectF(x0 + i * (2 * r + gap), y0, 2 * r, 2 * r));
-    }
-  }
-
-  // Top border line
-  {
-    QLinearGradient line(QPointF(contentBar.left(), topLineY),
-                         QPointF(contentBar.right(), topLineY));
-    line.setColorAt(0.0, withAlpha(Qt::white, 0.55));
-    line.setColorAt(0.5, withAlpha(Qt::white, 0.8));
-    line.setColorAt(1.0, withAlpha(Qt::white, 0.55));
-    QPen pen(QBrush(line), 1.0);
-    p.setPen(pen);
-    p.drawLine(QPointF(contentBar.left(), topLineY), QPointF(contentBar.right(), topLineY));
-  }
-
-  // Bottom bar layout
-  const qreal bottomBarH = contentBar.height() * 0.12;
-  const qreal bottomLift = 0.0;
-  const QRectF bottomBar = QRectF(contentBar.left(),
-                                  contentBar.bottom() - bottomBarH - bottomLift,
-                                  contentBar.width(), bottomBarH);
-  const qreal footerHeight = 18.0;
-  const qreal footerTopY = bottomBar.bottom() - footerHeight;
-  const qreal topLineOffset = topLineY - topBar.top();
-  qreal bottomLineY = bottomBar.bottom() - topLineOffset;
-  bottomLineY = std::min(bottomLineY, footerTopY - 10.0);
-
-  // Main area (logo + text)
-  const QRectF mainArea =
-      QRectF(contentMain.left(), topLineY + contentMain.height() * 0.02, contentMain.width(),
-             (bottomBar.top() - (topLineY + contentMain.height() * 0.02)));
-
   // Logo (simple rings + hex + A)
-  {
-    const QPointF c(mainArea.center().x(), mainArea.top() + mainArea.height() * 0.42);
-    const qreal size = qMin(mainArea.width(), mainArea.height()) * 0.23;
+  if (dirty.intersects(logoRect_)) {
+    const QPointF c = logoCenter(mainArea);
+    const qreal size = logoSize(mainArea);
 
     auto drawRing = [&](qreal r, const QColor &col, qreal w) {
       QPen pen(withAlpha(col, col.alphaF()), w);
@@ -259,90 +281,16 @@ void BootScreenWidget::paintEvent(QPaintEvent *event) {
     }
   }
 
-  // Device info text
-  {
-    const qreal infoY = mainArea.bottom() - mainArea.height() * 0.28;
-    p.setPen(Qt::white);
-    QFont title = font();
-    title.setBold(true);
-    title.setPixelSize(24);
-    p.setFont(title);
-    p.drawText(QRectF(contentMain.left(), infoY, contentMain.width(), 30), Qt::AlignHCenter, "AMUST");
-
-    p.setFont(fixedFont(13));
-    p.setPen(withAlpha(Qt::white, 0.8));
-    p.drawText(QRectF(contentMain.left(), infoY + 30, contentMain.width(), 22), Qt::AlignHCenter,
-               "High-Voltage Energy Emission Device");
-  }
-
   // Click to continue (pulse)
-  {
-    const double s = 0.5 * (1.0 + std::sin(pulsePhase_));
-    const double alpha = 0.15 + (0.85 * s);
+  if (dirty.intersects(pulseElement_.rect())) {
     p.setFont(fixedFont(12));
-    p.setPen(withAlpha(Qt::white, 0.7 * alpha));
+    p.setPen(QColor(255, 255, 255, pulseAlpha()));
     p.drawText(QRectF(contentMain.left(), mainArea.bottom() - mainArea.height() * 0.12,
                       contentMain.width(), 18),
                Qt::AlignHCenter, "CLICK TO CONTINUE");
   }
 
-  // Bottom border line
-  {
-    QLinearGradient line(QPointF(contentBar.left(), bottomLineY),
-                         QPointF(contentBar.right(), bottomLineY));
-    line.setColorAt(0.0, withAlpha(Qt::white, 0.55));
-    line.setColorAt(0.5, withAlpha(Qt::white, 0.8));
-    line.setColorAt(1.0, withAlpha(Qt::white, 0.55));
-    QPen pen(QBrush(line), 1.0);
-    p.setPen(pen);
-    p.drawLine(QPointF(contentBar.left(), bottomLineY), QPointF(contentBar.right(), bottomLineY));
-  }
-
-  // Left decorative circles
-  {
-    const QPointF base(contentBar.left() + 20, bottomLineY);
-    p.setPen(QPen(withAlpha(Qt::white, 0.7), 2.0));
-    p.setBrush(Qt::NoBrush);
-    p.drawEllipse(base, 4.0, 4.0);
-    p.setBrush(withAlpha(Qt::white, 0.18));
-    p.drawEllipse(QPointF(base.x() + 16, base.y()), 6.0, 6.0);
-    p.setBrush(Qt::NoBrush);
-    p.drawEllipse(QPointF(base.x() + 32, base.y()), 4.0, 4.0);
-  }
-
-  // ECG line (right)
-  {
-    const QRectF ecg(contentBar.right() - 110, bottomLineY - 14, 100, 28);
-    QPainterPath path;
-    path.moveTo(ecg.left(), ecg.center().y());
-    path.lineTo(ecg.left() + ecg.width() * 0.2, ecg.center().y());
-    path.lineTo(ecg.left() + ecg.width() * 0.25, ecg.top() + ecg.height() * 0.25);
-    path.lineTo(ecg.left() + ecg.width() * 0.3, ecg.bottom() - ecg.height() * 0.25);
-    path.lineTo(ecg.left() + ecg.width() * 0.35, ecg.center().y());
-    path.lineTo(ecg.right(), ecg.center().y());
-    p.setBrush(Qt::NoBrush);
-    p.setPen(QPen(withAlpha(Qt::white, 0.9), 2.0, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
-    p.drawPath(path);
-  }
-
-  // Footer text
-  {
-    p.setFont(fixedFont(11));
-    p.setPen(withAlpha(Qt::white, 0.5));
-    const QString footer = QString::fromUtf8(
-        u8"UMUSTR&D | Model AMUST-A001RPIW | HW Rev.C | FIRMWARE v1.0.0");
-    p.drawText(QRectF(contentBar.left(), footerTopY, contentBar.width(), 16),
-               Qt::AlignHCenter, footer);
-  }
-
-  // Screen glare
-  {
-    QRectF glare(screen.left(), screen.top(), screen.width(), screen.height() * 0.22);
-    QLinearGradient g(glare.topLeft(), glare.bottomLeft());
-    g.setColorAt(0.0, withAlpha(Qt::white, 0.06));
-    g.setColorAt(1.0, withAlpha(Qt::white, 0.0));
-    p.setPen(Qt::NoPen);
-    p.setBrush(g);
-    p.drawRect(glare);
-  }
+  chrome_.paintGlare(p, dirty);
+  p.end();
+  paintTimer_.record(paintTime.nsecsElapsed(), event->region(), chrome_);
 }
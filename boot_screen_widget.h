@@ -1,17 +1,22 @@
 #pragma once
 
 #include <QElapsedTimer>
-#include <QTimer>
 #include <QWidget>
 
+#include "chrome_renderer.h"
+
 class BootScreenWidget final : public QWidget {
   Q_OBJECT
 
 public:
   explicit BootScreenWidget(QWidget *parent = nullptr);
 
+  // Freezes the clock and the pulse (tools/render_bench).
+  void showStill(const QString &clockText, double pulsePhase);
+
 protected:
   void paintEvent(QPaintEvent *event) override;
+  void resizeEvent(QResizeEvent *event) override;
   void mousePressEvent(QMouseEvent *event) override;
 
 signals:
@@ -19,14 +24,23 @@ signals:
 
 private:
   QString timeText() const;
+  QString stateText() const;
+  int pulseAlpha() const;
+  // Static, so baked into the chrome cache.
+  void paintDeviceInfo(QPainter &p, const ChromeLayout &chrome) const;
 
-  QTimer progressTimer_;
-  QTimer clockTimer_;
-  QTimer pulseTimer_;
-
-  int progress_ = 0;
+  QElapsedTimer pulseClock_;
   double pulsePhase_ = 0.0;
+  bool still_ = false;
+  QString stillClockText_;
 
   QString deviceState_ = "BOOT";
+
+  ChromeRenderer chrome_;
+  PaintTimer paintTimer_;
+  DirtyElement stateElement_;
+  DirtyElement clockElement_;
+  DirtyElement pulseElement_;
+  QRect logoRect_;
 };
 
@@ -0,0 +1,290 @@
+#include "chrome_renderer.h"
+
+#include <algorithm>
+
+#include <QByteArray>
+#include <QDebug>
+#include <QFontDatabase>
+#include <QPainter>
+#include <QPainterPath>
+#include <QWidget>
+#include <QtMath>
+
+namespace {
+constexpr qint64 kPaintReportIntervalMs = 10'000;
+
+QRectF fitAspect(const QRectF &outer, double aspectW, double aspectH) {
+  const double target = aspectW / aspectH;
+  const double actual = outer.width() / outer.height();
+  if (actual > target) {
+    const double w = outer.height() * target;
+    const double x = outer.x() + (outer.width() - w) * 0.5;
+    return QRectF(x, outer.y(), w, outer.height());
+  }
+  const double h = outer.width() / target;
+  const double y = outer.y() + (outer.height() - h) * 0.5;
+  return QRectF(outer.x(), y, outer.width(), h);
+}
+
+QFont fixedFont(int pixelSize) {
+  QFont f = QFontDatabase::systemFont(QFontDatabase::FixedFont);
+  f.setPixelSize(pixelSize);
+  return f;
+}
+
+QColor withAlpha(const QColor &c, double a01) {
+  QColor out = c;
+  out.setAlphaF(std::clamp(a01, 0.0, 1.0));
+  return out;
+}
+
+void drawBorderLine(QPainter &p, qreal left, qreal right, qreal y) {
+  QLinearGradient line(QPointF(left, y), QPointF(right, y));
+  line.setColorAt(0.0, withAlpha(Qt::white, 0.55));
+  line.setColorAt(0.5, withAlpha(Qt::white, 0.8));
+  line.setColorAt(1.0, withAlpha(Qt::white, 0.55));
+  p.setPen(QPen(QBrush(line), 1.0));
+  p.drawLine(QPointF(left, y), QPointF(right, y));
+}
+} // namespace
+
+ChromeLayout ChromeLayout::forRect(const QRectF &rect) {
+  ChromeLayout l;
+  l.screen = fitAspect(rect, 1024.0, 600.0);
+
+  const qreal padXBar = l.screen.width() * 0.04;
+  const qreal topPad = l.screen.height() * 0.03;
+  const qreal bottomPad = l.screen.height() * 0.02;
+  l.contentBar = l.screen.adjusted(padXBar, topPad, -padXBar, -bottomPad);
+
+  const qreal topBarH = l.contentBar.height() * 0.06;
+  l.topBar = QRectF(l.contentBar.left(), l.contentBar.top(), l.contentBar.width(), topBarH);
+  l.topLineY = l.topBar.bottom();
+
+  const qreal bottomBarH = l.contentBar.height() * 0.12;
+  l.bottomBar = QRectF(l.contentBar.left(), l.contentBar.bottom() - bottomBarH,
+                       l.contentBar.width(), bottomBarH);
+  const qreal footerHeight = 18.0;
+  l.footerTopY = l.bottomBar.bottom() - footerHeight;
+  const qreal topLineOffset = l.topLineY - l.topBar.top();
+  l.bottomLineY = std::min(l.bottomBar.bottom() - topLineOffset, l.footerTopY - 10.0);
+  return l;
+}
+
+ChromeRenderer::ChromeRenderer() {
+  cacheEnabled_ = qgetenv("AMUST_CHROME_CACHE") != "0";
+}
+
+void ChromeRenderer::setStaticLayer(Layer layer) {
+  staticLayer_ = std::move(layer);
+  invalidate();
+}
+
+void ChromeRenderer::invalidate() {
+  cache_ = QPixmap();
+  cacheSize_ = QSize();
+}
+
+const ChromeLayout &ChromeRenderer::paint(QPainter &p, const QSize &size, qreal dpr,
+                                          const QRect &dirty) {
+  if (!cacheEnabled_) {
+    layout_ = ChromeLayout::forRect(QRectF(QPointF(0, 0), QSizeF(size)));
+    p.save();
+    p.setRenderHint(QPainter::Antialiasing, true);
+    draw(p);
+    p.restore();
+    return layout_;
+  }
+
+  if (cache_.isNull() || size != cacheSize_ || !qFuzzyCompare(dpr, cacheDpr_)) {
+    QElapsedTimer timer;
+    timer.start();
+    layout_ = ChromeLayout::forRect(QRectF(QPointF(0, 0), QSizeF(size)));
+    cache_ = QPixmap(QSize(qCeil(size.width() * dpr), qCeil(size.height() * dpr)));
+    cache_.setDevicePixelRatio(dpr);
+    cache_.fill(Qt::black);
+    {
+      QPainter cp(&cache_);
+      cp.setRenderHint(QPainter::Antialiasing, true);
+      draw(cp);
+    }
+    cacheSize_ = size;
+    cacheDpr_ = dpr;
+    rebuilds_++;
+    lastRebuildUs_ = timer.nsecsElapsed() / 1000;
+  }
+  const QRect bounds(QPoint(0, 0), size);
+  const QRect target = dirty.isNull() ? bounds : dirty.intersected(bounds);
+  const QRectF source(target.x() * dpr, target.y() * dpr, target.width() * dpr,
+                      target.height() * dpr);
+  p.drawPixmap(QRectF(target), cache_, source);
+  return layout_;
+}
+
+void ChromeRenderer::draw(QPainter &p) const {
+  const ChromeLayout &l = layout_;
+  const QRectF &screen = l.screen;
+  const QRectF &contentBar = l.contentBar;
+
+  // Full-screen blue background
+  {
+    QLinearGradient bg(screen.topLeft(), screen.bottomLeft());
+    bg.setColorAt(0.0, QColor("#1a4d7a"));
+    bg.setColorAt(0.5, QColor("#2b7bc4"));
+    bg.setColorAt(1.0, QColor("#0f2d4a"));
+    p.fillRect(screen, bg);
+
+    QRadialGradient glow(screen.center(), screen.width() * 0.55);
+    glow.setColorAt(0.0, withAlpha(QColor("#3a8dd8"), 0.22));
+    glow.setColorAt(0.6, withAlpha(QColor("#3a8dd8"), 0.05));
+    glow.setColorAt(1.0, withAlpha(QColor("#3a8dd8"), 0.0));
+    p.fillRect(screen, glow);
+  }
+
+  // Top right: dots
+  {
+    const int dotCount = 7;
+    const qreal r = 4.0;
+    const qreal gap = 6.0;
+    const qreal totalW = dotCount * (2 * r) + (dotCount - 1) * gap;
+    const qreal x0 = l.topBar.right() - totalW;
+    const qreal y0 = l.topBar.center().y() - r;
+    p.setPen(Qt::NoPen);
+    p.setBrush(withAlpha(Qt::white, 0.55));
+    for (int i = 0; i < dotCount; i++) {
+      p.drawEllipse(QRectF(x0 + i * (2 * r + gap), y0, 2 * r, 2 * r));
+    }
+  }
+
+  drawBorderLine(p, contentBar.left(), contentBar.right(), l.topLineY);
+  drawBorderLine(p, contentBar.left(), contentBar.right(), l.bottomLineY);
+
+  // Left decorative circles
+  {
+    const QPointF base(contentBar.left() + 20, l.bottomLineY);
+    p.setPen(QPen(withAlpha(Qt::white, 0.7), 2.0));
+    p.setBrush(Qt::NoBrush);
+    p.drawEllipse(base, 4.0, 4.0);
+    p.setBrush(withAlpha(Qt::white, 0.18));
+    p.drawEllipse(QPointF(base.x() + 16, base.y()), 6.0, 6.0);
+    p.setBrush(Qt::NoBrush);
+    p.drawEllipse(QPointF(base.x() + 32, base.y()), 4.0, 4.0);
+  }
+
+  // ECG line (right)
+  {
+    const QRectF ecg(contentBar.right() - 110, l.bottomLineY - 14, 100, 28);
+    QPainterPath path;
+    path.moveTo(ecg.left(), ecg.center().y());
+    path.lineTo(ecg.left() + ecg.width() * 0.2, ecg.center().y());
+    path.lineTo(ecg.left() + ecg.width() * 0.25, ecg.top() + ecg.height() * 0.25);
+    path.lineTo(ecg.left() + ecg.width() * 0.3, ecg.bottom() - ecg.height() * 0.25);
+    path.lineTo(ecg.left() + ecg.width() * 0.35, ecg.center().y());
+    path.lineTo(ecg.right(), ecg.center().y());
+    p.setBrush(Qt::NoBrush);
+    p.setPen(QPen(withAlpha(Qt::white, 0.9), 2.0, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
+    p.drawPath(path);
+  }
+
+  // Footer text
+  {
+    p.setFont(fixedFont(11));
+    p.setPen(withAlpha(Qt::white, 0.5));
+    const QString footer = QString::fromUtf8(
+        u8"UMUSTR&D | Model AMUST-A001RPIW | HW Rev.C | FIRMWARE v1.0.0");
+    p.drawText(QRectF(contentBar.left(), l.footerTopY, contentBar.width(), 16),
+               Qt::AlignHCenter, footer);
+  }
+
+  if (staticLayer_) {
+    p.save();
+    staticLayer_(p, l);
+    p.restore();
+  }
+}
+
+void ChromeRenderer::paintGlare(QPainter &p, const QRect &dirty) const {
+  const QRectF &screen = layout_.screen;
+  const QRectF glare(screen.left(), screen.top(), screen.width(), screen.height() * 0.22);
+  const QRect clip = dirty.isNull() ? glare.toAlignedRect() : dirty & glare.toAlignedRect();
+  if (clip.isEmpty())
+    return;
+
+  // Not cached: it sits over the state and clock text drawn each frame.
+  p.save();
+  p.setClipRect(clip);
+  QLinearGradient g(glare.topLeft(), glare.bottomLeft());
+  g.setColorAt(0.0, withAlpha(Qt::white, 0.06));
+  g.setColorAt(1.0, withAlpha(Qt::white, 0.0));
+  p.setPen(Qt::NoPen);
+  p.setBrush(g);
+  p.drawRect(glare);
+  p.restore();
+}
+
+bool DirtyElement::setKey(QWidget *widget, const QString &key) {
+  if (shown_ && key == key_)
+    return false;
+  key_ = key;
+  shown_ = true;
+  widget->update(rect_);
+  return true;
+}
+
+PaintTimer::PaintTimer(const char *name) : name_(name) {}
+
+void PaintTimer::record(int64_t ns, const QRegion &painted, const ChromeRenderer &chrome) {
+  chrome_ = &chrome;
+  frames_++;
+  sumNs_ += ns;
+  maxNs_ = std::max(maxNs_, ns);
+  for (const QRect &r : painted)
+    areaPx_ += static_cast<int64_t>(r.width()) * r.height();
+  reportIfDue();
+}
+
+void PaintTimer::recordTick(int64_t ns) {
+  ticks_++;
+  tickSumNs_ += ns;
+  tickMaxNs_ = std::max(tickMaxNs_, ns);
+  reportIfDue();
+}
+
+void PaintTimer::reportIfDue() {
+  if (!window_.isValid())
+    window_.start();
+  if (window_.elapsed() < kPaintReportIntervalMs)
+    return;
+
+  const double seconds = window_.elapsed() / 1000.0;
+  QString line =
+      QString("UI: %1 paint %2 frames (%3 ticks skipped)").arg(name_).arg(frames_).arg(skipped_);
+  if (frames_ > 0) {
+    line += QString(", avg %1 us max %2 us, %3 px/s repainted")
+                .arg((sumNs_ / static_cast<int64_t>(frames_)) / 1000)
+                .arg(maxNs_ / 1000)
+                .arg(static_cast<int64_t>(areaPx_ / seconds));
+  }
+  if (chrome_) {
+    line += chrome_->isCached() ? QString("; chrome cached (%1 rebuilds, last %2 us)")
+                                      .arg(chrome_->rebuildCount())
+                                      .arg(chrome_->lastRebuildUs())
+                                : QStringLiteral("; chrome drawn every frame");
+  }
+  if (ticks_ > 0) {
+    line += QString("; tick avg %1 us max %2 us")
+                .arg((tickSumNs_ / static_cast<int64_t>(ticks_)) / 1000)
+                .arg(tickMaxNs_ / 1000);
+  }
+  qInfo().noquote() << line;
+
+  frames_ = 0;
+  skipped_ = 0;
+  areaPx_ = 0;
+  sumNs_ = 0;
+  maxNs_ = 0;
+  ticks_ = 0;
+  tickSumNs_ = 0;
+  tickMaxNs_ = 0;
+  window_.restart();
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QPixmap>
+#include <QRect>
+#include <QRectF>
+#include <QRegion>
+#include <QSize>
+#include <QString>
+
+#include <cstdint>
+#include <functional>
+
+class QPainter;
+class QWidget;
+
+// Where the shared 1024x600 chrome sits inside a widget.
+struct ChromeLayout {
+  QRectF screen;     // letterboxed to 1024:600
+  QRectF contentBar; // screen minus the bar paddings
+  QRectF topBar;
+  qreal topLineY = 0.0;
+  QRectF bottomBar;
+  qreal bottomLineY = 0.0;
+  qreal footerTopY = 0.0;
+
+  static ChromeLayout forRect(const QRectF &rect);
+};
+
+// The chrome BootScreenWidget and MainMenuWidget share: background and glow
+// gradients, top-bar dots, border lines, decorative circles, ECG path,
+// footer and glare. All but the glare never change between frames, so they
+// are rasterised once into a QPixmap keyed by widget size and device pixel
+// ratio; a frame is then one blit, the dynamic content, and the glare
+// painted over both.
+// AMUST_CHROME_CACHE=0 draws it directly every frame instead, for comparing
+// paint times.
+class ChromeRenderer final {
+public:
+  using Layer = std::function<void(QPainter &p, const ChromeLayout &layout)>;
+
+  ChromeRenderer();
+
+  // Widget-specific static content, baked into the cache above the chrome.
+  void setStaticLayer(Layer layer);
+  void invalidate();
+
+  // Paints the chrome for a widget of `size` (logical pixels) at `dpr`;
+  // only `dirty` is blitted (null = everything).
+  const ChromeLayout &paint(QPainter &p, const QSize &size, qreal dpr, const QRect &dirty = {});
+  // The glare across the top of the screen, over the dynamic content: call
+  // last, with the same `dirty`. Cheap when `dirty` misses it.
+  void paintGlare(QPainter &p, const QRect &dirty = {}) const;
+
+  bool isCached() const { return cacheEnabled_; }
+  uint64_t rebuildCount() const { return rebuilds_; }
+  int64_t lastRebuildUs() const { return lastRebuildUs_; }
+
+private:
+  void draw(QPainter &p) const;
+
+  Layer staticLayer_;
+  bool cacheEnabled_ = true;
+  QPixmap cache_;
+  QSize cacheSize_;
+  qreal cacheDpr_ = 0.0;
+  ChromeLayout layout_;
+  uint64_t rebuilds_ = 0;
+  int64_t lastRebuildUs_ = 0;
+};
+
+// A piece of per-frame content drawn over the chrome: its rect, taken from
+// the cached layout on resize, and a key for what it currently shows.
+// setKey() invalidates just that rect, and only when the key changes.
+class DirtyElement final {
+public:
+  void setRect(const QRect &rect) { rect_ = rect; }
+  const QRect &rect() const { return rect_; }
+  // False when nothing visible changed (no repaint scheduled).
+  bool setKey(QWidget *widget, const QString &key);
+
+private:
+  QRect rect_;
+  QString key_;
+  bool shown_ = false;
+};
+
+// paintEvent() cost and repainted area of one widget, logged as a single
+// line every few seconds together with how its chrome was drawn. Timer
+// ticks that changed nothing on screen are counted as skipped frames; the
+// cost of the widget's periodic UI tick, if it records one, goes on the same
+// line.
+class PaintTimer final {
+public:
+  explicit PaintTimer(const char *name);
+
+  void record(int64_t ns, const QRegion &painted, const ChromeRenderer &chrome);
+  void recordTick(int64_t ns);
+  void countSkipped() { skipped_++; }
+
+private:
+  void reportIfDue();
+
+  const char *name_;
+  const ChromeRenderer *chrome_ = nullptr; // last one painted with
+  QElapsedTimer window_;
+  uint64_t frames_ = 0;
+  uint64_t skipped_ = 0;
+  int64_t areaPx_ = 0;
+  int64_t sumNs_ = 0;
+  int64_t maxNs_ = 0;
+  uint64_t ticks_ = 0;
+  int64_t tickSumNs_ = 0;
+  int64_t tickMaxNs_ = 0;
+};
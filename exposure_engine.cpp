@@ -0,0 +1,96 @@
+#include "exposure_engine.h"
+
+#include <QDebug>
+
+#include <cstring>
+
+#if defined(__linux__)
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+ExposureEngine::ExposureEngine() {
+#if defined(__linux__)
+  timerFd_ = ::timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+  if (timerFd_ < 0)
+    qWarning() << "Exposure: timerfd unavailable; using poll timeouts";
+#endif
+}
+
+ExposureEngine::~ExposureEngine() {
+#if defined(__linux__)
+  if (timerFd_ >= 0)
+    ::close(timerFd_);
+#endif
+}
+
+void ExposureEngine::arm(int64_t deadlineNs) {
+  deadlineNs_ = deadlineNs;
+#if defined(__linux__)
+  if (timerFd_ < 0)
+    return;
+  // it_value 0 disarms; an absolute deadline already in the past fires at once.
+  itimerspec spec{};
+  if (deadlineNs > 0) {
+    spec.it_value.tv_sec = static_cast<time_t>(deadlineNs / 1'000'000'000);
+    spec.it_value.tv_nsec = static_cast<long>(deadlineNs % 1'000'000'000);
+  }
+  if (::timerfd_settime(timerFd_, TFD_TIMER_ABSTIME, &spec, nullptr) != 0)
+    qWarning() << "Exposure: timerfd_settime failed";
+#endif
+}
+
+void ExposureEngine::acknowledgeTimer(int64_t nowNs) {
+#if defined(__linux__)
+  if (timerFd_ >= 0) {
+    uint64_t expirations = 0;
+    (void)::read(timerFd_, &expirations, sizeof(expirations));
+  }
+#endif
+  if (isExposing() && nowNs < deadlineNs_)
+    arm(deadlineNs_);
+}
+
+void ExposureEngine::start(int64_t durationNs, int64_t onEdgeNs) {
+  active_ = true;
+  requestedNs_ = durationNs;
+  deliveredNs_ = 0;
+  segments_ = 1;
+  onSinceNs_ = onEdgeNs;
+  arm(onEdgeNs + durationNs);
+}
+
+void ExposureEngine::pause(int64_t offEdgeNs) {
+  if (!isExposing())
+    return;
+  deliveredNs_ += offEdgeNs - onSinceNs_;
+  onSinceNs_ = 0;
+  arm(0);
+}
+
+void ExposureEngine::resume(int64_t onEdgeNs) {
+  if (!active_ || isExposing())
+    return;
+  segments_++;
+  onSinceNs_ = onEdgeNs;
+  // Deadline from the nanoseconds actually delivered so far, so repeated
+  // pauses neither lose nor gain time.
+  arm(onEdgeNs + (requestedNs_ - deliveredNs_));
+}
+
+ExposureReport ExposureEngine::finish(int64_t offEdgeNs, bool completed) {
+  pause(offEdgeNs);
+  arm(0);
+  ExposureReport report;
+  report.requestedNs = requestedNs_;
+  report.deliveredNs = deliveredNs_;
+  report.errorNs = deliveredNs_ - requestedNs_;
+  report.segments = segments_;
+  report.completed = completed;
+  active_ = false;
+  return report;
+}
+
+int64_t ExposureEngine::deliveredNs(int64_t nowNs) const {
+  return deliveredNs_ + (isExposing() ? nowNs - onSinceNs_ : 0);
+}
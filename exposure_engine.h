@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+// Outcome of one exposure session (start .. timer expiry or stop).
+struct ExposureReport {
+  int64_t requestedNs = 0;
+  int64_t deliveredNs = 0; // enable line high, summed from edge timestamps
+  int64_t errorNs = 0;     // delivered - requested: > 0 overshoot, < 0 undershoot
+  int segments = 0;        // on-periods; 1 + number of resumes
+  bool completed = false;  // ended by the deadline rather than stopExposure()
+  bool interlocked = false; // ended or refused because of an interlock/e-stop
+  uint32_t startSeq = 0;    // the start this session belongs to; set by the owner
+};
+
+// Exposure bookkeeping plus an absolute CLOCK_MONOTONIC timerfd deadline.
+// Confined to GpioOutputThread: it reports each on/off edge with the time the
+// ioctl returned, and the thread drops the line as soon as timerFd() fires.
+// Without timerfd the thread waits on deadlineNs() instead.
+class ExposureEngine final {
+public:
+  ExposureEngine();
+  ~ExposureEngine();
+
+  ExposureEngine(const ExposureEngine &) = delete;
+  ExposureEngine &operator=(const ExposureEngine &) = delete;
+
+  int timerFd() const { return timerFd_; }
+
+  bool isActive() const { return active_; }     // session started, not finished
+  bool isExposing() const { return onSinceNs_ != 0; }
+  int64_t deadlineNs() const { return deadlineNs_; } // 0 = none armed
+  bool expired(int64_t nowNs) const { return isExposing() && nowNs >= deadlineNs_; }
+
+  void start(int64_t durationNs, int64_t onEdgeNs);
+  void pause(int64_t offEdgeNs);
+  void resume(int64_t onEdgeNs);
+  ExposureReport finish(int64_t offEdgeNs, bool completed);
+  // Clears a timerfd expiry after poll() reported it readable (re-arming if
+  // it fired ahead of the deadline).
+  void acknowledgeTimer(int64_t nowNs);
+
+  int64_t deliveredNs(int64_t nowNs) const;
+
+private:
+  void arm(int64_t deadlineNs);
+
+  int timerFd_ = -1;
+  bool active_ = false;
+  int64_t requestedNs_ = 0;
+  int64_t deliveredNs_ = 0;
+  int64_t onSinceNs_ = 0;
+  int64_t deadlineNs_ = 0;
+  int segments_ = 0;
+};
@@ -0,0 +1,206 @@
+#include "frame_scheduler.h"
+
+#include <algorithm>
+
+#include <QDebug>
+#include <QEvent>
+
+#include <time.h>
+
+#include "amust_config.h"
+
+namespace {
+
+constexpr int64_t kFrameNs = int64_t(AmustConfig::kUiFramePeriodMs) * 1'000'000;
+// Callbacks due this close after a wakeup run in it rather than one frame late.
+constexpr int64_t kFrameSlackNs = kFrameNs / 2;
+constexpr int64_t kReportIntervalNs = 10'000'000'000;
+
+int64_t processCpuNs() {
+  timespec ts{};
+  if (::clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0)
+    return 0;
+  return int64_t(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+}
+
+} // namespace
+
+FrameScheduler &FrameScheduler::instance() {
+  static FrameScheduler scheduler;
+  return scheduler;
+}
+
+FrameScheduler::FrameScheduler() {
+  clock_.start();
+  timer_.setSingleShot(true);
+  timer_.setTimerType(Qt::PreciseTimer);
+  connect(&timer_, &QTimer::timeout, this, [this]() { onFrame(); });
+}
+
+int FrameScheduler::subscribe(QWidget *owner, int intervalMs, Tick tick) {
+  Subscription s;
+  s.id = nextId_++;
+  s.owner = owner;
+  if (intervalMs > 0) {
+    s.intervalNs =
+        std::max<int64_t>(1, (int64_t(intervalMs) * 1'000'000 + kFrameNs / 2) / kFrameNs) *
+        kFrameNs;
+    s.dueNs = clock_.nsecsElapsed() + s.intervalNs;
+  } else {
+    s.dueNs = -1;
+  }
+  s.tick = std::move(tick);
+  const int id = s.id;
+
+  owner->installEventFilter(this);
+  connect(owner, &QObject::destroyed, this, [this, id]() { unsubscribe(id); });
+
+  if (inFrame_)
+    pending_.push_back(std::move(s));
+  else
+    subs_.push_back(std::move(s));
+  reschedule();
+  return id;
+}
+
+void FrameScheduler::unsubscribe(int id) {
+  for (auto *list : {&subs_, &pending_}) {
+    for (Subscription &s : *list) {
+      if (s.id == id)
+        s.removed = true;
+    }
+  }
+  if (!inFrame_) {
+    subs_.erase(std::remove_if(subs_.begin(), subs_.end(),
+                               [](const Subscription &s) { return s.removed; }),
+                subs_.end());
+  }
+  reschedule();
+}
+
+void FrameScheduler::requestTick(int id, int delayMs) {
+  const int64_t dueNs = clock_.nsecsElapsed() + int64_t(std::max(0, delayMs)) * 1'000'000;
+  for (auto *list : {&subs_, &pending_}) {
+    for (Subscription &s : *list) {
+      if (s.id == id && s.intervalNs == 0)
+        s.dueNs = dueNs;
+    }
+  }
+  reschedule();
+}
+
+bool FrameScheduler::eventFilter(QObject *watched, QEvent *event) {
+  // Visibility has not always settled when these arrive; look again once
+  // the event has been handled.
+  if ((event->type() == QEvent::Show || event->type() == QEvent::Hide) && !rescheduleQueued_) {
+    rescheduleQueued_ = true;
+    QMetaObject::invokeMethod(
+        this,
+        [this]() {
+          rescheduleQueued_ = false;
+          reschedule();
+        },
+        Qt::QueuedConnection);
+  }
+  return QObject::eventFilter(watched, event);
+}
+
+bool FrameScheduler::isEligible(const Subscription &s) const {
+  return !s.removed && s.dueNs >= 0 && s.owner && s.owner->isVisible();
+}
+
+void FrameScheduler::onFrame() {
+  const int64_t now = clock_.nsecsElapsed();
+  wakeups_++;
+
+  inFrame_ = true;
+  // Index loop: a tick may unsubscribe (marks only) or subscribe (pending_).
+  for (size_t i = 0; i < subs_.size(); ++i) {
+    Subscription &s = subs_[i];
+    if (!isEligible(s) || s.dueNs > now + kFrameSlackNs)
+      continue;
+    if (s.intervalNs == 0) {
+      s.dueNs = -1; // the callback may request the next one
+    } else {
+      s.dueNs += s.intervalNs;
+      // Fell behind (or was hidden): restart the cadence rather than catch up.
+      if (s.dueNs <= now)
+        s.dueNs = now + s.intervalNs;
+    }
+    const int64_t start = clock_.nsecsElapsed();
+    s.tick();
+    tickNs_ += clock_.nsecsElapsed() - start;
+    ticks_++;
+  }
+  inFrame_ = false;
+
+  subs_.erase(std::remove_if(subs_.begin(), subs_.end(),
+                             [](const Subscription &s) { return s.removed; }),
+              subs_.end());
+  for (Subscription &s : pending_) {
+    if (!s.removed)
+      subs_.push_back(std::move(s));
+  }
+  pending_.clear();
+
+  reportIfDue(clock_.nsecsElapsed(), false);
+  reschedule();
+}
+
+void FrameScheduler::reschedule() {
+  if (inFrame_)
+    return;
+
+  const int64_t now = clock_.nsecsElapsed();
+  int64_t due = -1;
+  for (Subscription &s : subs_) {
+    if (!isEligible(s))
+      continue;
+    if (due < 0 || s.dueNs < due)
+      due = s.dueNs;
+  }
+
+  if (due < 0) {
+    timer_.stop();
+    if (windowStartNs_ >= 0) {
+      reportIfDue(now, true);
+      qInfo() << "UI: frame scheduler idle";
+      windowStartNs_ = -1;
+    }
+    return;
+  }
+
+  // Wake on frame boundaries so callbacks with different rates coincide. One
+  // that became visible after its due time ticks on the next frame.
+  const int64_t frame = ((std::max(due, now) + kFrameNs - 1) / kFrameNs) * kFrameNs;
+  const int delayMs = static_cast<int>((frame - now + 999'999) / 1'000'000);
+  if (windowStartNs_ < 0) {
+    windowStartNs_ = now;
+    windowCpuNs_ = processCpuNs();
+    wakeups_ = 0;
+    ticks_ = 0;
+    tickNs_ = 0;
+  }
+  timer_.start(delayMs);
+}
+
+void FrameScheduler::reportIfDue(int64_t nowNs, bool goingIdle) {
+  if (windowStartNs_ < 0)
+    return;
+  const int64_t windowNs = nowNs - windowStartNs_;
+  // Going idle reports the partial window.
+  if (windowNs <= 0 || (windowNs < kReportIntervalNs && !goingIdle))
+    return;
+
+  const double seconds = windowNs / 1e9;
+  const int64_t cpuNs = processCpuNs();
+  qInfo().nospace() << "UI: frame scheduler " << qRound(wakeups_ / seconds) << " wakeups/s, "
+                    << qRound(ticks_ / seconds) << " ticks/s ("
+                    << (ticks_ ? tickNs_ / int64_t(ticks_) / 1000 : 0) << " us avg), process CPU "
+                    << QString::number(100.0 * (cpuNs - windowCpuNs_) / windowNs, 'f', 1) << "%";
+  windowStartNs_ = nowNs;
+  windowCpuNs_ = cpuNs;
+  wakeups_ = 0;
+  ticks_ = 0;
+  tickNs_ = 0;
+}
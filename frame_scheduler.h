@@ -0,0 +1,71 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QWidget>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// The application's single timer for periodic UI work. A widget subscribes
+// a callback with the rate it wants; callbacks only run while their widget
+// is visible, and every callback due within the same frame
+// (AmustConfig::kUiFramePeriodMs) shares one wakeup. With nothing visible
+// subscribed the timer is stopped and the GUI thread sleeps until an event
+// arrives. Wakeups/s, ticks/s and process CPU are logged every few seconds
+// while it runs.
+class FrameScheduler final : public QObject {
+  Q_OBJECT
+
+public:
+  using Tick = std::function<void()>;
+
+  static FrameScheduler &instance();
+
+  // intervalMs is rounded to whole frames (at least one); 0 subscribes on
+  // demand: the callback only runs once per requestTick(). The subscription
+  // ends with unsubscribe() or when owner is destroyed.
+  int subscribe(QWidget *owner, int intervalMs, Tick tick);
+  void unsubscribe(int id);
+  // Runs an on-demand subscription's callback on the first frame at least
+  // delayMs from now, replacing any earlier request.
+  void requestTick(int id, int delayMs);
+
+protected:
+  bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+  struct Subscription {
+    int id = 0;
+    QPointer<QWidget> owner;
+    int64_t intervalNs = 0; // 0 = on demand
+    int64_t dueNs = 0;      // -1 = not due (on demand, nothing requested)
+    Tick tick;
+    bool removed = false;
+  };
+
+  FrameScheduler();
+
+  bool isEligible(const Subscription &s) const;
+  void onFrame();
+  void reschedule();
+  void reportIfDue(int64_t nowNs, bool goingIdle);
+
+  QTimer timer_;
+  QElapsedTimer clock_;
+  std::vector<Subscription> subs_;
+  std::vector<Subscription> pending_; // subscribed from inside a tick
+  int nextId_ = 1;
+  bool inFrame_ = false;
+  bool rescheduleQueued_ = false;
+
+  int64_t windowStartNs_ = -1; // -1 while idle
+
+  int64_t windowCpuNs_ = 0;
+  uint64_t wakeups_ = 0;
+  uint64_t ticks_ = 0;
+  int64_t tickNs_ = 0;
+};
@@ -0,0 +1,351 @@
+#include "gpio_backend.h"
+
+#include <chrono>
+#include <cstdio>
+
+#include <QByteArray>
+#include <QDebug>
+
+#include "amust_config.h"
+#include "gpio_chip.h"
+#include "hw/gpio_expander.h"
+#include "hw/i2c_transport.h"
+
+namespace {
+int64_t monotonicNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+} // namespace
+
+GpioEdgeLog::GpioEdgeLog(size_t capacity) : capacity_(capacity) {
+  edges_.reserve(capacity_);
+}
+
+void GpioEdgeLog::record(int offset, bool high, int64_t timestampNs) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (edges_.size() >= capacity_) {
+    dropped_++;
+    return;
+  }
+  edges_.push_back(GpioEdge{offset, high, timestampNs});
+}
+
+std::vector<GpioEdge> GpioEdgeLog::edges() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return edges_;
+}
+
+uint64_t GpioEdgeLog::droppedCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return dropped_;
+}
+
+void GpioEdgeLog::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  edges_.clear();
+  dropped_ = 0;
+}
+
+bool SimulatedGpioBackend::request(const std::vector<int> &offsets, bool initialHigh,
+                                   const char *consumer) {
+  Q_UNUSED(consumer);
+  offsets_ = offsets;
+  // The request drives every line to its initial level: log that as edges
+  // too, so a session's record starts from a known state.
+  const int64_t now = monotonicNs();
+  for (int offset : offsets_)
+    edges_.record(offset, initialHigh, now);
+  return true;
+}
+
+void SimulatedGpioBackend::release() {
+  offsets_.clear();
+}
+
+bool SimulatedGpioBackend::write(uint32_t levels, uint32_t changed) {
+  const int64_t now = monotonicNs();
+  for (size_t i = 0; i < offsets_.size(); i++) {
+    if ((changed >> i) & 1u)
+      edges_.record(offsets_[i], (levels >> i) & 1u, now);
+  }
+  return true;
+}
+
+#if defined(AMUST_HAVE_GPIOD)
+struct LibgpiodGpioBackend::Impl {
+  std::string chipName;
+  std::vector<int> offsets;
+  gpiod_chip *chip = nullptr;
+#if defined(AMUST_GPIOD_LEGACY_API)
+  // Requested as one bulk so they share a line handle: the v1 uAPI can then
+  // set them all in one GPIOHANDLE_SET_LINE_VALUES_IOCTL.
+  gpiod_line_bulk bulk;
+  bool requested = false;
+#else
+  gpiod_line_request *request = nullptr;
+#endif
+};
+
+LibgpiodGpioBackend::LibgpiodGpioBackend(std::string chipName)
+    : impl_(std::make_unique<Impl>()) {
+  impl_->chipName = std::move(chipName);
+}
+
+LibgpiodGpioBackend::~LibgpiodGpioBackend() {
+  release();
+}
+
+const char *LibgpiodGpioBackend::name() const {
+#if defined(AMUST_GPIOD_LEGACY_API)
+  return "gpiod-v1";
+#else
+  return "gpiod-v2";
+#endif
+}
+
+bool LibgpiodGpioBackend::request(const std::vector<int> &offsets, bool initialHigh,
+                                  const char *consumer) {
+  release();
+  impl_->chip = impl_->chipName.empty() ? openAmustGpioChip()
+                                        : openGpioChip(impl_->chipName.c_str());
+  if (!impl_->chip)
+    return false;
+
+  bool ok = true;
+#if defined(AMUST_GPIOD_LEGACY_API)
+  gpiod_line_bulk_init(&impl_->bulk);
+  for (int offset : offsets) {
+    gpiod_line *line = gpiod_chip_get_line(impl_->chip, static_cast<unsigned int>(offset));
+    if (!line) {
+      ok = false;
+      break;
+    }
+    gpiod_line_bulk_add(&impl_->bulk, line);
+  }
+  if (ok) {
+    const std::vector<int> defaults(offsets.size(), initialHigh ? 1 : 0);
+    ok = gpiod_line_request_bulk_output(&impl_->bulk, consumer, defaults.data()) == 0;
+    impl_->requested = ok;
+  }
+#else
+  gpiod_line_settings *settings = gpiod_line_settings_new();
+  gpiod_line_config *lineCfg = gpiod_line_config_new();
+  gpiod_request_config *requestCfg = gpiod_request_config_new();
+  ok = settings && lineCfg && requestCfg;
+  if (ok) {
+    gpiod_line_settings_set_direction(settings, GPIOD_LINE_DIRECTION_OUTPUT);
+    gpiod_line_settings_set_output_value(settings, initialHigh ? GPIOD_LINE_VALUE_ACTIVE
+                                                               : GPIOD_LINE_VALUE_INACTIVE);
+    gpiod_request_config_set_consumer(requestCfg, consumer);
+    std::vector<unsigned int> lineOffsets(offsets.begin(), offsets.end());
+    ok = gpiod_line_config_add_line_settings(lineCfg, lineOffsets.data(), lineOffsets.size(),
+                                             settings) == 0;
+  }
+  if (ok) {
+    impl_->request = gpiod_chip_request_lines(impl_->chip, requestCfg, lineCfg);
+    ok = impl_->request != nullptr;
+  }
+  if (settings)
+    gpiod_line_settings_free(settings);
+  if (lineCfg)
+    gpiod_line_config_free(lineCfg);
+  if (requestCfg)
+    gpiod_request_config_free(requestCfg);
+#endif
+  if (!ok) {
+    release();
+    return false;
+  }
+  impl_->offsets = offsets;
+  return true;
+}
+
+void LibgpiodGpioBackend::release() {
+#if defined(AMUST_GPIOD_LEGACY_API)
+  if (impl_->requested)
+    gpiod_line_release_bulk(&impl_->bulk);
+  impl_->requested = false;
+#else
+  if (impl_->request)
+    gpiod_line_request_release(impl_->request);
+  impl_->request = nullptr;
+#endif
+  if (impl_->chip)
+    gpiod_chip_close(impl_->chip);
+  impl_->chip = nullptr;
+  impl_->offsets.clear();
+}
+
+bool LibgpiodGpioBackend::write(uint32_t levels, uint32_t changed) {
+  const size_t n = impl_->offsets.size();
+  if (n == 0)
+    return false;
+#if defined(AMUST_GPIOD_LEGACY_API)
+  // The v1 uAPI sets every line of the handle; unchanged ones keep their level.
+  Q_UNUSED(changed);
+  int values[GpioOutputLines::kMaxLines];
+  for (size_t i = 0; i < n; i++)
+    values[i] = (levels >> i) & 1u;
+  return gpiod_line_set_value_bulk(&impl_->bulk, values) == 0;
+#else
+  unsigned int offsets[GpioOutputLines::kMaxLines];
+  gpiod_line_value values[GpioOutputLines::kMaxLines];
+  size_t count = 0;
+  for (size_t i = 0; i < n; i++) {
+    if (!((changed >> i) & 1u))
+      continue;
+    offsets[count] = static_cast<unsigned int>(impl_->offsets[i]);
+    values[count] = (levels >> i) & 1u ? GPIOD_LINE_VALUE_ACTIVE : GPIOD_LINE_VALUE_INACTIVE;
+    count++;
+  }
+  return gpiod_line_request_set_values_subset(impl_->request, count, offsets, values) == 0;
+#endif
+}
+
+namespace {
+// gpio-sim exposes each line's driven level as
+// /sys/bus/gpio/devices/<chip>/sim_gpio<offset>/value ("0"/"1").
+int readSimLevel(const std::string &chipName, int offset) {
+  std::string chip = chipName;
+  const size_t slash = chip.rfind('/');
+  if (slash != std::string::npos)
+    chip = chip.substr(slash + 1);
+  const std::string path =
+      "/sys/bus/gpio/devices/" + chip + "/sim_gpio" + std::to_string(offset) + "/value";
+  FILE *file = std::fopen(path.c_str(), "re");
+  if (!file)
+    return -1;
+  const int c = std::fgetc(file);
+  std::fclose(file);
+  return c == '1' ? 1 : c == '0' ? 0 : -1;
+}
+} // namespace
+
+KernelGpioSimBackend::KernelGpioSimBackend(std::string chipName)
+    : chipName_(std::move(chipName)), chip_(chipName_) {}
+
+bool KernelGpioSimBackend::request(const std::vector<int> &offsets, bool initialHigh,
+                                   const char *consumer) {
+  if (!chip_.request(offsets, initialHigh, consumer))
+    return false;
+  if (!offsets.empty() && readSimLevel(chipName_, offsets.front()) < 0) {
+    qWarning() << "GPIO: chip" << chipName_.c_str() << "is not a gpio-sim chip";
+    chip_.release();
+    return false;
+  }
+  offsets_ = offsets;
+  const int64_t now = monotonicNs();
+  for (int offset : offsets_)
+    edges_.record(offset, initialHigh, now);
+  return true;
+}
+
+void KernelGpioSimBackend::release() {
+  chip_.release();
+  offsets_.clear();
+}
+
+bool KernelGpioSimBackend::write(uint32_t levels, uint32_t changed) {
+  if (!chip_.write(levels, changed))
+    return false;
+  // Timestamp after the ioctl returned, like the edge timestamps elsewhere.
+  const int64_t now = monotonicNs();
+  for (size_t i = 0; i < offsets_.size(); i++) {
+    if (!((changed >> i) & 1u))
+      continue;
+    const bool high = (levels >> i) & 1u;
+    if (readSimLevel(chipName_, offsets_[i]) != (high ? 1 : 0))
+      mismatches_++;
+    edges_.record(offsets_[i], high, now);
+  }
+  return true;
+}
+#endif
+
+namespace {
+// AMUST_GPIO_EXPANDER_BUS, else AmustConfig::kGpioExpanderBus; "" = not fitted.
+std::string expanderBus() {
+  const QByteArray env = qgetenv("AMUST_GPIO_EXPANDER_BUS").trimmed().toLower();
+  if (!env.isEmpty())
+    return env.toStdString();
+  return AmustConfig::kGpioExpanderBus >= 0 ? std::to_string(AmustConfig::kGpioExpanderBus)
+                                            : std::string();
+}
+
+std::unique_ptr<GpioBackend> createExpanderBackend(const std::string &bus) {
+  const auto model = AmustConfig::kGpioExpanderPca9555 ? GpioExpander::Model::Pca9555
+                                                        : GpioExpander::Model::Mcp23017;
+  const auto address = static_cast<uint8_t>(AmustConfig::kGpioExpanderAddress);
+  if (bus == "fake") {
+    auto fake = std::make_unique<FakeI2cTransport>();
+    installFakeGpioExpander(*fake, address, model);
+    return std::make_unique<I2cExpanderGpioBackend>(std::move(fake), model, address);
+  }
+  const int busNum = parseI2cBus(bus);
+  if (busNum < 0) {
+    qWarning() << "GPIO: invalid expander bus" << bus.c_str();
+    return nullptr;
+  }
+  auto i2c = std::make_unique<LinuxI2cTransport>();
+  if (!i2c->open(busNum)) {
+    qWarning() << "GPIO: failed to open expander bus" << busNum;
+    return nullptr;
+  }
+  return std::make_unique<I2cExpanderGpioBackend>(std::move(i2c), model, address);
+}
+} // namespace
+
+std::unique_ptr<GpioBackend> createGpioBackend(const std::string &kind) {
+  if (kind == "expander" || (kind == "auto" && !expanderBus().empty())) {
+    const std::string bus = expanderBus();
+    if (bus.empty()) {
+      qWarning() << "GPIO: expander backend needs AMUST_GPIO_EXPANDER_BUS";
+      return nullptr;
+    }
+    return createExpanderBackend(bus);
+  }
+  if (kind == "sim")
+    return std::make_unique<SimulatedGpioBackend>();
+  if (kind == "none")
+    return nullptr;
+#if defined(AMUST_HAVE_GPIOD)
+  if (kind == "auto" || kind == "gpiod")
+    return std::make_unique<LibgpiodGpioBackend>();
+  if (kind == "gpio-sim") {
+    const QByteArray chip = qgetenv("AMUST_GPIO_CHIP");
+    if (chip.isEmpty()) {
+      qWarning() << "GPIO: gpio-sim backend needs AMUST_GPIO_CHIP";
+      return nullptr;
+    }
+    return std::make_unique<KernelGpioSimBackend>(chip.toStdString());
+  }
+#else
+  // A device build without libgpiod must not look like it drives outputs;
+  // the simulator is only ever asked for by name.
+  if (kind == "auto") {
+    qWarning() << "GPIO: built without libgpiod and no expander configured; no outputs";
+    return nullptr;
+  }
+  if (kind == "gpiod" || kind == "gpio-sim") {
+    qWarning() << "GPIO: backend" << kind.c_str() << "needs libgpiod; not built in";
+    return nullptr;
+  }
+#endif
+  qWarning() << "GPIO: unknown backend" << kind.c_str();
+  return nullptr;
+}
+
+std::unique_ptr<GpioBackend> createGpioBackend() {
+  const QByteArray kind = qgetenv("AMUST_GPIO_BACKEND").trimmed().toLower();
+  return createGpioBackend(kind.isEmpty() ? std::string("auto") : kind.toStdString());
+}
+
+std::unique_ptr<GpioBackend> createGpioChipBackend() {
+#if defined(AMUST_HAVE_GPIOD)
+  return std::make_unique<LibgpiodGpioBackend>();
+#else
+  return nullptr;
+#endif
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// One output level change as seen by a simulated chip.
+struct GpioEdge {
+  int offset = -1;
+  bool high = false;
+  int64_t timestampNs = 0; // CLOCK_MONOTONIC
+};
+
+// Where GpioOutputLines' writes end up. The caller keeps the shadow state
+// and only calls write() when `changed` is non-zero; each call is one
+// hardware transaction.
+class GpioBackend {
+public:
+  virtual ~GpioBackend() = default;
+
+  virtual const char *name() const = 0;
+  // Offsets are pins of an I2C expander rather than lines of a gpiochip.
+  virtual bool isExpander() const { return false; }
+  virtual bool request(const std::vector<int> &offsets, bool initialHigh,
+                       const char *consumer) = 0;
+  virtual void release() = 0;
+  // Bit i of `levels` drives offsets[i]; `changed` marks bits that differ
+  // from the previous write.
+  virtual bool write(uint32_t levels, uint32_t changed) = 0;
+};
+
+// Bounded, thread-safe edge log: the writer is the GPIO thread, readers are
+// tests and tools. Capacity is reserved up front; edges past it are counted
+// but not stored.
+class GpioEdgeLog final {
+public:
+  explicit GpioEdgeLog(size_t capacity = 4096);
+
+  void record(int offset, bool high, int64_t timestampNs);
+  std::vector<GpioEdge> edges() const;
+  uint64_t droppedCount() const;
+  void clear();
+
+private:
+  mutable std::mutex mutex_;
+  std::vector<GpioEdge> edges_;
+  size_t capacity_;
+  uint64_t dropped_ = 0;
+};
+
+// Pure in-memory chip; every level change is timestamped into edgeLog().
+class SimulatedGpioBackend final : public GpioBackend {
+public:
+  SimulatedGpioBackend() = default;
+
+  const char *name() const override { return "sim"; }
+  bool request(const std::vector<int> &offsets, bool initialHigh, const char *consumer) override;
+  void release() override;
+  bool write(uint32_t levels, uint32_t changed) override;
+
+  const GpioEdgeLog &edgeLog() const { return edges_; }
+  GpioEdgeLog &edgeLog() { return edges_; }
+
+private:
+  std::vector<int> offsets_;
+  GpioEdgeLog edges_;
+};
+
+#if defined(AMUST_HAVE_GPIOD)
+// A gpiochip through whichever libgpiod API the build found (v1: lines
+// requested as one bulk and set with one ioctl; v2: subset writes).
+class LibgpiodGpioBackend final : public GpioBackend {
+public:
+  // Empty = AmustConfig::kGpioChipName (or AMUST_GPIO_CHIP).
+  explicit LibgpiodGpioBackend(std::string chipName = {});
+  ~LibgpiodGpioBackend() override;
+
+  LibgpiodGpioBackend(const LibgpiodGpioBackend &) = delete;
+  LibgpiodGpioBackend &operator=(const LibgpiodGpioBackend &) = delete;
+
+  const char *name() const override;
+  bool request(const std::vector<int> &offsets, bool initialHigh, const char *consumer) override;
+  void release() override;
+  bool write(uint32_t levels, uint32_t changed) override;
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+// A chip of the kernel gpio-sim module: written through libgpiod like real
+// hardware, then read back from sysfs (sim_gpioN/value) to verify the level
+// and log the edge. Exercises the real uAPI path without wiring.
+class KernelGpioSimBackend final : public GpioBackend {
+public:
+  explicit KernelGpioSimBackend(std::string chipName);
+
+  const char *name() const override { return "gpio-sim"; }
+  bool request(const std::vector<int> &offsets, bool initialHigh, const char *consumer) override;
+  void release() override;
+  bool write(uint32_t levels, uint32_t changed) override;
+
+  const GpioEdgeLog &edgeLog() const { return edges_; }
+  uint64_t mismatchCount() const { return mismatches_; }
+
+private:
+  std::string chipName_;
+  LibgpiodGpioBackend chip_;
+  std::vector<int> offsets_;
+  GpioEdgeLog edges_;
+  uint64_t mismatches_ = 0;
+};
+#endif
+
+// AMUST_GPIO_BACKEND: auto (default; the I2C expander when one is configured,
+// else libgpiod when built with it, else none), gpiod, gpio-sim (chip from
+// AMUST_GPIO_CHIP), expander (see AmustConfig::kGpioExpanderBus), sim or none.
+// Null, with a warning, when the kind is unavailable.
+std::unique_ptr<GpioBackend> createGpioBackend();
+std::unique_ptr<GpioBackend> createGpioBackend(const std::string &kind);
+// The SoC gpiochip regardless of AMUST_GPIO_BACKEND, for lines that are
+// always wired there (ToF XSHUT). Null without libgpiod.
+std::unique_ptr<GpioBackend> createGpioChipBackend();
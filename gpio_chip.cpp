@@ -0,0 +1,116 @@
+#include "gpio_chip.h"
+
+#include <string>
+
+#include <QByteArray>
+#include <QDebug>
+
+#include "amust_config.h"
+#include "gpio_backend.h"
+
+#if defined(AMUST_HAVE_GPIOD)
+gpiod_chip *openGpioChip(const char *name) {
+#if defined(AMUST_GPIOD_LEGACY_API)
+  gpiod_chip *chip = gpiod_chip_open_lookup(name);
+  if (!chip)
+    qWarning() << "GPIO: failed to open chip" << name;
+  return chip;
+#else
+  const std::string chipPath = [chipPath = std::string(name)]() {
+    return chipPath.empty() || chipPath[0] == '/' ? chipPath : "/dev/" + chipPath;
+  }();
+  gpiod_chip *chip = gpiod_chip_open(chipPath.c_str());
+  if (!chip)
+    qWarning() << "GPIO: failed to open chip" << chipPath.c_str();
+  return chip;
+#endif
+}
+
+gpiod_chip *openAmustGpioChip() {
+  const QByteArray chip = qgetenv("AMUST_GPIO_CHIP");
+  return openGpioChip(chip.isEmpty() ? AmustConfig::kGpioChipName : chip.constData());
+}
+#endif
+
+namespace {
+uint32_t lineMask(size_t count) {
+  return count >= GpioOutputLines::kMaxLines ? ~0u : (1u << count) - 1;
+}
+} // namespace
+
+struct GpioOutputLines::Impl {
+  std::unique_ptr<GpioBackend> backend;
+  size_t count = 0;
+  uint32_t levels = 0;
+  uint64_t syscalls = 0;
+};
+
+GpioOutputLines::GpioOutputLines() : GpioOutputLines(createGpioBackend()) {}
+
+GpioOutputLines::GpioOutputLines(std::unique_ptr<GpioBackend> backend)
+    : impl_(std::make_unique<Impl>()) {
+  impl_->backend = std::move(backend);
+}
+
+GpioOutputLines::~GpioOutputLines() {
+  release();
+}
+
+bool GpioOutputLines::request(const std::vector<int> &offsets, bool initialHigh,
+                              const char *consumer) {
+  release();
+  if (!impl_->backend || offsets.empty() || offsets.size() > kMaxLines)
+    return false;
+  if (!impl_->backend->request(offsets, initialHigh, consumer)) {
+    qWarning() << "GPIO: failed to request" << offsets.size() << "output lines for" << consumer
+               << "on" << impl_->backend->name();
+    return false;
+  }
+  impl_->count = offsets.size();
+  impl_->levels = initialHigh ? lineMask(offsets.size()) : 0;
+  impl_->syscalls = 0;
+  return true;
+}
+
+void GpioOutputLines::release() {
+  if (impl_->backend && impl_->count > 0)
+    impl_->backend->release();
+  impl_->count = 0;
+}
+
+bool GpioOutputLines::set(size_t index, bool high) {
+  if (index >= impl_->count)
+    return false;
+  const uint32_t bit = 1u << index;
+  return write(high ? impl_->levels | bit : impl_->levels & ~bit);
+}
+
+bool GpioOutputLines::write(uint32_t levels) {
+  if (impl_->count == 0)
+    return false;
+  levels &= lineMask(impl_->count);
+  const uint32_t changed = levels ^ impl_->levels;
+  if (changed == 0)
+    return true;
+  impl_->syscalls++;
+  if (!impl_->backend->write(levels, changed))
+    return false;
+  impl_->levels = levels;
+  return true;
+}
+
+uint32_t GpioOutputLines::levels() const {
+  return impl_->levels;
+}
+
+size_t GpioOutputLines::size() const {
+  return impl_->count;
+}
+
+uint64_t GpioOutputLines::syscallCount() const {
+  return impl_->syscalls;
+}
+
+GpioBackend *GpioOutputLines::backend() const {
+  return impl_->backend.get();
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class GpioBackend;
+
+// Shared libgpiod plumbing for everything that touches AmustConfig::kGpioChipName.
+#if defined(AMUST_HAVE_GPIOD)
+#include <gpiod.h>
+
+#if defined(GPIOD_LINE_BULK_MAX_LINES)
+#define AMUST_GPIOD_LEGACY_API 1
+#endif
+
+// Opens `name` with whichever libgpiod API is available (v1: by name, v2:
+// by /dev path). Returns nullptr and logs on failure.
+gpiod_chip *openGpioChip(const char *name);
+// The configured chip: AMUST_GPIO_CHIP, else AmustConfig::kGpioChipName.
+gpiod_chip *openAmustGpioChip();
+#endif
+
+// A handful of output lines, requested together and driven by index through
+// a GpioBackend (createGpioBackend() unless one is given). A shadow of the
+// output levels is kept so that only lines that change are written, all of
+// them in one backend write; writing the current state costs nothing.
+// Without a backend request() fails and set() is a no-op.
+class GpioOutputLines final {
+public:
+  static constexpr size_t kMaxLines = 32;
+
+  GpioOutputLines();
+  explicit GpioOutputLines(std::unique_ptr<GpioBackend> backend);
+  ~GpioOutputLines();
+
+  GpioOutputLines(const GpioOutputLines &) = delete;
+  GpioOutputLines &operator=(const GpioOutputLines &) = delete;
+
+  bool request(const std::vector<int> &offsets, bool initialHigh, const char *consumer);
+  void release();
+  bool set(size_t index, bool high);
+  // Bit i drives line i.
+  bool write(uint32_t levels);
+  uint32_t levels() const;
+  size_t size() const;
+  // Backend writes (set-values ioctls on hardware) issued since request().
+  uint64_t syscallCount() const;
+  // Null when no backend is available.
+  GpioBackend *backend() const;
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
@@ -1,10 +1,31 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 
+class GpioBackend;
+
+// Logical output levels; several may share one physical line.
+struct GpioOutputs {
+  bool laser = false;
+  bool led1 = false;
+  bool led2 = false;
+  bool xrayEnable = false;
+};
+
+struct GpioStats {
+  uint64_t updates = 0;          // setOutputs()/set*() calls
+  uint64_t syscalls = 0;         // set-values ioctls actually issued
+  double syscallsPerSecond = 0.0; // over the last full second
+};
+
+// Maps the logical outputs onto AmustConfig::kGpio*Line and drives them
+// through a GpioBackend: createGpioBackend() (AMUST_GPIO_BACKEND) unless one
+// is passed in, e.g. a SimulatedGpioBackend whose edge log records exactly
+// what a session drove.
 class GpioController final {
 public:
-  GpioController();
+  explicit GpioController(std::unique_ptr<GpioBackend> backend = nullptr);
   ~GpioController();
 
   GpioController(const GpioController &) = delete;
@@ -12,6 +33,10 @@ public:
   GpioController(GpioController &&) = delete;
   GpioController &operator=(GpioController &&) = delete;
 
+  // Applies all outputs at once. A physical line shared by several outputs is
+  // high while any of them is on; only lines whose level changes are written,
+  // in a single ioctl, so repeating the current state costs no syscall.
+  void setOutputs(const GpioOutputs &outputs);
   void setLaser(bool on);
   void setLed1(bool on);
   void setLed2(bool on);
@@ -19,6 +44,9 @@ public:
 
   bool isInitialized() const;
   void setAllOff();
+  GpioStats stats() const;
+  // Null without a backend (outputs are then no-ops).
+  GpioBackend *backend() const;
 
 private:
   struct Impl;
@@ -0,0 +1,297 @@
+#include "gpio_inputs.h"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <chrono>
+
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+#include "amust_config.h"
+#include "gpio_chip.h"
+
+#if defined(AMUST_HAVE_GPIOD) && defined(AMUST_GPIOD_LEGACY_API)
+#include <sys/epoll.h>
+#endif
+
+namespace {
+// Edge events fetched per read.
+constexpr size_t kEventBatch = 16;
+
+struct InputSpec {
+  int line;
+  bool activeLow;
+};
+
+InputSpec inputSpec(size_t index) {
+  switch (static_cast<GpioInput>(index)) {
+  case GpioInput::Interlock:
+    return {AmustConfig::kGpioInterlockLine, AmustConfig::kGpioInterlockActiveLow};
+  case GpioInput::EmergencyStop:
+    return {AmustConfig::kGpioEstopLine, AmustConfig::kGpioEstopActiveLow};
+  case GpioInput::Footswitch:
+    return {AmustConfig::kGpioFootswitchLine, AmustConfig::kGpioFootswitchActiveLow};
+  }
+  return {-1, false};
+}
+
+int64_t monotonicNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+} // namespace
+
+struct GpiodInputSource::Impl {
+  int offsets[kGpioInputCount] = {-1, -1, -1};
+  bool initial[kGpioInputCount] = {};
+#if defined(AMUST_HAVE_GPIOD)
+  gpiod_chip *chip = nullptr;
+#if defined(AMUST_GPIOD_LEGACY_API)
+  gpiod_line *lines[kGpioInputCount] = {};
+  bool lastLevel[kGpioInputCount] = {};
+  int epollFd = -1;
+#else
+  gpiod_line_request *request = nullptr;
+  gpiod_edge_event_buffer *buffer = nullptr;
+#endif
+#endif
+
+  void release() {
+#if defined(AMUST_HAVE_GPIOD)
+#if defined(AMUST_GPIOD_LEGACY_API)
+    for (gpiod_line *&line : lines) {
+      if (line)
+        gpiod_line_release(line);
+      line = nullptr;
+    }
+    if (epollFd >= 0)
+      ::close(epollFd);
+    epollFd = -1;
+#else
+    if (buffer)
+      gpiod_edge_event_buffer_free(buffer);
+    buffer = nullptr;
+    if (request)
+      gpiod_line_request_release(request);
+    request = nullptr;
+#endif
+    if (chip)
+      gpiod_chip_close(chip);
+    chip = nullptr;
+#endif
+  }
+};
+
+GpiodInputSource::GpiodInputSource() : impl_(std::make_unique<Impl>()) {}
+
+GpiodInputSource::~GpiodInputSource() {
+  impl_->release();
+}
+
+bool GpiodInputSource::open() {
+  impl_->release();
+  bool any = false;
+  for (size_t i = 0; i < kGpioInputCount; i++) {
+    impl_->offsets[i] = inputSpec(i).line;
+    any = any || impl_->offsets[i] >= 0;
+  }
+  if (!any)
+    return false;
+
+#if defined(AMUST_HAVE_GPIOD)
+  const char *consumer = "amust_inputs";
+  impl_->chip = openAmustGpioChip();
+  if (!impl_->chip)
+    return false;
+
+  bool ok = true;
+#if defined(AMUST_GPIOD_LEGACY_API)
+  impl_->epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+  ok = impl_->epollFd >= 0;
+  for (size_t i = 0; ok && i < kGpioInputCount; i++) {
+    if (impl_->offsets[i] < 0)
+      continue;
+    gpiod_line *line = gpiod_chip_get_line(impl_->chip, static_cast<unsigned int>(impl_->offsets[i]));
+    gpiod_line_request_config config{};
+    config.consumer = consumer;
+    config.request_type = GPIOD_LINE_REQUEST_EVENT_BOTH_EDGES;
+    config.flags = inputSpec(i).activeLow ? GPIOD_LINE_REQUEST_FLAG_ACTIVE_LOW : 0;
+    if (!line || gpiod_line_request(line, &config, 0) < 0) {
+      ok = false;
+      break;
+    }
+    impl_->lines[i] = line;
+    impl_->initial[i] = gpiod_line_get_value(line) == 1;
+    impl_->lastLevel[i] = impl_->initial[i];
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLPRI;
+    ev.data.u32 = static_cast<uint32_t>(i);
+    ok = ::epoll_ctl(impl_->epollFd, EPOLL_CTL_ADD, gpiod_line_event_get_fd(line), &ev) == 0;
+  }
+#else
+  gpiod_line_config *lineCfg = gpiod_line_config_new();
+  gpiod_request_config *requestCfg = gpiod_request_config_new();
+  ok = lineCfg && requestCfg;
+  for (size_t i = 0; ok && i < kGpioInputCount; i++) {
+    if (impl_->offsets[i] < 0)
+      continue;
+    gpiod_line_settings *settings = gpiod_line_settings_new();
+    ok = settings != nullptr;
+    if (ok) {
+      gpiod_line_settings_set_direction(settings, GPIOD_LINE_DIRECTION_INPUT);
+      gpiod_line_settings_set_edge_detection(settings, GPIOD_LINE_EDGE_BOTH);
+      gpiod_line_settings_set_active_low(settings, inputSpec(i).activeLow);
+      gpiod_line_settings_set_debounce_period_us(
+          settings, static_cast<unsigned long>(AmustConfig::kGpioInputDebounceUs));
+      gpiod_line_settings_set_event_clock(settings, GPIOD_LINE_CLOCK_MONOTONIC);
+      const unsigned int offset = static_cast<unsigned int>(impl_->offsets[i]);
+      ok = gpiod_line_config_add_line_settings(lineCfg, &offset, 1, settings) == 0;
+      gpiod_line_settings_free(settings);
+    }
+  }
+  if (ok) {
+    gpiod_request_config_set_consumer(requestCfg, consumer);
+    impl_->request = gpiod_chip_request_lines(impl_->chip, requestCfg, lineCfg);
+    impl_->buffer = gpiod_edge_event_buffer_new(kEventBatch);
+    ok = impl_->request && impl_->buffer;
+  }
+  for (size_t i = 0; ok && i < kGpioInputCount; i++) {
+    if (impl_->offsets[i] >= 0)
+      impl_->initial[i] = gpiod_line_request_get_value(
+                              impl_->request, static_cast<unsigned int>(impl_->offsets[i])) ==
+                          GPIOD_LINE_VALUE_ACTIVE;
+  }
+  if (lineCfg)
+    gpiod_line_config_free(lineCfg);
+  if (requestCfg)
+    gpiod_request_config_free(requestCfg);
+#endif
+  if (!ok) {
+    qWarning() << "GPIO: failed to request input lines";
+    impl_->release();
+    return false;
+  }
+  qInfo() << "GPIO: inputs interlock" << impl_->offsets[0] << "e-stop" << impl_->offsets[1]
+          << "footswitch" << impl_->offsets[2];
+  return true;
+#else
+  qWarning() << "GPIO: inputs configured but libgpiod is not enabled";
+  return false;
+#endif
+}
+
+int GpiodInputSource::fd() const {
+#if defined(AMUST_HAVE_GPIOD)
+#if defined(AMUST_GPIOD_LEGACY_API)
+  return impl_->epollFd;
+#else
+  return impl_->request ? gpiod_line_request_get_fd(impl_->request) : -1;
+#endif
+#else
+  return -1;
+#endif
+}
+
+size_t GpiodInputSource::readEvents(GpioInputEvent *out, size_t max) {
+  size_t count = 0;
+#if defined(AMUST_HAVE_GPIOD)
+#if defined(AMUST_GPIOD_LEGACY_API)
+  if (impl_->epollFd < 0)
+    return 0;
+  epoll_event ready[kGpioInputCount];
+  const int n = ::epoll_wait(impl_->epollFd, ready, kGpioInputCount, 0);
+  for (int k = 0; k < n && count < max; k++) {
+    const size_t i = ready[k].data.u32;
+    gpiod_line_event event{};
+    if (gpiod_line_event_read(impl_->lines[i], &event) < 0)
+      continue;
+    const bool asserted = event.event_type == GPIOD_LINE_EVENT_RISING_EDGE;
+    if (asserted == impl_->lastLevel[i])
+      continue;
+    impl_->lastLevel[i] = asserted;
+    out[count++] = {static_cast<GpioInput>(i), asserted,
+                    static_cast<int64_t>(event.ts.tv_sec) * 1'000'000'000 + event.ts.tv_nsec};
+  }
+#else
+  if (!impl_->request || gpiod_line_request_wait_edge_events(impl_->request, 0) <= 0)
+    return 0;
+  const int n = gpiod_line_request_read_edge_events(impl_->request, impl_->buffer,
+                                                     std::min(max, kEventBatch));
+  for (int k = 0; k < n; k++) {
+    gpiod_edge_event *event = gpiod_edge_event_buffer_get_event(impl_->buffer, k);
+    const int offset = static_cast<int>(gpiod_edge_event_get_line_offset(event));
+    for (size_t i = 0; i < kGpioInputCount; i++) {
+      if (impl_->offsets[i] != offset)
+        continue;
+      out[count++] = {static_cast<GpioInput>(i),
+                      gpiod_edge_event_get_event_type(event) == GPIOD_EDGE_EVENT_RISING_EDGE,
+                      static_cast<int64_t>(gpiod_edge_event_get_timestamp_ns(event))};
+      break;
+    }
+  }
+#endif
+#else
+  Q_UNUSED(out);
+  Q_UNUSED(max);
+#endif
+  return count;
+}
+
+bool GpiodInputSource::initiallyAsserted(GpioInput input) const {
+  return impl_->initial[static_cast<size_t>(input)];
+}
+
+bool GpiodInputSource::isFitted(GpioInput input) const {
+  return impl_->offsets[static_cast<size_t>(input)] >= 0;
+}
+
+SimulatedGpioInputs::SimulatedGpioInputs() {
+#if defined(__linux__)
+  eventFd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+#endif
+}
+
+SimulatedGpioInputs::~SimulatedGpioInputs() {
+#if defined(__linux__)
+  if (eventFd_ >= 0)
+    ::close(eventFd_);
+#endif
+}
+
+void SimulatedGpioInputs::inject(GpioInput input, bool asserted) {
+  if (!events_.push({input, asserted, monotonicNowNs()}))
+    return;
+#if defined(__linux__)
+  if (eventFd_ >= 0) {
+    const uint64_t one = 1;
+    (void)::write(eventFd_, &one, sizeof(one));
+  }
+#endif
+}
+
+size_t SimulatedGpioInputs::readEvents(GpioInputEvent *out, size_t max) {
+#if defined(__linux__)
+  if (eventFd_ >= 0) {
+    uint64_t pending = 0;
+    (void)::read(eventFd_, &pending, sizeof(pending));
+  }
+#endif
+  size_t count = 0;
+  while (count < max && events_.pop(out[count]))
+    count++;
+  return count;
+}
+
+bool SimulatedGpioInputs::initiallyAsserted(GpioInput input) const {
+  Q_UNUSED(input);
+  return false;
+}
+
+bool SimulatedGpioInputs::isFitted(GpioInput input) const {
+  Q_UNUSED(input);
+  return true;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "hw/spsc_ring.h"
+
+enum class GpioInput : uint8_t { Interlock, EmergencyStop, Footswitch };
+inline constexpr size_t kGpioInputCount = 3;
+
+struct GpioInputEvent {
+  GpioInput input = GpioInput::Interlock;
+  bool asserted = false;   // interlock open, e-stop or footswitch pressed
+  int64_t timestampNs = 0; // CLOCK_MONOTONIC of the edge
+};
+
+// Debounced input edges. fd() becomes readable when events are pending, so
+// the GPIO thread can poll it next to its other descriptors; readEvents()
+// never blocks.
+class GpioInputSource {
+public:
+  virtual ~GpioInputSource() = default;
+
+  virtual const char *name() const = 0;
+  virtual int fd() const = 0;
+  virtual size_t readEvents(GpioInputEvent *out, size_t max) = 0;
+  // Level sampled when the source was opened.
+  virtual bool initiallyAsserted(GpioInput input) const = 0;
+  virtual bool isFitted(GpioInput input) const = 0;
+};
+
+// The AmustConfig::kGpio*Line inputs via libgpiod edge events. v2 debounces
+// in the kernel (kGpioInputDebounceUs); v1 cannot, so there only edges that
+// repeat the last reported level are dropped. Consumers act on the first
+// assertion and ignore repeats either way.
+class GpiodInputSource final : public GpioInputSource {
+public:
+  GpiodInputSource();
+  ~GpiodInputSource() override;
+
+  GpiodInputSource(const GpiodInputSource &) = delete;
+  GpiodInputSource &operator=(const GpiodInputSource &) = delete;
+
+  // False if no input is configured or the lines cannot be requested.
+  bool open();
+
+  const char *name() const override { return "gpiod"; }
+  int fd() const override;
+  size_t readEvents(GpioInputEvent *out, size_t max) override;
+  bool initiallyAsserted(GpioInput input) const override;
+  bool isFitted(GpioInput input) const override;
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+// In-memory inputs for development and tests (AMUST_GPIO_INPUTS=sim). All
+// inputs are fitted and start deasserted; inject() may be called from one
+// thread other than the reader.
+class SimulatedGpioInputs final : public GpioInputSource {
+public:
+  SimulatedGpioInputs();
+  ~SimulatedGpioInputs() override;
+
+  SimulatedGpioInputs(const SimulatedGpioInputs &) = delete;
+  SimulatedGpioInputs &operator=(const SimulatedGpioInputs &) = delete;
+
+  void inject(GpioInput input, bool asserted);
+
+  const char *name() const override { return "sim"; }
+  int fd() const override { return eventFd_; }
+  size_t readEvents(GpioInputEvent *out, size_t max) override;
+  bool initiallyAsserted(GpioInput input) const override;
+  bool isFitted(GpioInput input) const override;
+
+private:
+  SpscRing<GpioInputEvent, 64> events_;
+  int eventFd_ = -1;
+};
@@ -0,0 +1,575 @@
+#include "gpio_output_thread.h"
+
+#include <QByteArray>
+#include <QDebug>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include "amust_config.h"
+#include "gpio_backend.h"
+
+namespace {
+// Stack touched up front so the locked thread never faults it in later.
+constexpr size_t kStackPrefaultBytes = 64 * 1024;
+// Without eventfd the thread polls the queue at this interval.
+constexpr auto kFallbackPollInterval = std::chrono::milliseconds(1);
+
+#if defined(__linux__)
+// The RLIMIT_MEMLOCK that applies to the mlock() calls, for the log.
+QByteArray memlockLimitText() {
+  rlimit limit{};
+  if (::getrlimit(RLIMIT_MEMLOCK, &limit) != 0)
+    return "unknown";
+  if (limit.rlim_cur == RLIM_INFINITY)
+    return "unlimited";
+  return QByteArray::number(qulonglong(limit.rlim_cur / 1024)) + " KiB";
+}
+#endif
+
+// AMUST_PWM_CHANNELS ("laser=0:0,led1=0:1"; outputs not named get none),
+// else AmustConfig::kPwm*.
+std::array<AmustConfig::PwmChannelConfig, kPwmOutputCount> pwmChannels() {
+  std::array<AmustConfig::PwmChannelConfig, kPwmOutputCount> channels = {
+      AmustConfig::kPwmLaser, AmustConfig::kPwmLed1, AmustConfig::kPwmLed2};
+  const std::string env = qgetenv("AMUST_PWM_CHANNELS").trimmed().toLower().toStdString();
+  if (env.empty())
+    return channels;
+  channels.fill({-1, 0});
+  constexpr const char *kNames[kPwmOutputCount] = {"laser", "led1", "led2"};
+  size_t begin = 0;
+  while (begin < env.size()) {
+    const size_t end = std::min(env.find(',', begin), env.size());
+    const std::string entry = env.substr(begin, end - begin);
+    begin = end + 1;
+    char name[8] = {};
+    AmustConfig::PwmChannelConfig channel{};
+    bool known = false;
+    if (std::sscanf(entry.c_str(), "%7[a-z0-9]=%d:%d", name, &channel.chip, &channel.channel) ==
+            3 &&
+        channel.chip >= 0 && channel.channel >= 0) {
+      for (size_t i = 0; i < kPwmOutputCount; i++) {
+        if (std::strcmp(name, kNames[i]) == 0) {
+          channels[i] = channel;
+          known = true;
+        }
+      }
+    }
+    if (!known)
+      qWarning() << "GPIO: ignoring AMUST_PWM_CHANNELS entry" << entry.c_str();
+  }
+  return channels;
+}
+
+int64_t monotonicNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+} // namespace
+
+GpioOutputThread::GpioOutputThread(QObject *parent) : GpioOutputThread(nullptr, parent) {}
+
+GpioOutputThread::GpioOutputThread(std::unique_ptr<GpioBackend> backend, QObject *parent)
+    : QThread(parent), gpio_(std::move(backend)) {
+  setObjectName(QStringLiteral("gpio-output"));
+#if defined(__linux__)
+  wakeFd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (wakeFd_ < 0)
+    qWarning() << "GPIO: eventfd failed; output thread will poll";
+  notifyFd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+#endif
+  openInputs();
+  openPwm();
+}
+
+void GpioOutputThread::openPwm() {
+  const auto channels = pwmChannels();
+  for (size_t i = 0; i < kPwmOutputCount; i++) {
+    if (channels[i].chip < 0)
+      continue;
+    auto channel = std::make_unique<SysfsPwmChannel>();
+    if (!channel->open(channels[i].chip, channels[i].channel,
+                       int64_t{AmustConfig::kPwmDefaultPeriodUs} * 1000)) {
+      qWarning() << "GPIO: PWM channel" << channels[i].chip << channels[i].channel
+                 << "unavailable; output" << i << "uses software PWM";
+      continue;
+    }
+    hardPwm_[i] = std::move(channel);
+  }
+}
+
+void GpioOutputThread::openInputs() {
+  const QByteArray mode = qgetenv("AMUST_GPIO_INPUTS").toLower();
+  if (mode == "off")
+    return;
+  if (mode == "sim") {
+    auto sim = std::make_unique<SimulatedGpioInputs>();
+    simulatedInputs_ = sim.get();
+    inputs_ = std::move(sim);
+    qInfo() << "GPIO: simulated inputs";
+  } else {
+    auto gpiod = std::make_unique<GpiodInputSource>();
+    if (!gpiod->open())
+      return;
+    inputs_ = std::move(gpiod);
+  }
+  for (size_t i = 0; i < kGpioInputCount; i++)
+    asserted_[i].store(inputs_->initiallyAsserted(static_cast<GpioInput>(i)),
+                       std::memory_order_relaxed);
+  if (safetyTripped())
+    qWarning() << "GPIO: interlock open or e-stop pressed at start-up";
+}
+
+bool GpioOutputThread::isAsserted(GpioInput input) const {
+  return asserted_[static_cast<size_t>(input)].load(std::memory_order_acquire);
+}
+
+bool GpioOutputThread::safetyTripped() const {
+  return isAsserted(GpioInput::Interlock) || isAsserted(GpioInput::EmergencyStop);
+}
+
+GpioOutputThread::~GpioOutputThread() {
+  stopAndWait();
+#if defined(__linux__)
+  if (wakeFd_ >= 0)
+    ::close(wakeFd_);
+  if (notifyFd_ >= 0)
+    ::close(notifyFd_);
+#endif
+}
+
+void GpioOutputThread::stopAndWait() {
+  if (!isRunning())
+    return;
+  requestInterruption();
+  wake();
+  wait();
+  gpio_.setAllOff();
+  for (const auto &channel : hardPwm_) {
+    if (channel)
+      channel->close();
+  }
+
+  const GpioLatencyStats st = latency();
+  if (st.count > 0) {
+    qInfo().nospace() << "GPIO: " << st.count << " output changes, latency p50 " << st.p50Us
+                      << " us p99 " << st.p99Us << " us max " << st.maxUs << " us"
+                      << (isRealtime() ? " (SCHED_FIFO)" : " (normal priority)");
+  }
+  const GpioLatencyStats safety = safetyLatency();
+  if (safety.count > 0) {
+    qInfo().nospace() << "GPIO: " << safety.count << " safety edges, edge-to-off p50 "
+                      << safety.p50Us << " us p99 " << safety.p99Us << " us max " << safety.maxUs
+                      << " us";
+  }
+}
+
+bool GpioOutputThread::startExposure(int64_t durationNs) {
+  Command command;
+  command.kind = Command::Kind::Start;
+  command.durationNs = durationNs;
+  command.startSeq = startsRequested_ + 1;
+  if (!enqueue(command))
+    return false;
+  startsRequested_ = command.startSeq;
+  return true;
+}
+
+bool GpioOutputThread::pauseExposure() {
+  Command command;
+  command.kind = Command::Kind::Pause;
+  return enqueue(command);
+}
+
+bool GpioOutputThread::resumeExposure() {
+  Command command;
+  command.kind = Command::Kind::Resume;
+  return enqueue(command);
+}
+
+bool GpioOutputThread::stopExposure() {
+  Command command;
+  command.kind = Command::Kind::Stop;
+  return enqueue(command);
+}
+
+bool GpioOutputThread::setPwm(PwmOutput output, PwmSetting setting) {
+  const size_t index = static_cast<size_t>(output);
+  const int64_t minPeriodNs = int64_t{AmustConfig::kPwmSoftMinPeriodUs} * 1000;
+  if (!hardPwm_[index] && setting.isModulated() && setting.periodNs < minPeriodNs) {
+    setting.dutyNs = setting.dutyNs * minPeriodNs / setting.periodNs;
+    setting.periodNs = minPeriodNs;
+  }
+  if (setting == lastPwm_[index])
+    return true;
+  Command command;
+  command.kind = Command::Kind::Pwm;
+  command.pwmOutput = output;
+  command.pwm = setting;
+  if (!enqueue(command))
+    return false;
+  lastPwm_[index] = setting;
+  return true;
+}
+
+bool GpioOutputThread::enqueue(const Command &command) {
+  Command stamped = command;
+  stamped.submittedNs = monotonicNowNs();
+  if (!commands_.push(stamped)) {
+    qWarning() << "GPIO: output command queue full";
+    return false;
+  }
+  wake();
+  return true;
+}
+
+GpioOutputThread::PublishedExposure GpioOutputThread::readExposure() const {
+  PublishedExposure out;
+  uint32_t seq = 0;
+  do {
+    seq = exposureSeq_.load(std::memory_order_acquire);
+    out.start = exposureStart_.load(std::memory_order_relaxed);
+    out.active = exposureActive_.load(std::memory_order_relaxed);
+    out.closedNs = exposureClosedNs_.load(std::memory_order_relaxed);
+    out.onSinceNs = exposureOnSinceNs_.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+  } while ((seq & 1u) != 0 || seq != exposureSeq_.load(std::memory_order_relaxed));
+  return out;
+}
+
+int64_t GpioOutputThread::exposureDeliveredNs() const {
+  const PublishedExposure published = readExposure();
+  // Until the latest start is taken, the figures are the previous session's.
+  if (published.start != startsRequested_)
+    return 0;
+  return published.closedNs +
+         (published.onSinceNs != 0 ? monotonicNowNs() - published.onSinceNs : 0);
+}
+
+bool GpioOutputThread::exposureActive() const {
+  const PublishedExposure published = readExposure();
+  return published.start != startsRequested_ || published.active;
+}
+
+void GpioOutputThread::publishExposure() {
+  const int64_t nowNs = monotonicNowNs();
+  const int64_t onSinceNs = exposure_.isExposing() ? nowNs : 0;
+  const int64_t closedNs = exposure_.deliveredNs(nowNs);
+  exposureSeq_.fetch_add(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  exposureStart_.store(startSeq_, std::memory_order_relaxed);
+  exposureActive_.store(exposure_.isActive(), std::memory_order_relaxed);
+  exposureClosedNs_.store(closedNs, std::memory_order_relaxed);
+  exposureOnSinceNs_.store(onSinceNs, std::memory_order_relaxed);
+  exposureSeq_.fetch_add(1, std::memory_order_release);
+}
+
+void GpioOutputThread::wake() {
+#if defined(__linux__)
+  if (wakeFd_ >= 0) {
+    const uint64_t one = 1;
+    (void)::write(wakeFd_, &one, sizeof(one));
+  }
+#endif
+}
+
+void GpioOutputThread::notifyGui() {
+#if defined(__linux__)
+  if (notifyFd_ >= 0) {
+    const uint64_t one = 1;
+    (void)::write(notifyFd_, &one, sizeof(one));
+  }
+#endif
+}
+
+void GpioOutputThread::acknowledgeNotify() {
+#if defined(__linux__)
+  if (notifyFd_ >= 0) {
+    uint64_t count = 0;
+    (void)::read(notifyFd_, &count, sizeof(count));
+  }
+#endif
+}
+
+void GpioOutputThread::enterRealtime() {
+#if defined(__linux__)
+  volatile uint8_t stack[kStackPrefaultBytes];
+  for (size_t i = 0; i < kStackPrefaultBytes; i += 4096)
+    stack[i] = 0;
+
+  if (AmustConfig::kGpioRtLockMemory) {
+    // Only what this thread touches: the stack just faulted in (the frames
+    // below run() reuse it) and the object holding the queues and
+    // histograms. mlockall() would pin every page of the Qt process.
+    const QByteArray limitText = memlockLimitText();
+    const size_t lockedBytes = sizeof(stack) + sizeof(*this);
+    if (::mlock(const_cast<uint8_t *>(stack), sizeof(stack)) == 0 &&
+        ::mlock(this, sizeof(*this)) == 0) {
+      qInfo().nospace() << "GPIO: locked " << lockedBytes / 1024
+                        << " KiB of stack and queues (RLIMIT_MEMLOCK " << limitText.constData()
+                        << ")";
+    } else {
+      qWarning().nospace() << "GPIO: mlock failed: " << std::strerror(errno)
+                           << " (RLIMIT_MEMLOCK " << limitText.constData() << ", needs "
+                           << lockedBytes / 1024 << " KiB)";
+    }
+  }
+
+  if (AmustConfig::kGpioRtPriority > 0) {
+    sched_param param{};
+    param.sched_priority = AmustConfig::kGpioRtPriority;
+    const int err = ::pthread_setschedparam(::pthread_self(), SCHED_FIFO, &param);
+    if (err == 0)
+      realtime_.store(true, std::memory_order_release);
+    else
+      qWarning() << "GPIO: SCHED_FIFO unavailable (" << std::strerror(err)
+                 << "); output thread runs at normal priority";
+  }
+#endif
+}
+
+void GpioOutputThread::waitForEvent() {
+#if defined(__linux__)
+  const int inputFd = inputs_ ? inputs_->fd() : -1;
+  if (wakeFd_ >= 0 && (!inputs_ || inputFd >= 0)) {
+    // Unused slots keep fd -1, which poll() ignores.
+    pollfd fds[4] = {{wakeFd_, POLLIN, 0},
+                     {exposure_.timerFd(), POLLIN, 0},
+                     {inputFd, POLLIN, 0},
+                     {softPwm_.timerFd(), POLLIN, 0}};
+    int64_t wakeAtNs = 0;
+    if (exposure_.timerFd() < 0 && exposure_.isExposing())
+      wakeAtNs = exposure_.deadlineNs();
+    if (softPwm_.timerFd() < 0 && softPwm_.nextEdgeNs() > 0 &&
+        (wakeAtNs == 0 || softPwm_.nextEdgeNs() < wakeAtNs))
+      wakeAtNs = softPwm_.nextEdgeNs();
+    int timeoutMs = -1;
+    if (wakeAtNs > 0) {
+      const int64_t leftNs = wakeAtNs - monotonicNowNs();
+      timeoutMs = static_cast<int>(std::max<int64_t>(0, (leftNs + 999'999) / 1'000'000));
+    }
+    if (::poll(fds, 4, timeoutMs) > 0) {
+      if (fds[2].revents & POLLIN)
+        serviceInputs();
+      if (fds[0].revents & POLLIN) {
+        uint64_t wakeups = 0;
+        (void)::read(wakeFd_, &wakeups, sizeof(wakeups));
+      }
+      if (fds[1].revents & POLLIN)
+        exposure_.acknowledgeTimer(monotonicNowNs());
+      if (fds[3].revents & POLLIN)
+        softPwm_.acknowledgeTimer();
+    }
+    // A PWM edge is due (timer or poll timeout): write the new levels.
+    if (softPwm_.nextEdgeNs() > 0 && monotonicNowNs() >= softPwm_.nextEdgeNs())
+      drive(exposure_.isExposing(), 0);
+    return;
+  }
+#endif
+  QThread::usleep(static_cast<unsigned long>(
+      std::chrono::duration_cast<std::chrono::microseconds>(kFallbackPollInterval).count()));
+  if (inputs_)
+    serviceInputs();
+}
+
+void GpioOutputThread::serviceInputs() {
+  GpioInputEvent events[8];
+  size_t count = 0;
+  while ((count = inputs_->readEvents(events, 8)) > 0) {
+    for (size_t k = 0; k < count; k++) {
+      const GpioInputEvent &event = events[k];
+      asserted_[static_cast<size_t>(event.input)].store(event.asserted,
+                                                         std::memory_order_release);
+      const bool safety =
+          event.input == GpioInput::Interlock || event.input == GpioInput::EmergencyStop;
+      if (safety && event.asserted) {
+        int64_t offNs = monotonicNowNs();
+        if (exposure_.isActive()) {
+          offNs = drive(false, 0);
+          ExposureReport report = finishExposure(offNs, false);
+          report.interlocked = true;
+          reports_.push(report);
+          publishExposure();
+        }
+        safetyLatency_.record(offNs - event.timestampNs);
+      }
+      inputEvents_.push(event);
+    }
+    notifyGui();
+  }
+}
+
+void GpioOutputThread::run() {
+  enterRealtime();
+
+  while (!isInterruptionRequested()) {
+    // The deadline first: a late command must not delay the falling edge.
+    if (exposure_.expired(monotonicNowNs()))
+      expireExposure();
+
+    Command command;
+    bool any = false;
+    while (commands_.pop(command)) {
+      handle(command);
+      any = true;
+    }
+    if (!any)
+      waitForEvent();
+  }
+}
+
+void GpioOutputThread::handle(const Command &command) {
+  switch (command.kind) {
+  case Command::Kind::Start:
+    if (exposure_.isActive())
+      reports_.push(finishExposure(drive(false, 0), false));
+    if (safetyTripped()) {
+      ExposureReport refused;
+      refused.requestedNs = command.durationNs;
+      refused.errorNs = -command.durationNs;
+      refused.interlocked = true;
+      refused.startSeq = command.startSeq;
+      reports_.push(refused);
+      break;
+    }
+    exposure_.start(command.durationNs, drive(true, command.submittedNs));
+    startSeq_ = command.startSeq;
+    break;
+  case Command::Kind::Pause:
+    if (!exposure_.isExposing())
+      return;
+    exposure_.pause(drive(false, command.submittedNs));
+    break;
+  case Command::Kind::Resume:
+    if (!exposure_.isActive() || exposure_.isExposing() || safetyTripped())
+      return;
+    exposure_.resume(drive(true, command.submittedNs));
+    break;
+  case Command::Kind::Stop:
+    if (!exposure_.isActive())
+      return;
+    reports_.push(finishExposure(drive(false, command.submittedNs), false));
+    break;
+  case Command::Kind::Pwm:
+    softPwm_.set(command.pwmOutput, command.pwm, command.submittedNs);
+    drive(exposure_.isExposing(), command.submittedNs);
+    return;
+  }
+  publishExposure();
+  // Start and stop may have queued a report; pause and resume wake the GUI
+  // for nothing, which is rare enough not to matter.
+  notifyGui();
+}
+
+void GpioOutputThread::expireExposure() {
+  reports_.push(finishExposure(drive(false, 0), true));
+  publishExposure();
+  notifyGui();
+}
+
+ExposureReport GpioOutputThread::finishExposure(int64_t offEdgeNs, bool completed) {
+  ExposureReport report = exposure_.finish(offEdgeNs, completed);
+  report.startSeq = startSeq_;
+  return report;
+}
+
+int64_t GpioOutputThread::drive(bool exposing, int64_t submittedNs) {
+  GpioOutputs outputs;
+  if (exposing) {
+    outputs.laser = true;
+    outputs.led1 = true;
+    outputs.led2 = true;
+    outputs.xrayEnable = true;
+  }
+  applyPwm(outputs);
+  const uint64_t before = gpio_.stats().syscalls;
+  gpio_.setOutputs(outputs);
+  const int64_t edgeNs = monotonicNowNs();
+  const GpioStats st = gpio_.stats();
+  if (submittedNs > 0 && st.syscalls != before)
+    commandLatency_.record(edgeNs - submittedNs);
+  gpioUpdates_.store(st.updates, std::memory_order_relaxed);
+  gpioSyscalls_.store(st.syscalls, std::memory_order_relaxed);
+  gpioSyscallRate_.store(st.syscallsPerSecond, std::memory_order_relaxed);
+  return edgeNs;
+}
+
+void GpioOutputThread::applyPwm(GpioOutputs &outputs) {
+  const int64_t nowNs = monotonicNowNs();
+  bool *levels[kPwmOutputCount] = {&outputs.laser, &outputs.led1, &outputs.led2};
+  uint32_t modulating = 0;
+  for (size_t i = 0; i < kPwmOutputCount; i++) {
+    const auto output = static_cast<PwmOutput>(i);
+    const PwmSetting &setting = softPwm_.setting(output);
+    bool &on = *levels[i];
+    if (hardPwm_[i]) {
+      const int64_t periodNs = setting.periodNs > 0
+                                   ? setting.periodNs
+                                   : int64_t{AmustConfig::kPwmDefaultPeriodUs} * 1000;
+      const int64_t dutyNs = !on ? 0 : setting.isModulated() ? setting.dutyNs : periodNs;
+      hardPwm_[i]->apply(periodNs, dutyNs);
+      on = false; // the pin is muxed to the PWM peripheral
+    } else if (on) {
+      on = softPwm_.level(output, nowNs);
+      modulating |= 1u << i;
+    }
+  }
+  softPwm_.arm(modulating, nowNs);
+}
+
+void GpioLatencyHistogram::record(int64_t ns) {
+  const size_t bucket =
+      std::min<size_t>(static_cast<size_t>(std::max<int64_t>(0, ns) / 1000), kBuckets - 1);
+  bucketsUs_[bucket].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  if (ns > maxNs_.load(std::memory_order_relaxed))
+    maxNs_.store(ns, std::memory_order_relaxed);
+}
+
+GpioLatencyStats GpioLatencyHistogram::stats() const {
+  GpioLatencyStats st;
+  st.count = count_.load(std::memory_order_relaxed);
+  st.maxUs = maxNs_.load(std::memory_order_relaxed) / 1000;
+  if (st.count == 0)
+    return st;
+
+  const uint64_t p50Rank = (st.count + 1) / 2;
+  const uint64_t p99Rank = std::max<uint64_t>(1, (st.count * 99 + 99) / 100);
+  uint64_t seen = 0;
+  bool haveP50 = false;
+  for (size_t us = 0; us < kBuckets; us++) {
+    seen += bucketsUs_[us].load(std::memory_order_relaxed);
+    if (!haveP50 && seen >= p50Rank) {
+      st.p50Us = static_cast<int64_t>(us);
+      haveP50 = true;
+    }
+    if (seen >= p99Rank) {
+      st.p99Us = static_cast<int64_t>(us);
+      break;
+    }
+  }
+  return st;
+}
+
+GpioStats GpioOutputThread::gpioStats() const {
+  GpioStats st;
+  st.updates = gpioUpdates_.load(std::memory_order_relaxed);
+  st.syscalls = gpioSyscalls_.load(std::memory_order_relaxed);
+  st.syscallsPerSecond = gpioSyscallRate_.load(std::memory_order_relaxed);
+  return st;
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <QThread>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "exposure_engine.h"
+#include "gpio_controller.h"
+#include "gpio_inputs.h"
+#include "pwm_output.h"
+#include "hw/spsc_ring.h"
+
+struct GpioLatencyStats {
+  uint64_t count = 0;
+  int64_t p50Us = 0;
+  int64_t p99Us = 0;
+  int64_t maxUs = 0;
+};
+
+// Lock-free latency histogram: one writer, any number of readers. 1 us
+// buckets; slower samples land in the last one (maxUs stays exact).
+class GpioLatencyHistogram final {
+public:
+  void record(int64_t ns);
+  GpioLatencyStats stats() const;
+
+private:
+  static constexpr size_t kBuckets = 2048;
+
+  std::array<std::atomic<uint32_t>, kBuckets> bucketsUs_{};
+  std::atomic<uint64_t> count_{0};
+  std::atomic<int64_t> maxNs_{0};
+};
+
+// Owns the GpioController and drives it from a dedicated thread, so output
+// edges do not wait for paint or layout work on the GUI thread. The thread
+// runs SCHED_FIFO with its stack and queues locked when permitted
+// (AmustConfig::kGpioRtPriority / kGpioRtLockMemory) and blocks on an eventfd; commands
+// arrive through a lock-free ring and nothing is allocated once it runs.
+// Exposures are timed here as well: the thread arms an absolute deadline on
+// start/resume and drops the outputs from the timer wakeup itself. Input
+// edges are serviced on the same thread: an asserted interlock or e-stop ends
+// the exposure before the GUI hears of it, and refuses new ones while held.
+// Inputs come from AmustConfig::kGpio*Line (AMUST_GPIO_INPUTS=sim|off).
+// The laser and LEDs can be dimmed or pulsed (setPwm): through a kernel PWM
+// channel where AmustConfig::kPwm* (or AMUST_PWM_CHANNELS) names one, else by
+// this thread toggling the line at each edge of the wave.
+class GpioOutputThread final : public QThread {
+  Q_OBJECT
+
+public:
+  explicit GpioOutputThread(QObject *parent = nullptr);
+  // Drives `backend` instead of createGpioBackend()'s choice.
+  explicit GpioOutputThread(std::unique_ptr<GpioBackend> backend, QObject *parent = nullptr);
+  ~GpioOutputThread() override;
+
+  void stopAndWait();
+
+  // Exposure control, GUI thread only (single producer); false if the queue
+  // is full. All outputs are on while an exposure is (the laser and LEDs
+  // following their setPwm() wave) and low otherwise.
+  // Completion (or a stop) is reported through takeExposureReport(); each
+  // report carries the startSeq of the start it ends (see lastStartSeq()).
+  bool startExposure(int64_t durationNs);
+  bool pauseExposure();
+  bool resumeExposure();
+  bool stopExposure();
+
+  // GUI thread only. Takes effect while an exposure drives the output on;
+  // X-ray enable is never modulated. Software PWM periods are raised to
+  // kPwmSoftMinPeriodUs, keeping the duty ratio. Repeating the current
+  // setting is free.
+  bool setPwm(PwmOutput output, PwmSetting setting);
+  bool hasHardwarePwm(PwmOutput output) const {
+    return hardPwm_[static_cast<size_t>(output)] != nullptr;
+  }
+  // On-time delivered since the last startExposure(), from edge timestamps;
+  // 0 until the thread has acted on that start, or if it refused it. GUI
+  // thread only.
+  int64_t exposureDeliveredNs() const;
+  bool takeExposureReport(ExposureReport &out) { return reports_.pop(out); }
+  // Sequence number of the last start queued (1 for the first). GUI thread only.
+  uint32_t lastStartSeq() const { return startsRequested_; }
+  // False once the thread has ended the exposure of the last start; true
+  // while it runs, and until the thread has acted on that start (a refused
+  // one included, for which a stop is simply ignored). GUI thread only.
+  bool exposureActive() const;
+
+  bool isInitialized() const { return gpio_.isInitialized(); }
+  // Owned by the thread; only inspect thread-safe state (e.g. an edge log).
+  GpioBackend *backend() const { return gpio_.backend(); }
+  bool isRealtime() const { return realtime_.load(std::memory_order_acquire); }
+  // Command-to-edge: from the command being queued to the set-values ioctl
+  // returning.
+  GpioLatencyStats latency() const { return commandLatency_.stats(); }
+  // Safety input edge (kernel timestamp) to outputs dropped.
+  GpioLatencyStats safetyLatency() const { return safetyLatency_.stats(); }
+  GpioStats gpioStats() const;
+
+  bool isAsserted(GpioInput input) const;
+  // Interlock open or e-stop pressed: exposures are refused.
+  bool safetyTripped() const;
+  // Every input edge, after the thread has acted on it.
+  bool takeInputEvent(GpioInputEvent &out) { return inputEvents_.pop(out); }
+  // Readable whenever an input edge or exposure report has been queued, so
+  // the GUI can wait on it (QSocketNotifier) instead of polling; -1 without
+  // eventfd. acknowledgeNotify() clears it before the queues are drained.
+  int notifyFd() const { return notifyFd_; }
+  void acknowledgeNotify();
+  // Non-null with AMUST_GPIO_INPUTS=sim.
+  SimulatedGpioInputs *simulatedInputs() const { return simulatedInputs_; }
+
+protected:
+  void run() override;
+
+private:
+  struct Command {
+    enum class Kind : uint8_t { Start, Pause, Resume, Stop, Pwm };
+
+    Kind kind = Kind::Start;
+    PwmOutput pwmOutput = PwmOutput::Laser;
+    PwmSetting pwm;
+    int64_t durationNs = 0;
+    int64_t submittedNs = 0;
+    uint32_t startSeq = 0;
+  };
+
+  void enterRealtime();
+  void openInputs();
+  void openPwm();
+  // Gates `outputs` with the PWM waves and updates the hardware channels.
+  void applyPwm(GpioOutputs &outputs);
+  void serviceInputs();
+  bool enqueue(const Command &command);
+  void wake();
+  void notifyGui();
+  void waitForEvent();
+  void handle(const Command &command);
+  void expireExposure();
+  // exposure_.finish() stamped with the running exposure's startSeq_.
+  ExposureReport finishExposure(int64_t offEdgeNs, bool completed);
+  // Writes all outputs high while exposing (laser and LEDs through their
+  // PWM), else low; returns the edge time.
+  int64_t drive(bool exposing, int64_t submittedNs);
+  void publishExposure();
+  struct PublishedExposure {
+    uint32_t start = 0;
+    bool active = false;
+    int64_t closedNs = 0;
+    int64_t onSinceNs = 0;
+  };
+  PublishedExposure readExposure() const;
+
+  GpioController gpio_;
+  ExposureEngine exposure_;
+  SpscRing<Command, 64> commands_;
+  SpscRing<ExposureReport, 8> reports_;
+  int wakeFd_ = -1;
+  int notifyFd_ = -1;
+  std::atomic<bool> realtime_{false};
+
+  // Seqlock-published exposure progress (closed segments + open one), for
+  // the start with startSeq exposureStart_.
+  std::atomic<uint32_t> exposureSeq_{0};
+  std::atomic<uint32_t> exposureStart_{0};
+  std::atomic<bool> exposureActive_{false};
+  std::atomic<int64_t> exposureClosedNs_{0};
+  std::atomic<int64_t> exposureOnSinceNs_{0};
+  uint32_t startsRequested_ = 0; // GUI side
+  uint32_t startSeq_ = 0;        // thread side, of the running exposure
+
+  // Created before the thread starts, then only used by it.
+  std::array<std::unique_ptr<SysfsPwmChannel>, kPwmOutputCount> hardPwm_;
+  SoftPwm softPwm_; // also the thread's record of every output's setting
+  std::array<PwmSetting, kPwmOutputCount> lastPwm_{}; // GUI side
+
+  std::unique_ptr<GpioInputSource> inputs_;
+  SimulatedGpioInputs *simulatedInputs_ = nullptr;
+  std::array<std::atomic<bool>, kGpioInputCount> asserted_{};
+  SpscRing<GpioInputEvent, 32> inputEvents_;
+
+  GpioLatencyHistogram commandLatency_;
+  GpioLatencyHistogram safetyLatency_;
+  std::atomic<uint64_t> gpioUpdates_{0};
+  std::atomic<uint64_t> gpioSyscalls_{0};
+  std::atomic<double> gpioSyscallRate_{0.0};
+};
@@ -0,0 +1,187 @@
+#include "gpio_expander.h"
+
+#include <QDebug>
+
+#include "i2c_transport.h"
+
+namespace {
+// MCP23017 with IOCON.BANK = 0 (A/B registers interleaved).
+constexpr uint8_t kMcpIodirA = 0x00;
+constexpr uint8_t kMcpIpolA = 0x02;
+constexpr uint8_t kMcpIocon = 0x0A;
+constexpr uint8_t kMcpGpioA = 0x12;
+constexpr uint8_t kMcpOlatA = 0x14;
+// PCA9555 / TCA9555.
+constexpr uint8_t kPcaInput0 = 0x00;
+constexpr uint8_t kPcaOutput0 = 0x02;
+constexpr uint8_t kPcaPolarity0 = 0x04;
+constexpr uint8_t kPcaConfig0 = 0x06;
+
+uint8_t latchRegister(GpioExpander::Model model) {
+  return model == GpioExpander::Model::Mcp23017 ? kMcpOlatA : kPcaOutput0;
+}
+
+uint8_t inputRegister(GpioExpander::Model model) {
+  return model == GpioExpander::Model::Mcp23017 ? kMcpGpioA : kPcaInput0;
+}
+
+uint8_t polarityRegister(GpioExpander::Model model) {
+  return model == GpioExpander::Model::Mcp23017 ? kMcpIpolA : kPcaPolarity0;
+}
+
+uint8_t directionRegister(GpioExpander::Model model) {
+  return model == GpioExpander::Model::Mcp23017 ? kMcpIodirA : kPcaConfig0;
+}
+} // namespace
+
+GpioExpander::GpioExpander(I2cTransport &transport, Model model, uint8_t address)
+    : transport_(transport), model_(model), address_(address) {}
+
+bool GpioExpander::init(uint16_t outputMask, uint16_t levels) {
+  // BANK = 0, SEQOP = 0: port pairs adjacent with address auto-increment.
+  if (model_ == Model::Mcp23017) {
+    const uint8_t iocon = 0x00;
+    transactions_++;
+    if (!transport_.writeRegisters(address_, kMcpIocon, 1, &iocon, 1))
+      return false;
+  }
+  // The read-back compares the input port with the latch, so it must not
+  // be inverted.
+  if (!writePair(polarityRegister(model_), 0, 0, 2))
+    return false;
+  if (!writePair(latchRegister(model_), levels, 0, 2))
+    return false;
+  latch_ = levels;
+  // Both parts treat a set direction bit as input.
+  if (!writePair(directionRegister(model_), static_cast<uint16_t>(~outputMask), 0, 2))
+    return false;
+  outputMask_ = outputMask;
+  return true;
+}
+
+bool GpioExpander::writeOutputs(uint16_t levels, uint16_t changed, bool verify) {
+  if (changed == 0)
+    return true;
+  const int first = (changed & 0x00FF) ? 0 : 1;
+  const int count = (changed & 0xFF00) ? 2 - first : 1;
+  if (!writePair(latchRegister(model_), levels, first, count))
+    return false;
+  latch_ = levels;
+  if (!verify)
+    return true;
+
+  // The latch reads back whatever was written; the input port shows whether
+  // the pins actually follow it.
+  uint16_t readBack = 0;
+  const uint16_t bytes = static_cast<uint16_t>((count == 2 ? 0xFFFF : 0x00FF) << (8 * first));
+  const uint16_t driven = bytes & outputMask_;
+  if (!readPair(inputRegister(model_), readBack, first, count) ||
+      (readBack & driven) != (levels & driven)) {
+    verifyFailures_++;
+    return false;
+  }
+  return true;
+}
+
+bool GpioExpander::readPins(uint16_t &levels) {
+  return readPair(inputRegister(model_), levels, 0, 2);
+}
+
+bool GpioExpander::writePair(uint8_t reg, uint16_t value, int firstPort, int portCount) {
+  const uint8_t data[2] = {static_cast<uint8_t>(value >> (8 * firstPort)),
+                           static_cast<uint8_t>(value >> 8)};
+  transactions_++;
+  return transport_.writeRegisters(address_, static_cast<uint16_t>(reg + firstPort), 1, data,
+                                   static_cast<size_t>(portCount));
+}
+
+bool GpioExpander::readPair(uint8_t reg, uint16_t &value, int firstPort, int portCount) {
+  uint8_t data[2] = {};
+  transactions_++;
+  if (!transport_.readRegisters(address_, static_cast<uint16_t>(reg + firstPort), 1, data,
+                                static_cast<size_t>(portCount)))
+    return false;
+  value = firstPort == 0 ? static_cast<uint16_t>(data[0] | (portCount == 2 ? data[1] << 8 : 0))
+                         : static_cast<uint16_t>(data[0] << 8);
+  return true;
+}
+
+I2cExpanderGpioBackend::I2cExpanderGpioBackend(std::unique_ptr<I2cTransport> transport,
+                                               GpioExpander::Model model, uint8_t address)
+    : transport_(std::move(transport)), expander_(*transport_, model, address) {}
+
+I2cExpanderGpioBackend::~I2cExpanderGpioBackend() = default;
+
+const char *I2cExpanderGpioBackend::name() const {
+  return expander_.model() == GpioExpander::Model::Mcp23017 ? "mcp23017" : "pca9555";
+}
+
+bool I2cExpanderGpioBackend::request(const std::vector<int> &offsets, bool initialHigh,
+                                     const char *consumer) {
+  Q_UNUSED(consumer);
+  uint16_t outputMask = 0;
+  for (int pin : offsets) {
+    if (pin < 0 || pin >= GpioExpander::kPins) {
+      qWarning() << "GPIO: expander has no pin" << pin;
+      return false;
+    }
+    outputMask |= static_cast<uint16_t>(1u << pin);
+  }
+  const uint16_t levels = initialHigh ? outputMask : 0;
+  if (!expander_.init(outputMask, levels)) {
+    qWarning() << "GPIO:" << name() << "init failed";
+    return false;
+  }
+  pins_ = offsets;
+  return true;
+}
+
+void I2cExpanderGpioBackend::release() {
+  // Like a released gpiochip line, pins keep their last level.
+  pins_.clear();
+}
+
+bool I2cExpanderGpioBackend::write(uint32_t levels, uint32_t changed) {
+  const uint16_t pinLevels = pinMask(levels);
+  const uint16_t pinChanged = pinMask(changed);
+  const uint16_t latch =
+      static_cast<uint16_t>((expander_.outputs() & ~pinChanged) | (pinLevels & pinChanged));
+  if (expander_.writeOutputs(latch, pinChanged, true))
+    return true;
+  // A glitched or NAKed transfer: rewrite both ports once from the shadow.
+  qWarning() << "GPIO:" << name() << "latch write/read-back failed; rewriting";
+  return expander_.writeOutputs(latch, 0xFFFF, true);
+}
+
+uint16_t I2cExpanderGpioBackend::pinMask(uint32_t bits) const {
+  uint16_t mask = 0;
+  for (size_t i = 0; i < pins_.size(); i++) {
+    if ((bits >> i) & 1u)
+      mask |= static_cast<uint16_t>(1u << pins_[i]);
+  }
+  return mask;
+}
+
+void installFakeGpioExpander(FakeI2cTransport &bus, uint8_t address, GpioExpander::Model model) {
+  bus.addDevice(address);
+  const bool mcp = model == GpioExpander::Model::Mcp23017;
+  const uint8_t dirReg = directionRegister(model);
+  const uint8_t latchReg = latchRegister(model);
+  const uint8_t inputReg = inputRegister(model);
+  // Power-on state: all inputs; the PCA9555 latch resets high.
+  for (int port = 0; port < 2; port++) {
+    bus.poke(address, static_cast<uint16_t>(dirReg + port), 0xFF);
+    bus.poke(address, static_cast<uint16_t>(latchReg + port), mcp ? 0x00 : 0xFF);
+  }
+
+  FakeI2cTransport *fake = &bus;
+  bus.setReadHook(address, [fake, dirReg, latchReg, inputReg](uint8_t addr, uint16_t reg,
+                                                              uint8_t &value) {
+    if (reg != inputReg && reg != inputReg + 1)
+      return;
+    const int port = reg - inputReg;
+    const uint8_t dir = fake->peek(addr, static_cast<uint16_t>(dirReg + port));
+    const uint8_t latch = fake->peek(addr, static_cast<uint16_t>(latchReg + port));
+    value = static_cast<uint8_t>((latch & ~dir) | (value & dir));
+  });
+}
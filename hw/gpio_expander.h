@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "gpio_backend.h"
+
+class I2cTransport;
+class FakeI2cTransport;
+
+// 16-pin I2C port expander, MCP23017 (IOCON.BANK = 0) or PCA9555. Both keep
+// the two 8-bit ports in adjacent registers and auto-increment within the
+// pair, so the output latch (or input port) of all 16 pins is written (or
+// read) in a single 2-byte transaction.
+class GpioExpander final {
+public:
+  enum class Model { Mcp23017, Pca9555 };
+
+  static constexpr int kPins = 16;
+
+  GpioExpander(I2cTransport &transport, Model model, uint8_t address);
+
+  // Clears input polarity inversion, sets the output latch to `levels`, then
+  // makes `outputMask` pins outputs (the rest stay inputs) so they come up
+  // at the right level.
+  bool init(uint16_t outputMask, uint16_t levels);
+  // Writes only the latch bytes that `changed` touches: one transaction of
+  // one or two bytes. With `verify` the same bytes of the input port are
+  // read back and their output pins compared: the pin levels, not the latch
+  // just written.
+  bool writeOutputs(uint16_t levels, uint16_t changed, bool verify);
+  // All 16 pin levels from the input port.
+  bool readPins(uint16_t &levels);
+
+  Model model() const { return model_; }
+  uint16_t outputs() const { return latch_; }
+  uint64_t transactionCount() const { return transactions_; }
+  uint64_t verifyFailures() const { return verifyFailures_; }
+
+private:
+  bool writePair(uint8_t reg, uint16_t value, int firstPort, int portCount);
+  bool readPair(uint8_t reg, uint16_t &value, int firstPort, int portCount);
+
+  I2cTransport &transport_;
+  Model model_;
+  uint8_t address_;
+  uint16_t latch_ = 0;
+  uint16_t outputMask_ = 0;
+  uint64_t transactions_ = 0;
+  uint64_t verifyFailures_ = 0;
+};
+
+// Outputs on a GpioExpander; offsets are expander pins. Every write is one
+// latch transaction followed by a read-back of the pins; a mismatch is
+// rewritten once in full before the write is reported as failed.
+class I2cExpanderGpioBackend final : public GpioBackend {
+public:
+  I2cExpanderGpioBackend(std::unique_ptr<I2cTransport> transport, GpioExpander::Model model,
+                         uint8_t address);
+  ~I2cExpanderGpioBackend() override;
+
+  const char *name() const override;
+  bool isExpander() const override { return true; }
+  bool request(const std::vector<int> &offsets, bool initialHigh, const char *consumer) override;
+  void release() override;
+  bool write(uint32_t levels, uint32_t changed) override;
+
+  const GpioExpander &expander() const { return expander_; }
+
+private:
+  uint16_t pinMask(uint32_t bits) const;
+
+  std::unique_ptr<I2cTransport> transport_;
+  GpioExpander expander_;
+  std::vector<int> pins_;
+};
+
+// Makes `bus` answer like a powered-up expander at `address`: pins that are
+// outputs read back their latch on the input port.
+void installFakeGpioExpander(FakeI2cTransport &bus, uint8_t address, GpioExpander::Model model);
@@ -0,0 +1,183 @@
+#include "i2c_transport.h"
+
+#include <array>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <linux/i2c-dev.h>
+#include <linux/i2c.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+// Largest single write we issue (VL53L1X default config blob is 91 bytes).
+constexpr size_t kMaxWritePayload = 128;
+
+size_t encodeIndex(uint16_t reg, int indexBytes, uint8_t *out) {
+  if (indexBytes == 2) {
+    out[0] = static_cast<uint8_t>(reg >> 8);
+    out[1] = static_cast<uint8_t>(reg & 0xFF);
+    return 2;
+  }
+  if (indexBytes == 1) {
+    out[0] = static_cast<uint8_t>(reg & 0xFF);
+    return 1;
+  }
+  return 0;
+}
+} // namespace
+
+int parseI2cBus(const std::string &arg) {
+  std::string s = arg;
+  const std::string prefix = "/dev/i2c-";
+  if (s.compare(0, prefix.size(), prefix) == 0)
+    s = s.substr(prefix.size());
+  if (s.empty())
+    return -1;
+  char *end = nullptr;
+  const long bus = std::strtol(s.c_str(), &end, 10);
+  if (!end || *end != '\0' || bus < 0)
+    return -1;
+  return static_cast<int>(bus);
+}
+
+LinuxI2cTransport::~LinuxI2cTransport() {
+  close();
+}
+
+bool LinuxI2cTransport::open(int bus) {
+  close();
+#if defined(__linux__)
+  if (bus < 0)
+    return false;
+  const std::string path = "/dev/i2c-" + std::to_string(bus);
+  fd_ = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+  return fd_ >= 0;
+#else
+  (void)bus;
+  return false;
+#endif
+}
+
+void LinuxI2cTransport::close() {
+#if defined(__linux__)
+  if (fd_ >= 0)
+    ::close(fd_);
+#endif
+  fd_ = -1;
+}
+
+bool LinuxI2cTransport::writeRegisters(uint8_t address, uint16_t reg, int indexBytes,
+                                       const uint8_t *data, size_t len) {
+#if defined(__linux__)
+  if (fd_ < 0 || len > kMaxWritePayload)
+    return false;
+  std::array<uint8_t, kMaxWritePayload + 2> buf{};
+  const size_t idx = encodeIndex(reg, indexBytes, buf.data());
+  if (len > 0)
+    std::memcpy(buf.data() + idx, data, len);
+
+  i2c_msg msg{};
+  msg.addr = address;
+  msg.flags = 0;
+  msg.len = static_cast<uint16_t>(idx + len);
+  msg.buf = buf.data();
+  i2c_rdwr_ioctl_data xfer{&msg, 1};
+  return ::ioctl(fd_, I2C_RDWR, &xfer) == 1;
+#else
+  (void)address;
+  (void)reg;
+  (void)indexBytes;
+  (void)data;
+  (void)len;
+  return false;
+#endif
+}
+
+bool LinuxI2cTransport::readRegisters(uint8_t address, uint16_t reg, int indexBytes, uint8_t *out,
+                                      size_t len) {
+#if defined(__linux__)
+  if (fd_ < 0 || len == 0 || len > 0xFFFF)
+    return false;
+  uint8_t index[2] = {0, 0};
+  const size_t idx = encodeIndex(reg, indexBytes, index);
+
+  i2c_msg msgs[2]{};
+  uint32_t count = 0;
+  if (idx > 0) {
+    msgs[count].addr = address;
+    msgs[count].flags = 0;
+    msgs[count].len = static_cast<uint16_t>(idx);
+    msgs[count].buf = index;
+    count++;
+  }
+  msgs[count].addr = address;
+  msgs[count].flags = I2C_M_RD;
+  msgs[count].len = static_cast<uint16_t>(len);
+  msgs[count].buf = out;
+  count++;
+
+  i2c_rdwr_ioctl_data xfer{msgs, count};
+  return ::ioctl(fd_, I2C_RDWR, &xfer) == static_cast<int>(count);
+#else
+  (void)address;
+  (void)reg;
+  (void)indexBytes;
+  (void)out;
+  (void)len;
+  return false;
+#endif
+}
+
+void FakeI2cTransport::addDevice(uint8_t address) {
+  devices_[address].assign(0x10000, 0);
+}
+
+uint8_t FakeI2cTransport::peek(uint8_t address, uint16_t reg) const {
+  const auto it = devices_.find(address);
+  return it == devices_.end() ? 0 : it->second[reg];
+}
+
+void FakeI2cTransport::poke(uint8_t address, uint16_t reg, uint8_t value) {
+  const auto it = devices_.find(address);
+  if (it != devices_.end())
+    it->second[reg] = value;
+}
+
+bool FakeI2cTransport::writeRegisters(uint8_t address, uint16_t reg, int indexBytes,
+                                      const uint8_t *data, size_t len) {
+  transactions_++;
+  const auto it = devices_.find(address);
+  if (it == devices_.end())
+    return false;
+  const auto hook = writeHooks_.find(address);
+  const uint16_t base = indexBytes == 0 ? 0 : reg;
+  for (size_t i = 0; i < len; i++) {
+    const uint16_t r = static_cast<uint16_t>(base + i);
+    it->second[r] = data[i];
+    if (hook != writeHooks_.end())
+      hook->second(address, r, data[i]);
+  }
+  return true;
+}
+
+bool FakeI2cTransport::readRegisters(uint8_t address, uint16_t reg, int indexBytes, uint8_t *out,
+                                     size_t len) {
+  transactions_++;
+  const auto it = devices_.find(address);
+  if (it == devices_.end())
+    return false;
+  const auto hook = readHooks_.find(address);
+  const uint16_t base = indexBytes == 0 ? 0 : reg;
+  for (size_t i = 0; i < len; i++) {
+    const uint16_t r = static_cast<uint16_t>(base + i);
+    uint8_t value = it->second[r];
+    if (hook != readHooks_.end())
+      hook->second(address, r, value);
+    out[i] = value;
+  }
+  return true;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// Register-level I2C access. `indexBytes` is the width of the register index
+// sent (big-endian) before the payload: 2 for VL53L1X, 1 for most expanders,
+// 0 for index-less devices such as a TCA9548A mux control byte.
+class I2cTransport {
+public:
+  virtual ~I2cTransport() = default;
+
+  virtual bool writeRegisters(uint8_t address, uint16_t reg, int indexBytes, const uint8_t *data,
+                              size_t len) = 0;
+  virtual bool readRegisters(uint8_t address, uint16_t reg, int indexBytes, uint8_t *out,
+                             size_t len) = 0;
+};
+
+// /dev/i2c-N via the I2C_RDWR ioctl (one combined transaction per call).
+class LinuxI2cTransport final : public I2cTransport {
+public:
+  LinuxI2cTransport() = default;
+  ~LinuxI2cTransport() override;
+
+  LinuxI2cTransport(const LinuxI2cTransport &) = delete;
+  LinuxI2cTransport &operator=(const LinuxI2cTransport &) = delete;
+
+  bool open(int bus);
+  void close();
+  bool isOpen() const { return fd_ >= 0; }
+
+  bool writeRegisters(uint8_t address, uint16_t reg, int indexBytes, const uint8_t *data,
+                      size_t len) override;
+  bool readRegisters(uint8_t address, uint16_t reg, int indexBytes, uint8_t *out,
+                     size_t len) override;
+
+private:
+  int fd_ = -1;
+};
+
+// In-memory register files keyed by 7-bit address, with auto-increment on
+// multi-byte access. Per-device hooks let a caller emulate volatile/status
+// registers.
+class FakeI2cTransport final : public I2cTransport {
+public:
+  using ReadHook = std::function<void(uint8_t address, uint16_t reg, uint8_t &value)>;
+  using WriteHook = std::function<void(uint8_t address, uint16_t reg, uint8_t value)>;
+
+  void addDevice(uint8_t address);
+  bool hasDevice(uint8_t address) const { return devices_.count(address) != 0; }
+
+  uint8_t peek(uint8_t address, uint16_t reg) const;
+  void poke(uint8_t address, uint16_t reg, uint8_t value);
+
+  void setReadHook(uint8_t address, ReadHook hook) { readHooks_[address] = std::move(hook); }
+  void setWriteHook(uint8_t address, WriteHook hook) { writeHooks_[address] = std::move(hook); }
+
+  size_t transactionCount() const { return transactions_; }
+
+  bool writeRegisters(uint8_t address, uint16_t reg, int indexBytes, const uint8_t *data,
+                      size_t len) override;
+  bool readRegisters(uint8_t address, uint16_t reg, int indexBytes, uint8_t *out,
+                     size_t len) override;
+
+private:
+  std::map<uint8_t, std::vector<uint8_t>> devices_;
+  std::map<uint8_t, ReadHook> readHooks_;
+  std::map<uint8_t, WriteHook> writeHooks_;
+  size_t transactions_ = 0;
+};
+
+// Accepts "1" or "/dev/i2c-1"; returns -1 when unparsable.
+int parseI2cBus(const std::string &arg);
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Bounded single-producer/single-consumer ring. push()/pushLatest() are only
+// called from the producer thread, pop()/drainLatest() only from the
+// consumer thread. Capacity must be a power of two; no locks, no allocation
+// after construction.
+//
+// FIFO consumers (commands, input edges) use push()/pop(): a full ring
+// refuses the new element. Latest-value consumers use pushLatest() and
+// drainLatest(): a full ring never holds back the newest element, which
+// goes to a triple-buffered latest slot instead (the producer never writes
+// memory the consumer may be reading).
+template <typename T, size_t Capacity> class SpscRing final {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                "SpscRing capacity must be a power of two");
+
+public:
+  // Returns false (and counts an overflow) when the consumer has fallen a
+  // full ring behind; the new element is discarded.
+  bool push(const T &value) {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    const size_t tail = tail_.load(std::memory_order_acquire);
+    if (head - tail >= Capacity) {
+      overflows_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    slots_[head & (Capacity - 1)] = value;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Never fails: with the ring full the element replaces the latest slot
+  // (counted as an overflow, and as a drop if the slot was still unread).
+  // Pair with drainLatest() only; pop() does not see the latest slot.
+  void pushLatest(const T &value) {
+    const uint64_t seq = ++latestPushed_;
+    const size_t head = head_.load(std::memory_order_relaxed);
+    const size_t tail = tail_.load(std::memory_order_acquire);
+    if (head - tail < Capacity) {
+      slots_[head & (Capacity - 1)] = value;
+      slotSeqs_[head & (Capacity - 1)] = seq;
+      head_.store(head + 1, std::memory_order_release);
+      return;
+    }
+    overflows_.fetch_add(1, std::memory_order_relaxed);
+    latest_[latestBack_] = value;
+    latestSeqs_[latestBack_] = seq;
+    const uint8_t old = latestState_.exchange(latestBack_ | kLatestFresh, std::memory_order_acq_rel);
+    latestBack_ = old & kLatestIndex;
+    if (old & kLatestFresh)
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  bool pop(T &out) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    const size_t head = head_.load(std::memory_order_acquire);
+    if (tail == head)
+      return false;
+    out = slots_[tail & (Capacity - 1)];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumes everything queued, keeps only the newest element and counts the
+  // rest as dropped. Returns false if the ring was empty. The latest slot
+  // and the ring's newest element are compared by push order, since either
+  // can be the newer one.
+  bool drainLatest(T &out) {
+    bool got = false;
+    uint64_t gotSeq = 0;
+    // The slot first: anything overflowing into it after this is newer than
+    // everything taken from the ring below.
+    if (latestState_.load(std::memory_order_relaxed) & kLatestFresh) {
+      const uint8_t old = latestState_.exchange(latestFront_, std::memory_order_acq_rel);
+      latestFront_ = old & kLatestIndex;
+      out = latest_[latestFront_];
+      gotSeq = latestSeqs_[latestFront_];
+      got = true;
+    }
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    const size_t head = head_.load(std::memory_order_acquire);
+    if (tail != head) {
+      const size_t newest = (head - 1) & (Capacity - 1);
+      dropped_.fetch_add(head - tail - 1, std::memory_order_relaxed);
+      if (!got || slotSeqs_[newest] > gotSeq) {
+        if (got)
+          dropped_.fetch_add(1, std::memory_order_relaxed);
+        out = slots_[newest];
+      } else {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+      }
+      tail_.store(head, std::memory_order_release);
+      got = true;
+    }
+    return got;
+  }
+
+  size_t size() const {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+  }
+  static constexpr size_t capacity() { return Capacity; }
+
+  uint64_t overflowCount() const { return overflows_.load(std::memory_order_relaxed); }
+  uint64_t droppedCount() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+  // latestState_: index of the middle buffer, plus kLatestFresh while it
+  // holds an element the consumer has not taken.
+  static constexpr uint8_t kLatestIndex = 0x3;
+  static constexpr uint8_t kLatestFresh = 0x4;
+
+  alignas(64) std::atomic<size_t> head_{0};
+  alignas(64) std::atomic<size_t> tail_{0};
+  alignas(64) std::atomic<uint64_t> overflows_{0};
+  std::atomic<uint64_t> dropped_{0};
+  std::array<T, Capacity> slots_{};
+
+  // pushLatest() order of each element, to tell which of the ring's newest
+  // and the latest slot is newer.
+  std::array<uint64_t, Capacity> slotSeqs_{};
+  std::array<T, 3> latest_{};
+  std::array<uint64_t, 3> latestSeqs_{};
+  alignas(64) std::atomic<uint8_t> latestState_{1};
+  uint64_t latestPushed_ = 0; // producer's
+  uint8_t latestBack_ = 0;    // producer's
+  alignas(64) uint8_t latestFront_ = 2; // consumer's
+};
@@ -0,0 +1,40 @@
+#include "tca9548a.h"
+
+Tca9548a::Tca9548a(I2cTransport &upstream, uint8_t address)
+    : upstream_(upstream), address_(address) {
+  for (int i = 0; i < kChannels; i++) {
+    channels_[i].mux = this;
+    channels_[i].index = i;
+  }
+}
+
+bool Tca9548a::select(int n) {
+  if (n == selected_)
+    return true;
+  if (!writeControl(static_cast<uint8_t>(1u << (n & (kChannels - 1))))) {
+    selected_ = -1;
+    return false;
+  }
+  selected_ = n;
+  return true;
+}
+
+bool Tca9548a::disableAll() {
+  selected_ = -1;
+  return writeControl(0x00);
+}
+
+bool Tca9548a::writeControl(uint8_t mask) {
+  // The control register is the only one and takes no index byte.
+  return upstream_.writeRegisters(address_, 0, 0, &mask, 1);
+}
+
+bool Tca9548a::Channel::writeRegisters(uint8_t address, uint16_t reg, int indexBytes,
+                                       const uint8_t *data, size_t len) {
+  return mux->select(index) && mux->upstream_.writeRegisters(address, reg, indexBytes, data, len);
+}
+
+bool Tca9548a::Channel::readRegisters(uint8_t address, uint16_t reg, int indexBytes, uint8_t *out,
+                                      size_t len) {
+  return mux->select(index) && mux->upstream_.readRegisters(address, reg, indexBytes, out, len);
+}
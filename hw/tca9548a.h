@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+#include "i2c_transport.h"
+
+// TCA9548A 1-to-8 I2C switch. channel(n) is a transport that routes to
+// downstream channel n, selecting it first when another one is active. The
+// selection is cached, so back-to-back transactions on one channel cost
+// nothing extra.
+class Tca9548a final {
+public:
+  static constexpr int kChannels = 8;
+
+  explicit Tca9548a(I2cTransport &upstream, uint8_t address = 0x70);
+
+  I2cTransport &channel(int n) { return channels_[n & (kChannels - 1)]; }
+  bool select(int n);
+  bool disableAll();
+
+private:
+  class Channel final : public I2cTransport {
+  public:
+    bool writeRegisters(uint8_t address, uint16_t reg, int indexBytes, const uint8_t *data,
+                        size_t len) override;
+    bool readRegisters(uint8_t address, uint16_t reg, int indexBytes, uint8_t *out,
+                       size_t len) override;
+
+    Tca9548a *mux = nullptr;
+    int index = 0;
+  };
+
+  bool writeControl(uint8_t mask);
+
+  I2cTransport &upstream_;
+  uint8_t address_;
+  int selected_ = -1; // -1 = unknown, forces a write
+  Channel channels_[kChannels];
+};
@@ -0,0 +1,156 @@
+#include "tof_acquisition_thread.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+
+#include <algorithm>
+
+#include "amust_config.h"
+
+namespace {
+// Upper bound on how long a read may block, i.e. the stop latency.
+constexpr int kReadTimeoutMs = 100;
+// Granularity of the interruptible backoff sleep.
+constexpr int kBackoffSliceMs = 50;
+} // namespace
+
+TofAcquisitionThread::TofAcquisitionThread(BackendOpener opener, const TofBackendConfig &config,
+                                           QObject *parent)
+    : QThread(parent), opener_(std::move(opener)), config_(config) {
+  setObjectName(QStringLiteral("tof-acquisition"));
+}
+
+TofAcquisitionThread::~TofAcquisitionThread() {
+  stopAndWait();
+}
+
+bool TofAcquisitionThread::stopAndWait(int timeoutMs) {
+  requestInterruption();
+  if (timeoutMs < 0)
+    return wait();
+  return wait(static_cast<unsigned long>(timeoutMs));
+}
+
+void TofAcquisitionThread::requestProfile(const TofRangingProfile &profile) {
+  std::lock_guard<std::mutex> lock(profileMutex_);
+  pendingProfile_ = profile;
+  profilePending_.store(true, std::memory_order_release);
+}
+
+void TofAcquisitionThread::applyPendingProfile(TofBackend &backend) {
+  TofRangingProfile profile;
+  {
+    std::lock_guard<std::mutex> lock(profileMutex_);
+    profile = pendingProfile_;
+    profilePending_.store(false, std::memory_order_relaxed);
+  }
+  if (!backend.applyProfile(profile)) {
+    qWarning() << "ToF:" << backend.name() << "backend kept profile" << profileName();
+    return;
+  }
+  // A restarted backend opens straight into the latest profile.
+  config_.profile = profile;
+  profileName_.store(profile.name, std::memory_order_release);
+  profileSamples_.store(0, std::memory_order_relaxed);
+  profileSinceNs_.store(tofNowNs(), std::memory_order_release);
+}
+
+bool TofAcquisitionThread::sleepInterruptible(int ms) {
+  QElapsedTimer slept;
+  slept.start();
+  while (!isInterruptionRequested()) {
+    const qint64 remaining = ms - slept.elapsed();
+    if (remaining <= 0)
+      return true;
+    QThread::msleep(static_cast<unsigned long>(std::min<qint64>(remaining, kBackoffSliceMs)));
+  }
+  return false;
+}
+
+bool TofAcquisitionThread::durationElapsed(const QElapsedTimer &runTimer) const {
+  return config_.durationSeconds > 0.0 && runTimer.elapsed() >= config_.durationSeconds * 1000.0;
+}
+
+void TofAcquisitionThread::run() {
+  QElapsedTimer runTimer;
+  runTimer.start();
+  int backoffMs = AmustConfig::kTofRestartBackoffMinMs;
+  bool firstAttempt = true;
+
+  // Supervisor: (re)open the backend until stopped, backing off exponentially
+  // while it keeps failing. A backend that delivered samples resets the
+  // backoff, so an occasional crash restarts quickly.
+  while (!isInterruptionRequested() && !durationElapsed(runTimer)) {
+    if (!firstAttempt) {
+      state_.store(TofSensorState::Restarting, std::memory_order_release);
+      restarts_.fetch_add(1, std::memory_order_relaxed);
+      qInfo() << "ToF: restarting backend in" << backoffMs << "ms";
+      if (!sleepInterruptible(backoffMs))
+        break;
+      backoffMs = std::min(backoffMs * 2, AmustConfig::kTofRestartBackoffMaxMs);
+    }
+    firstAttempt = false;
+
+    state_.store(TofSensorState::Starting, std::memory_order_release);
+    const int64_t openedAtNs = tofNowNs();
+    std::unique_ptr<TofBackend> backend = opener_ ? opener_(config_) : nullptr;
+    if (!backend)
+      continue;
+
+    backendName_.store(backend->name(), std::memory_order_release);
+    qInfo() << "ToF: using" << backend->name() << "backend";
+    profileName_.store(config_.profile.name, std::memory_order_release);
+    profileSamples_.store(0, std::memory_order_relaxed);
+    profileSinceNs_.store(openedAtNs, std::memory_order_release);
+
+    if (superviseBackend(*backend, openedAtNs, runTimer))
+      backoffMs = AmustConfig::kTofRestartBackoffMinMs;
+    backend->close();
+    backendName_.store("none", std::memory_order_release);
+  }
+  state_.store(TofSensorState::Stopped, std::memory_order_release);
+}
+
+bool TofAcquisitionThread::superviseBackend(TofBackend &backend, int64_t openedAtNs,
+                                            const QElapsedTimer &runTimer) {
+  filter_.reset();
+  bool gotSample = false;
+  int64_t lastSampleNs = openedAtNs;
+  while (!isInterruptionRequested() && !durationElapsed(runTimer)) {
+    if (profilePending_.load(std::memory_order_acquire))
+      applyPendingProfile(backend);
+
+    TofSample sample;
+    if (backend.read(sample, kReadTimeoutMs)) {
+      ring_.pushLatest(filter_.process(sample));
+      samples_.fetch_add(1, std::memory_order_relaxed);
+      profileSamples_.fetch_add(1, std::memory_order_relaxed);
+      TofDepthMap map;
+      if (backend.takeDepthMap(map))
+        depthMaps_.pushLatest(map);
+      lastSampleNs = tofNowNs();
+      if (!gotSample) {
+        gotSample = true;
+        firstSampleMs_.store((lastSampleNs - openedAtNs) / 1'000'000, std::memory_order_relaxed);
+        state_.store(TofSensorState::Running, std::memory_order_release);
+      }
+      continue;
+    }
+
+    if (!backend.isOpen()) {
+      qWarning() << "ToF:" << backend.name() << "backend stopped";
+      break;
+    }
+    // Heartbeat: a backend that is open but silent for several measurement
+    // periods is hung (wedged bus, stuck script) and gets restarted.
+    const int64_t silentMs = (tofNowNs() - lastSampleNs) / 1'000'000;
+    const int limitMs = gotSample ? std::max(AmustConfig::kTofHeartbeatTimeoutMs,
+                                             4 * config_.profile.interMeasurementMs)
+                                  : AmustConfig::kTofFirstSampleTimeoutMs;
+    if (silentMs >= limitMs) {
+      qWarning() << "ToF:" << backend.name() << "backend silent for" << silentMs << "ms";
+      break;
+    }
+  }
+  return gotSample;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <QThread>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "spsc_ring.h"
+#include "tof_backend.h"
+#include "tof_filter.h"
+
+class QElapsedTimer;
+
+// Runs a TofBackend on its own thread, filters each sample and publishes it
+// into a lock-free ring that the GUI thread drains once per frame. The thread
+// also supervises the backend: failed opens, crashes and hangs (no sample
+// within a heartbeat) lead to a restart with exponential backoff.
+class TofAcquisitionThread final : public QThread {
+  Q_OBJECT
+
+public:
+  using SampleRing = SpscRing<TofSample, 64>;
+  using DepthMapRing = SpscRing<TofDepthMap, 4>;
+  // Creates and opens a backend; runs on the acquisition thread.
+  using BackendOpener = std::function<std::unique_ptr<TofBackend>(const TofBackendConfig &)>;
+
+  TofAcquisitionThread(BackendOpener opener, const TofBackendConfig &config,
+                       QObject *parent = nullptr);
+  ~TofAcquisitionThread() override;
+
+  // Waits up to timeoutMs (-1 = forever); false if the thread is still
+  // running, e.g. blocked in a transport read.
+  bool stopAndWait(int timeoutMs = -1);
+  // Thread-safe; applied by the worker before its next read.
+  void requestProfile(const TofRangingProfile &profile);
+
+  SampleRing &ring() { return ring_; }
+  const SampleRing &ring() const { return ring_; }
+  DepthMapRing &depthMaps() { return depthMaps_; }
+  uint64_t sampleCount() const { return samples_.load(std::memory_order_relaxed); }
+  TofSensorState state() const { return state_.load(std::memory_order_acquire); }
+  uint64_t restartCount() const { return restarts_.load(std::memory_order_relaxed); }
+  // From the latest (re)open to its first sample; -1 until one arrives.
+  int64_t timeToFirstSampleMs() const { return firstSampleMs_.load(std::memory_order_relaxed); }
+  const char *backendName() const { return backendName_.load(std::memory_order_acquire); }
+  // The profile the backend is actually running, and samples read under it.
+  const char *profileName() const { return profileName_.load(std::memory_order_acquire); }
+  int64_t profileSinceNs() const { return profileSinceNs_.load(std::memory_order_acquire); }
+  uint64_t profileSampleCount() const { return profileSamples_.load(std::memory_order_relaxed); }
+
+protected:
+  void run() override;
+
+private:
+  // Reads until the backend stops, hangs or the thread is interrupted.
+  // Returns true if it produced at least one sample.
+  bool superviseBackend(TofBackend &backend, int64_t openedAtNs, const QElapsedTimer &runTimer);
+  void applyPendingProfile(TofBackend &backend);
+  bool sleepInterruptible(int ms);
+  bool durationElapsed(const QElapsedTimer &runTimer) const;
+
+  BackendOpener opener_;
+  TofBackendConfig config_;
+  SampleRing ring_;
+  DepthMapRing depthMaps_;
+  TofDistanceFilter<> filter_;
+  std::atomic<uint64_t> samples_{0};
+  std::atomic<const char *> backendName_{"none"};
+  std::atomic<TofSensorState> state_{TofSensorState::Starting};
+  std::atomic<uint64_t> restarts_{0};
+  std::atomic<int64_t> firstSampleMs_{-1};
+
+  std::mutex profileMutex_;
+  TofRangingProfile pendingProfile_;
+  std::atomic<bool> profilePending_{false};
+  std::atomic<const char *> profileName_{"none"};
+  std::atomic<int64_t> profileSinceNs_{0};
+  std::atomic<uint64_t> profileSamples_{0};
+};
@@ -0,0 +1,256 @@
+#include "tof_array_backend.h"
+
+#include <QDebug>
+
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <thread>
+
+#include "gpio_backend.h"
+#include "tof_fusion.h"
+
+namespace {
+// Every VL53L1X answers here after power-up / XSHUT release.
+constexpr uint8_t kBootAddress = 0x29;
+// Firmware boot after XSHUT goes high is ~1.2 ms.
+constexpr auto kXshutBootDelay = std::chrono::milliseconds(2);
+constexpr auto kXshutResetDelay = std::chrono::milliseconds(10);
+constexpr auto kDataReadyPollInterval = std::chrono::milliseconds(1);
+} // namespace
+
+TofArrayBackend::TofArrayBackend() : xshut_(createGpioChipBackend()) {}
+
+TofArrayBackend::TofArrayBackend(I2cTransport *transport)
+    : externalTransport_(transport), xshut_(createGpioChipBackend()) {}
+
+TofArrayBackend::~TofArrayBackend() {
+  close();
+}
+
+bool TofArrayBackend::open(const TofBackendConfig &config) {
+  close();
+
+  I2cTransport *bus = externalTransport_;
+  if (!bus) {
+    if (!linuxTransport_.open(config.bus)) {
+      qWarning() << "ToF: cannot open /dev/i2c-" << config.bus;
+      return false;
+    }
+    bus = &linuxTransport_;
+    if (AmustConfig::kTofMuxAddress != 0)
+      mux_ = std::make_unique<Tca9548a>(*bus, static_cast<uint8_t>(AmustConfig::kTofMuxAddress));
+  }
+
+  std::map<int, size_t> groupIndex;
+  for (const AmustConfig::TofArraySensor &spec : AmustConfig::kTofArray) {
+    I2cTransport &transport =
+        mux_ && spec.muxChannel >= 0 ? mux_->channel(spec.muxChannel) : *bus;
+    const uint8_t address = externalTransport_ ? static_cast<uint8_t>(spec.address) : kBootAddress;
+    Sensor sensor;
+    sensor.device = std::make_unique<Vl53l1x>(transport, address);
+    sensor.xMm = spec.xMm;
+    sensor.yMm = spec.yMm;
+    sensors_.push_back(std::move(sensor));
+
+    const auto inserted = groupIndex.emplace(spec.crosstalkGroup, groups_.size());
+    if (inserted.second)
+      groups_.emplace_back();
+    groups_[inserted.first->second].members.push_back(sensors_.size() - 1);
+  }
+
+  timingBudgetMs_ = config.profile.timingBudgetMs;
+  bool ok = assignAddresses();
+  for (size_t i = 0; ok && i < sensors_.size(); i++)
+    ok = configure(*sensors_[i].device, config.profile);
+  if (!ok) {
+    qWarning() << "ToF: sensor array init failed";
+    close();
+    return false;
+  }
+
+  qInfo() << "ToF: array of" << sensors_.size() << "sensors in" << groups_.size()
+          << "crosstalk groups";
+  return true;
+}
+
+bool TofArrayBackend::assignAddresses() {
+  if (externalTransport_) {
+    for (Sensor &s : sensors_) {
+      if (!s.device->init())
+        return false;
+    }
+    return true;
+  }
+
+  // Hold every XSHUT-controlled sensor in reset while the always-on ones
+  // (at most one per bus or mux channel) move off the boot address.
+  std::vector<int> lines;
+  std::vector<size_t> switched;
+  for (size_t i = 0; i < sensors_.size(); i++) {
+    if (AmustConfig::kTofArray[i].xshutLine >= 0) {
+      lines.push_back(AmustConfig::kTofArray[i].xshutLine);
+      switched.push_back(i);
+    }
+  }
+  if (!lines.empty()) {
+    if (!xshut_.request(lines, false, "amust_tof_xshut"))
+      return false;
+    std::this_thread::sleep_for(kXshutResetDelay);
+  }
+
+  auto bringUp = [this](size_t i) {
+    const uint8_t target = static_cast<uint8_t>(AmustConfig::kTofArray[i].address);
+    Vl53l1x &device = *sensors_[i].device;
+    if (!device.init() || (target != kBootAddress && !device.setI2cAddress(target))) {
+      qWarning().noquote() << "ToF: array sensor" << i << "did not come up at"
+                          << QStringLiteral("0x%1").arg(target, 2, 16, QLatin1Char('0'));
+      return false;
+    }
+    return true;
+  };
+
+  for (size_t i = 0; i < sensors_.size(); i++) {
+    if (AmustConfig::kTofArray[i].xshutLine < 0 && !bringUp(i))
+      return false;
+  }
+  for (size_t k = 0; k < switched.size(); k++) {
+    if (!xshut_.set(k, true))
+      return false;
+    std::this_thread::sleep_for(kXshutBootDelay);
+    if (!bringUp(switched[k]))
+      return false;
+  }
+  return true;
+}
+
+bool TofArrayBackend::configure(Vl53l1x &sensor, const TofRangingProfile &profile) {
+  const Vl53l1x::DistanceMode mode = profile.distanceMode == TofRangingProfile::DistanceMode::Short
+                                         ? Vl53l1x::DistanceMode::Short
+                                         : Vl53l1x::DistanceMode::Long;
+  // Each sensor takes a single measurement per turn, so its own period is
+  // just the budget; the round-robin sets the effective rate.
+  return sensor.setDistanceMode(mode) && sensor.setTimingBudgetMs(profile.timingBudgetMs) &&
+         sensor.setInterMeasurementMs(profile.timingBudgetMs);
+}
+
+void TofArrayBackend::close() {
+  for (Sensor &s : sensors_) {
+    if (s.ranging)
+      s.device->stopRanging();
+  }
+  sensors_.clear();
+  groups_.clear();
+  // Back into reset, so the next open() finds them at the boot address.
+  for (size_t k = 0; k < xshut_.size(); k++)
+    xshut_.set(k, false);
+  xshut_.release();
+  mux_.reset();
+  linuxTransport_.close();
+}
+
+bool TofArrayBackend::applyProfile(const TofRangingProfile &profile) {
+  if (sensors_.empty())
+    return false;
+  bool ok = true;
+  for (Sensor &s : sensors_) {
+    if (s.ranging)
+      s.device->stopRanging();
+    s.ranging = false;
+    ok = configure(*s.device, profile) && ok;
+  }
+  if (ok)
+    timingBudgetMs_ = profile.timingBudgetMs;
+  return ok;
+}
+
+bool TofArrayBackend::startNext(Group &group) {
+  Sensor &s = sensors_[group.members[group.cursor]];
+  s.device->clearInterrupt();
+  s.ranging = s.device->startRanging();
+  s.startedNs = tofNowNs();
+  return s.ranging;
+}
+
+void TofArrayBackend::poll(Group &group, int64_t nowNs) {
+  Sensor &s = sensors_[group.members[group.cursor]];
+  if (!s.ranging) {
+    startNext(group);
+    return;
+  }
+
+  bool ready = false;
+  const bool ok = s.device->checkForDataReady(ready);
+  // A sensor that misses its slot gives up its turn instead of stalling the
+  // whole array; it counts as invalid for this round.
+  const int64_t overdueNs = (2LL * timingBudgetMs_ + 20) * 1'000'000;
+  if (ok && !ready && nowNs - s.startedNs < overdueNs)
+    return;
+
+  Vl53l1x::Result result;
+  const bool valid = ok && ready && s.device->readResult(result) && result.rangeStatus == 0 &&
+                     result.distanceMm > 0;
+  s.device->clearInterrupt();
+  s.device->stopRanging();
+  s.ranging = false;
+  if (valid) {
+    s.distanceMm = s.median.push(result.distanceMm);
+    s.signalRateKcps = result.signalRateKcps;
+    s.ambientRateKcps = result.ambientRateKcps;
+  } else {
+    s.distanceMm = -1;
+    s.median.reset();
+  }
+  s.fresh = true;
+
+  group.cursor = (group.cursor + 1) % group.members.size();
+  startNext(group);
+}
+
+void TofArrayBackend::fuse(TofSample &out, int64_t nowNs) {
+  TofPoint points[AmustConfig::kTofArraySize];
+  size_t n = 0;
+  int signal = 0;
+  int ambient = 0;
+  for (Sensor &s : sensors_) {
+    s.fresh = false;
+    if (s.distanceMm <= 0)
+      continue;
+    points[n++] = {s.xMm, s.yMm, static_cast<double>(s.distanceMm)};
+    signal += s.signalRateKcps;
+    ambient += s.ambientRateKcps;
+  }
+
+  const TofFusedDistance fused = fuseTofPoints(points, n);
+  out.timestampNs = nowNs;
+  out.distanceMm = n > 0 ? static_cast<int>(std::lround(fused.distanceMm)) : -1;
+  out.rangeStatus = n > 0 ? 0 : 255;
+  out.signalRateKcps = n > 0 ? signal / static_cast<int>(n) : 0;
+  out.ambientRateKcps = n > 0 ? ambient / static_cast<int>(n) : 0;
+  // A fit over a subset would only see part of the tilt (e.g. one axis);
+  // report it only when every sensor contributed.
+  out.tiltDeg = n == sensors_.size() ? static_cast<float>(fused.tiltDeg) : -1.0f;
+}
+
+bool TofArrayBackend::read(TofSample &out, int timeoutMs) {
+  if (sensors_.empty())
+    return false;
+
+  const int64_t deadlineNs = tofNowNs() + static_cast<int64_t>(timeoutMs) * 1'000'000;
+  for (;;) {
+    const int64_t nowNs = tofNowNs();
+    for (Group &g : groups_)
+      poll(g, nowNs);
+
+    bool roundComplete = true;
+    for (const Sensor &s : sensors_)
+      roundComplete = roundComplete && s.fresh;
+    if (roundComplete) {
+      fuse(out, nowNs);
+      return true;
+    }
+    if (nowNs >= deadlineNs)
+      return false;
+    std::this_thread::sleep_for(kDataReadyPollInterval);
+  }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "gpio_chip.h"
+#include "i2c_transport.h"
+#include "tca9548a.h"
+#include "tof_backend.h"
+#include "tof_filter.h"
+#include "vl53l1x.h"
+
+// Several VL53L1X described by AmustConfig::kTofArray, fused into one sample
+// per round: distance at the head's centre plus tilt. Sensors in the same
+// crosstalk group take turns (one measurement each, round-robin); groups run
+// side by side, so throughput scales with the number of groups.
+class TofArrayBackend final : public TofBackend {
+public:
+  TofArrayBackend();
+  // Uses `transport` instead of opening /dev/i2c-N; not owned. Sensors must
+  // already answer at their configured addresses (no mux, no XSHUT).
+  explicit TofArrayBackend(I2cTransport *transport);
+  ~TofArrayBackend() override;
+
+  const char *name() const override { return "array"; }
+  bool open(const TofBackendConfig &config) override;
+  void close() override;
+  bool isOpen() const override { return !sensors_.empty(); }
+  bool read(TofSample &out, int timeoutMs) override;
+  bool applyProfile(const TofRangingProfile &profile) override;
+
+private:
+  struct Sensor {
+    std::unique_ptr<Vl53l1x> device;
+    double xMm = 0.0;
+    double yMm = 0.0;
+    RollingMedian<3> median;
+    bool ranging = false;
+    int64_t startedNs = 0;
+    bool fresh = false; // measured since the last fused sample
+    int distanceMm = -1;
+    int signalRateKcps = 0;
+    int ambientRateKcps = 0;
+  };
+  struct Group {
+    std::vector<size_t> members;
+    size_t cursor = 0;
+  };
+
+  bool assignAddresses();
+  bool configure(Vl53l1x &sensor, const TofRangingProfile &profile);
+  bool startNext(Group &group);
+  void poll(Group &group, int64_t nowNs);
+  void fuse(TofSample &out, int64_t nowNs);
+
+  I2cTransport *externalTransport_ = nullptr;
+  LinuxI2cTransport linuxTransport_;
+  std::unique_ptr<Tca9548a> mux_;
+  GpioOutputLines xshut_;
+  std::vector<Sensor> sensors_;
+  std::vector<Group> groups_;
+  int timingBudgetMs_ = 33;
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include "amust_config.h"
+
+// Position relative to the AmustConfig::kTofMinMm..kTofMaxMm guidance window.
+enum class TofZone : uint8_t { NoTarget, TooClose, Ok, TooFar };
+
+// Supervisor view of the sensor: Running once a backend delivers samples,
+// Restarting while backing off after a failed open, crash or hang.
+enum class TofSensorState : uint8_t { Stopped, Starting, Running, Restarting };
+
+struct TofSample {
+  int64_t timestampNs = 0; // steady clock, stamped when the sample was read
+  int distanceMm = -1;     // filtered once past TofDistanceFilter
+  int rangeStatus = 0;
+  int signalRateKcps = 0;
+  int ambientRateKcps = 0;
+  int rawDistanceMm = -1;  // as reported by the backend
+  TofZone zone = TofZone::NoTarget;
+  float tiltDeg = -1.0f;   // head vs. surface, sensor arrays only; -1 = unknown
+};
+
+// Coarse depth map from an ROI scan of one sensor. Zones are row-major over
+// the SPAD array; how that maps onto the scene depends on the mounting.
+struct TofDepthMap {
+  static constexpr int kMaxZones = 16; // 4x4 ROIs of the 16x16 SPAD array
+
+  int64_t timestampNs = 0; // when the last zone of the frame was read
+  uint32_t frame = 0;
+  int columns = 0;
+  int rows = 0;
+  int16_t distanceMm[kMaxZones] = {}; // -1 = no valid return
+};
+
+inline int64_t tofNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Sensor ranging parameters that can change while the backend is running.
+// The budget must exist for the distance mode (Long has no 15 ms entry).
+struct TofRangingProfile {
+  enum class DistanceMode : uint8_t { Short, Long };
+
+  const char *name = "default";
+  DistanceMode distanceMode = DistanceMode::Short;
+  int timingBudgetMs = 33;
+  int interMeasurementMs = 500; // >= timingBudgetMs; equal means back-to-back
+
+  static TofRangingProfile idle();
+  static TofRangingProfile active();
+};
+
+inline TofRangingProfile TofRangingProfile::idle() {
+  return {"idle", DistanceMode::Long, AmustConfig::kTofIdleTimingBudgetMs,
+          AmustConfig::kTofIdleIntervalMs};
+}
+
+inline TofRangingProfile TofRangingProfile::active() {
+  return {"active", DistanceMode::Short, AmustConfig::kTofActiveTimingBudgetMs,
+          AmustConfig::kTofActiveIntervalMs};
+}
+
+struct TofBackendConfig {
+  int bus = 1;
+  int address = 0x29;
+  double intervalSeconds = 0.5;
+  double durationSeconds = 0.0;
+  TofRangingProfile profile; // applied by open()
+  int scanColumns = 0;       // ROI scan grid; 0 = full-array ranging
+  int scanRows = 0;
+};
+
+// A source of distance samples. Backends are created, used and destroyed on
+// the acquisition thread. `read()` blocks for at most `timeoutMs` and returns
+// true with `out` filled when a sample arrived.
+class TofBackend {
+public:
+  virtual ~TofBackend() = default;
+
+  virtual const char *name() const = 0;
+  virtual bool open(const TofBackendConfig &config) = 0;
+  virtual void close() = 0;
+  virtual bool isOpen() const = 0;
+  virtual bool read(TofSample &out, int timeoutMs) = 0;
+  // Reconfigures ranging without closing the backend. Returns false if the
+  // backend cannot (or failed to) switch; it keeps its previous profile.
+  virtual bool applyProfile(const TofRangingProfile &profile) {
+    (void)profile;
+    return false;
+  }
+  // Hands over the depth map completed by the last read(), if any.
+  virtual bool takeDepthMap(TofDepthMap &out) {
+    (void)out;
+    return false;
+  }
+};
@@ -0,0 +1,230 @@
+#include "tof_data_ready.h"
+
+#include <QDebug>
+
+#include <chrono>
+
+#include "gpio_chip.h"
+#include "tof_backend.h"
+
+namespace {
+constexpr const char *kConsumer = "amust_tof_gpio1";
+} // namespace
+
+struct GpiodDataReadySource::Impl {
+#if defined(AMUST_HAVE_GPIOD)
+  gpiod_chip *chip = nullptr;
+#if defined(AMUST_GPIOD_LEGACY_API)
+  gpiod_line *line = nullptr;
+#else
+  gpiod_line_request *request = nullptr;
+  gpiod_edge_event_buffer *events = nullptr;
+#endif
+
+  void release() {
+#if defined(AMUST_GPIOD_LEGACY_API)
+    if (line)
+      gpiod_line_release(line);
+    line = nullptr;
+#else
+    if (events)
+      gpiod_edge_event_buffer_free(events);
+    events = nullptr;
+    if (request)
+      gpiod_line_request_release(request);
+    request = nullptr;
+#endif
+    if (chip)
+      gpiod_chip_close(chip);
+    chip = nullptr;
+  }
+#endif
+};
+
+GpiodDataReadySource::GpiodDataReadySource() : impl_(std::make_unique<Impl>()) {}
+
+GpiodDataReadySource::~GpiodDataReadySource() {
+#if defined(AMUST_HAVE_GPIOD)
+  impl_->release();
+#endif
+}
+
+bool GpiodDataReadySource::open(int lineOffset, bool activeLow) {
+  lineOffset_ = lineOffset;
+  activeLow_ = activeLow;
+#if defined(AMUST_HAVE_GPIOD)
+  impl_->release();
+  if (lineOffset < 0)
+    return false;
+  impl_->chip = openAmustGpioChip();
+  if (!impl_->chip)
+    return false;
+
+#if defined(AMUST_GPIOD_LEGACY_API)
+  gpiod_line *line = gpiod_chip_get_line(impl_->chip, static_cast<unsigned int>(lineOffset));
+  int rc = -1;
+  if (line) {
+    rc = activeLow ? gpiod_line_request_falling_edge_events(line, kConsumer)
+                     : gpiod_line_request_rising_edge_events(line, kConsumer);
+  }
+  if (rc == 0)
+    impl_->line = line;
+  if (rc < 0) {
+    qWarning() << "ToF: failed to request GPIO1 edge events on line" << lineOffset;
+    impl_->release();
+    return false;
+  }
+#else
+  gpiod_line_settings *settings = gpiod_line_settings_new();
+  gpiod_line_config *lineCfg = gpiod_line_config_new();
+  gpiod_request_config *requestCfg = gpiod_request_config_new();
+  bool configured = settings && lineCfg && requestCfg;
+  if (configured) {
+    const unsigned int offset = static_cast<unsigned int>(lineOffset);
+    gpiod_line_settings_set_direction(settings, GPIOD_LINE_DIRECTION_INPUT);
+    gpiod_line_settings_set_edge_detection(settings, activeLow ? GPIOD_LINE_EDGE_FALLING
+                                                               : GPIOD_LINE_EDGE_RISING);
+    // GPIO1 is open-drain on the VL53L1X; pull towards the idle level.
+    gpiod_line_settings_set_bias(settings, activeLow ? GPIOD_LINE_BIAS_PULL_UP
+                                                     : GPIOD_LINE_BIAS_PULL_DOWN);
+    gpiod_line_settings_set_event_clock(settings, GPIOD_LINE_CLOCK_MONOTONIC);
+    gpiod_request_config_set_consumer(requestCfg, kConsumer);
+    configured = gpiod_line_config_add_line_settings(lineCfg, &offset, 1, settings) == 0;
+  }
+  if (configured)
+    impl_->request = gpiod_chip_request_lines(impl_->chip, requestCfg, lineCfg);
+  if (settings)
+    gpiod_line_settings_free(settings);
+  if (lineCfg)
+    gpiod_line_config_free(lineCfg);
+  if (requestCfg)
+    gpiod_request_config_free(requestCfg);
+
+  if (impl_->request)
+    impl_->events = gpiod_edge_event_buffer_new(4);
+  if (!impl_->request || !impl_->events) {
+    qWarning() << "ToF: failed to request GPIO1 edge events on line" << lineOffset;
+    impl_->release();
+    return false;
+  }
+#endif
+  return true;
+#else
+  Q_UNUSED(lineOffset);
+  Q_UNUSED(activeLow);
+  return false;
+#endif
+}
+
+bool GpiodDataReadySource::setActiveLow(bool activeLow) {
+  if (activeLow == activeLow_)
+    return true;
+  qInfo() << "ToF: sensor GPIO1 is active" << (activeLow ? "low," : "high,")
+          << "re-requesting line" << lineOffset_;
+  return open(lineOffset_, activeLow);
+}
+
+bool GpiodDataReadySource::wait(int timeoutMs, int64_t &edgeNs) {
+#if defined(AMUST_HAVE_GPIOD)
+#if defined(AMUST_GPIOD_LEGACY_API)
+  if (!impl_->line)
+    return false;
+  timespec timeout{timeoutMs / 1000, static_cast<long>(timeoutMs % 1000) * 1'000'000L};
+  if (gpiod_line_event_wait(impl_->line, &timeout) <= 0)
+    return false;
+  gpiod_line_event event{};
+  if (gpiod_line_event_read(impl_->line, &event) < 0)
+    return false;
+  // v1 event timestamps are CLOCK_REALTIME on older kernels; stamp locally.
+  edgeNs = tofNowNs();
+  return true;
+#else
+  if (!impl_->request)
+    return false;
+  const int64_t timeoutNs = static_cast<int64_t>(timeoutMs) * 1'000'000;
+  if (gpiod_line_request_wait_edge_events(impl_->request, timeoutNs) <= 0)
+    return false;
+  const int n = gpiod_line_request_read_edge_events(impl_->request, impl_->events, 4);
+  if (n <= 0)
+    return false;
+  gpiod_edge_event *event = gpiod_edge_event_buffer_get_event(impl_->events, n - 1);
+  edgeNs = event ? static_cast<int64_t>(gpiod_edge_event_get_timestamp_ns(event)) : tofNowNs();
+  return true;
+#endif
+#else
+  Q_UNUSED(timeoutMs);
+  Q_UNUSED(edgeNs);
+  return false;
+#endif
+}
+
+SoftwareDataReadySource::SoftwareDataReadySource(int periodMs) : periodMs_(periodMs) {
+  if (periodMs <= 0)
+    return;
+  ticker_ = std::thread([this]() {
+    using Clock = std::chrono::steady_clock;
+    std::unique_lock<std::mutex> lock(mutex_);
+    uint64_t generation = periodGeneration_;
+    auto next = Clock::now() + std::chrono::milliseconds(periodMs_);
+    while (!stopping_) {
+      if (cv_.wait_until(lock, next,
+                         [&]() { return stopping_ || generation != periodGeneration_; })) {
+        // New period: restart the schedule from now, like a sensor restart.
+        generation = periodGeneration_;
+        next = Clock::now() + std::chrono::milliseconds(periodMs_);
+        continue;
+      }
+      injected_++;
+      lastEdgeNs_ = tofNowNs();
+      cv_.notify_all();
+      next += std::chrono::milliseconds(periodMs_);
+    }
+  });
+}
+
+SoftwareDataReadySource::~SoftwareDataReadySource() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  cv_.notify_all();
+  if (ticker_.joinable())
+    ticker_.join();
+}
+
+void SoftwareDataReadySource::inject(int64_t edgeNs) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    injected_++;
+    lastEdgeNs_ = edgeNs != 0 ? edgeNs : tofNowNs();
+  }
+  cv_.notify_all();
+}
+
+void SoftwareDataReadySource::setMeasurementPeriodMs(int periodMs) {
+  if (!ticker_.joinable() || periodMs <= 0)
+    return;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    periodMs_ = periodMs;
+    periodGeneration_++;
+  }
+  cv_.notify_all();
+}
+
+uint64_t SoftwareDataReadySource::injectedCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return injected_;
+}
+
+bool SoftwareDataReadySource::wait(int timeoutMs, int64_t &edgeNs) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  const bool fired = cv_.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                                  [this]() { return consumed_ != injected_ || stopping_; });
+  if (!fired || consumed_ == injected_)
+    return false;
+  // Edges coalesce like a level-triggered interrupt: one wake per backlog.
+  consumed_ = injected_;
+  edgeNs = lastEdgeNs_;
+  return true;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Notification that the VL53L1X has a measurement ready (GPIO1 interrupt).
+class TofDataReadySource {
+public:
+  virtual ~TofDataReadySource() = default;
+
+  virtual const char *name() const = 0;
+  // Blocks up to `timeoutMs` for a data-ready edge. On success `edgeNs` is
+  // the edge time on the steady clock.
+  virtual bool wait(int timeoutMs, int64_t &edgeNs) = 0;
+  // The sensor's measurement period changed; only simulated sources care.
+  virtual void setMeasurementPeriodMs(int periodMs) { (void)periodMs; }
+  // The sensor's GPIO1 polarity as read back after init; a GPIO source then
+  // watches the edge into the asserted level. False if it cannot.
+  virtual bool setActiveLow(bool activeLow) {
+    (void)activeLow;
+    return true;
+  }
+};
+
+// GPIO1 wired to a line of AmustConfig::kGpioChipName, read through libgpiod
+// edge events. open() fails (and the caller falls back to polling) when
+// libgpiod is unavailable or the line cannot be requested.
+class GpiodDataReadySource final : public TofDataReadySource {
+public:
+  GpiodDataReadySource();
+  ~GpiodDataReadySource() override;
+
+  GpiodDataReadySource(const GpiodDataReadySource &) = delete;
+  GpiodDataReadySource &operator=(const GpiodDataReadySource &) = delete;
+
+  // activeLow: falling edges with a pull-up, else rising with a pull-down.
+  bool open(int lineOffset, bool activeLow);
+
+  const char *name() const override { return "gpio"; }
+  bool wait(int timeoutMs, int64_t &edgeNs) override;
+  // Re-requests the line with the other edge if the polarity differs.
+  bool setActiveLow(bool activeLow) override;
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+  int lineOffset_ = -1;
+  bool activeLow_ = true;
+};
+
+// Edges injected in software, either explicitly via inject() or by an
+// internal ticker emulating the sensor's measurement period.
+class SoftwareDataReadySource final : public TofDataReadySource {
+public:
+  // periodMs > 0 starts a ticker thread that injects an edge every period;
+  // setMeasurementPeriodMs() retunes it.
+  explicit SoftwareDataReadySource(int periodMs = 0);
+  ~SoftwareDataReadySource() override;
+
+  void inject(int64_t edgeNs = 0);
+  uint64_t injectedCount() const;
+
+  const char *name() const override { return "sim"; }
+  bool wait(int timeoutMs, int64_t &edgeNs) override;
+  void setMeasurementPeriodMs(int periodMs) override;
+
+private:
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  uint64_t injected_ = 0;
+  uint64_t consumed_ = 0;
+  int64_t lastEdgeNs_ = 0;
+  bool stopping_ = false;
+  int periodMs_ = 0;
+  uint64_t periodGeneration_ = 0;
+  std::thread ticker_;
+};
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "amust_config.h"
+#include "tof_backend.h"
+
+// Streaming distance conditioning between a backend and the UI. Everything
+// here is fixed-size and allocation-free; per-sample cost is bounded by the
+// compile-time window, so it keeps up with 100 Hz ranging on the acquisition
+// thread.
+
+// Median of the last N values. Keeps a time-ordered ring plus a sorted copy,
+// so each push is one remove + one insert over N elements.
+template <size_t N> class RollingMedian final {
+  static_assert(N >= 1, "RollingMedian window must be non-empty");
+
+public:
+  int push(int value) {
+    if (count_ == N) {
+      const int oldest = ring_[head_];
+      size_t i = 0;
+      while (i < count_ && sorted_[i] != oldest)
+        i++;
+      for (; i + 1 < count_; i++)
+        sorted_[i] = sorted_[i + 1];
+      count_--;
+    }
+    ring_[head_] = value;
+    head_ = (head_ + 1) % N;
+
+    size_t i = count_;
+    while (i > 0 && sorted_[i - 1] > value) {
+      sorted_[i] = sorted_[i - 1];
+      i--;
+    }
+    sorted_[i] = value;
+    count_++;
+    return sorted_[count_ / 2];
+  }
+
+  void reset() {
+    head_ = 0;
+    count_ = 0;
+  }
+  size_t size() const { return count_; }
+
+private:
+  std::array<int, N> ring_{};
+  std::array<int, N> sorted_{};
+  size_t head_ = 0;
+  size_t count_ = 0;
+};
+
+// 1-D alpha-beta tracker (steady-state Kalman for constant velocity).
+class AlphaBetaTracker final {
+public:
+  AlphaBetaTracker(double alpha, double beta) : alpha_(alpha), beta_(beta) {}
+
+  double update(double measured, double dtSeconds) {
+    if (!initialized_ || dtSeconds <= 0.0) {
+      position_ = measured;
+      velocity_ = 0.0;
+      initialized_ = true;
+      return position_;
+    }
+    const double predicted = position_ + velocity_ * dtSeconds;
+    const double residual = measured - predicted;
+    position_ = predicted + alpha_ * residual;
+    velocity_ += (beta_ / dtSeconds) * residual;
+    return position_;
+  }
+
+  void reset() { initialized_ = false; }
+
+private:
+  double alpha_;
+  double beta_;
+  double position_ = 0.0;
+  double velocity_ = 0.0;
+  bool initialized_ = false;
+};
+
+// Maps a distance onto the guidance window. The window edges move outwards
+// by `hysteresisMm` while inside it and inwards while outside, so a reading
+// sitting on an edge cannot toggle the zone every sample.
+class TofZoneClassifier final {
+public:
+  TofZoneClassifier(int minMm, int maxMm, int hysteresisMm)
+      : minMm_(minMm), maxMm_(maxMm), hysteresisMm_(hysteresisMm) {}
+
+  TofZone classify(int mm) {
+    if (mm < 0) {
+      zone_ = TofZone::NoTarget;
+      return zone_;
+    }
+    const int h = zone_ == TofZone::Ok ? hysteresisMm_ : -hysteresisMm_;
+    const int lo = minMm_ - h;
+    const int hi = maxMm_ + h;
+    if (mm < lo)
+      zone_ = TofZone::TooClose;
+    else if (mm > hi)
+      zone_ = TofZone::TooFar;
+    else
+      zone_ = TofZone::Ok;
+    return zone_;
+  }
+
+  TofZone zone() const { return zone_; }
+  void reset() { zone_ = TofZone::NoTarget; }
+
+private:
+  int minMm_;
+  int maxMm_;
+  int hysteresisMm_;
+  TofZone zone_ = TofZone::NoTarget;
+};
+
+// Full stage: range-status outlier rejection -> rolling median -> optional
+// alpha-beta tracker -> hysteresis zone. Rejected samples hold the last good
+// estimate for up to `kTofMaxHeldSamples`, then report no target.
+template <size_t Window = static_cast<size_t>(AmustConfig::kTofMedianWindow)>
+class TofDistanceFilter final {
+public:
+  TofDistanceFilter()
+      : tracker_(AmustConfig::kTofTrackerAlpha, AmustConfig::kTofTrackerBeta),
+        classifier_(AmustConfig::kTofMinMm, AmustConfig::kTofMaxMm, AmustConfig::kTofHysteresisMm) {}
+
+  TofSample process(const TofSample &in) {
+    TofSample out = in;
+    out.rawDistanceMm = in.distanceMm;
+
+    const bool valid = in.rangeStatus == 0 && in.distanceMm > 0;
+    if (!valid) {
+      rejected_++;
+      if (held_ < AmustConfig::kTofMaxHeldSamples && lastMm_ >= 0) {
+        held_++;
+        out.distanceMm = lastMm_;
+      } else {
+        resetEstimate();
+        out.distanceMm = -1;
+      }
+      out.zone = classifier_.classify(out.distanceMm);
+      return out;
+    }
+
+    held_ = 0;
+    const int median = median_.push(in.distanceMm);
+    double estimate = median;
+    if (AmustConfig::kTofTrackerEnabled) {
+      const double dt = lastTimestampNs_ > 0 ? (in.timestampNs - lastTimestampNs_) * 1e-9 : 0.0;
+      estimate = tracker_.update(median, dt);
+    }
+    lastTimestampNs_ = in.timestampNs;
+    lastMm_ = static_cast<int>(estimate + 0.5);
+
+    out.distanceMm = lastMm_;
+    out.zone = classifier_.classify(lastMm_);
+    return out;
+  }
+
+  uint64_t rejectedCount() const { return rejected_; }
+
+  void reset() {
+    resetEstimate();
+    classifier_.reset();
+  }
+
+private:
+  void resetEstimate() {
+    median_.reset();
+    tracker_.reset();
+    lastMm_ = -1;
+    lastTimestampNs_ = 0;
+    held_ = 0;
+  }
+
+  RollingMedian<Window> median_;
+  AlphaBetaTracker tracker_;
+  TofZoneClassifier classifier_;
+  int lastMm_ = -1;
+  int64_t lastTimestampNs_ = 0;
+  int held_ = 0;
+  uint64_t rejected_ = 0;
+};
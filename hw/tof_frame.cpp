@@ -0,0 +1,215 @@
+#include "tof_frame.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+uint16_t rd16(const uint8_t *p) {
+  return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint64_t rd64(const uint8_t *p) {
+  uint64_t v = 0;
+  for (int i = 7; i >= 0; i--)
+    v = (v << 8) | p[i];
+  return v;
+}
+
+void wr16(uint8_t *p, uint16_t v) {
+  p[0] = static_cast<uint8_t>(v & 0xFF);
+  p[1] = static_cast<uint8_t>(v >> 8);
+}
+
+void wr64(uint8_t *p, uint64_t v) {
+  for (int i = 0; i < 8; i++)
+    p[i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+uint16_t toRateUnits(int kcps) {
+  return static_cast<uint16_t>(std::clamp(kcps / 8, 0, 0xFFFF));
+}
+
+} // namespace
+
+uint16_t TofFrame::crc16(const uint8_t *data, size_t len) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= static_cast<uint16_t>(data[i] << 8);
+    for (int bit = 0; bit < 8; bit++) {
+      const bool msb = (crc & 0x8000) != 0;
+      crc = static_cast<uint16_t>(crc << 1);
+      if (msb)
+        crc ^= 0x1021;
+    }
+  }
+  return crc;
+}
+
+void TofFrame::encode(const TofSample &sample, uint16_t sequence, uint8_t (&out)[kSize]) {
+  out[0] = kMagic0;
+  out[1] = kMagic1;
+  out[2] = kVersion;
+  out[3] = static_cast<uint8_t>(kSize);
+  wr16(out + 4, sequence);
+  const int16_t mm = static_cast<int16_t>(std::clamp(sample.distanceMm, -1, 0x7FFF));
+  wr16(out + 6, static_cast<uint16_t>(mm));
+  wr64(out + 8, static_cast<uint64_t>(sample.timestampNs));
+  out[16] = static_cast<uint8_t>(std::clamp(sample.rangeStatus, 0, 255));
+  out[17] = 0;
+  wr16(out + 18, toRateUnits(sample.signalRateKcps));
+  wr16(out + 20, toRateUnits(sample.ambientRateKcps));
+  wr16(out + 22, crc16(out, kSize - 2));
+}
+
+size_t TofFrame::decode(const uint8_t *data, size_t len, TofSample &out, uint16_t &sequence) {
+  if (len < 4 || data[0] != kMagic0 || data[1] != kMagic1 || data[2] < 1)
+    return 0;
+  const size_t size = data[3];
+  if (size < kSize || size > kMaxSize || len < size)
+    return 0;
+  if (crc16(data, size - 2) != rd16(data + size - 2))
+    return 0;
+
+  sequence = rd16(data + 4);
+  out.distanceMm = static_cast<int16_t>(rd16(data + 6));
+  out.timestampNs = static_cast<int64_t>(rd64(data + 8));
+  out.rangeStatus = data[16];
+  out.signalRateKcps = rd16(data + 18) * 8;
+  out.ambientRateKcps = rd16(data + 20) * 8;
+  return size;
+}
+
+uint8_t *TofFrameDecoder::writePtr() {
+  if (begin_ > 0) {
+    std::memmove(buf_, buf_ + begin_, end_ - begin_);
+    end_ -= begin_;
+    begin_ = 0;
+  }
+  return buf_ + end_;
+}
+
+size_t TofFrameDecoder::feed(const uint8_t *data, size_t len) {
+  uint8_t *dst = writePtr();
+  const size_t n = std::min(len, writable());
+  std::memcpy(dst, data, n);
+  commit(n);
+  return n;
+}
+
+void TofFrameDecoder::reset() {
+  begin_ = end_ = 0;
+  line_ = LineState::Empty;
+  lineNegative_ = false;
+  lineDigits_ = 0;
+  lineValue_ = 0;
+  haveSequence_ = false;
+}
+
+bool TofFrameDecoder::next(TofSample &out) {
+  while (begin_ < end_) {
+    const uint8_t b = buf_[begin_];
+
+    if (b == TofFrame::kMagic0) {
+      // A frame always interrupts a partial text line.
+      line_ = LineState::Empty;
+      lineNegative_ = false;
+      lineDigits_ = 0;
+      lineValue_ = 0;
+
+      const size_t avail = end_ - begin_;
+      if (avail < 4)
+        return false;
+      const size_t size = buf_[begin_ + 3];
+      const bool plausible = buf_[begin_ + 1] == TofFrame::kMagic1 && buf_[begin_ + 2] >= 1 &&
+                             size >= TofFrame::kSize && size <= TofFrame::kMaxSize;
+      if (plausible) {
+        if (avail < size)
+          return false;
+        if (tryFrame(out))
+          return true;
+        // A corrupt frame: none of its bytes may reach the text parser (a
+        // payload with digits and 0x0A would read as a distance). Drop it
+        // up to the next magic byte inside it, where a real frame may start
+        // after a truncated one, and the text line it interrupted.
+        const uint8_t *frame = buf_ + begin_;
+        const uint8_t *resync = std::find(frame + 1, frame + size, TofFrame::kMagic0);
+        const size_t skipped = static_cast<size_t>(resync - frame);
+        begin_ += skipped;
+        stats_.resyncBytes += skipped;
+        line_ = LineState::Garbage;
+        continue;
+      }
+      begin_++;
+      stats_.resyncBytes++;
+      continue;
+    }
+
+    begin_++;
+    if (b == '\n') {
+      if (finishLine(out))
+        return true;
+      continue;
+    }
+    if (b == '\r' || b == ' ' || b == '\t')
+      continue;
+    if (line_ == LineState::Garbage) {
+      stats_.resyncBytes++;
+      continue;
+    }
+    if (b >= '0' && b <= '9') {
+      if (lineDigits_ >= 9) {
+        line_ = LineState::Garbage;
+        continue;
+      }
+      line_ = LineState::Number;
+      lineValue_ = lineValue_ * 10 + (b - '0');
+      lineDigits_++;
+      continue;
+    }
+    if (b == '-' && line_ == LineState::Empty && !lineNegative_) {
+      lineNegative_ = true;
+      continue;
+    }
+    line_ = LineState::Garbage;
+    stats_.resyncBytes++;
+  }
+  return false;
+}
+
+bool TofFrameDecoder::tryFrame(TofSample &out) {
+  // next() has checked the header and that the whole record is buffered.
+  uint16_t seq = 0;
+  const size_t size = TofFrame::decode(buf_ + begin_, end_ - begin_, out, seq);
+  if (size == 0) {
+    stats_.crcErrors++;
+    return false;
+  }
+
+  if (haveSequence_ && seq != static_cast<uint16_t>(lastSequence_ + 1))
+    stats_.sequenceGaps++;
+  haveSequence_ = true;
+  lastSequence_ = seq;
+
+  begin_ += size;
+  stats_.frames++;
+  return true;
+}
+
+bool TofFrameDecoder::finishLine(TofSample &out) {
+  const bool ok = line_ == LineState::Number && lineDigits_ > 0;
+  if (ok) {
+    const int mm = lineNegative_ ? -lineValue_ : lineValue_;
+    out.timestampNs = 0;
+    out.distanceMm = std::max(-1, mm);
+    out.rangeStatus = 0;
+    out.signalRateKcps = 0;
+    out.ambientRateKcps = 0;
+    stats_.textLines++;
+  }
+  line_ = LineState::Empty;
+  lineNegative_ = false;
+  lineDigits_ = 0;
+  lineValue_ = 0;
+  return ok;
+}
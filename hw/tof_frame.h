@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "tof_backend.h"
+
+// Fixed-size little-endian sample record shared by TOF.py and any other
+// sensor producer. Version 1 is 24 bytes:
+//
+//    0  u8   magic 0xA5
+//    1  u8   magic 0x5A
+//    2  u8   version
+//    3  u8   record size; the CRC is always the last two bytes, so newer
+//            versions may append fields and still be read as v1
+//    4  u16  sequence (wraps)
+//    6  i16  distance mm (-1 = no target)
+//    8  u64  timestamp ns, CLOCK_MONOTONIC of the producer
+//   16  u8   range status (ULD numbering, 0 = valid)
+//   17  u8   reserved
+//   18  u16  signal rate, 8 kcps units
+//   20  u16  ambient rate, 8 kcps units
+//   22  u16  CRC-16/CCITT-FALSE over the preceding bytes
+//
+// The magic bytes never occur in the legacy text output (one decimal
+// distance per line), so both can be decoded from the same stream.
+namespace TofFrame {
+inline constexpr uint8_t kMagic0 = 0xA5;
+inline constexpr uint8_t kMagic1 = 0x5A;
+inline constexpr uint8_t kVersion = 1;
+inline constexpr size_t kSize = 24;
+inline constexpr size_t kMaxSize = 64;
+
+uint16_t crc16(const uint8_t *data, size_t len);
+void encode(const TofSample &sample, uint16_t sequence, uint8_t (&out)[kSize]);
+// Decodes the frame starting at `data` if it is complete and its CRC holds.
+// Returns the record size consumed, or 0.
+size_t decode(const uint8_t *data, size_t len, TofSample &out, uint16_t &sequence);
+} // namespace TofFrame
+
+// Incremental, allocation-free decoder for a byte stream carrying binary
+// frames and/or text lines. Bytes are written straight into the internal
+// buffer (writePtr()/commit()) and samples pulled with next(). Corrupt or
+// truncated data is skipped until the next frame or line boundary.
+class TofFrameDecoder final {
+public:
+  struct Stats {
+    uint64_t frames = 0;
+    uint64_t textLines = 0;
+    uint64_t crcErrors = 0;
+    uint64_t resyncBytes = 0; // bytes discarded while searching for sync
+    uint64_t sequenceGaps = 0;
+  };
+
+  static constexpr size_t kBufferSize = 4096;
+
+  uint8_t *writePtr();
+  size_t writable() const { return kBufferSize - end_; }
+  void commit(size_t n) { end_ += n; }
+  // Copies `len` bytes in; returns how many fit.
+  size_t feed(const uint8_t *data, size_t len);
+
+  // Text-line samples carry timestampNs == 0; the caller stamps them.
+  bool next(TofSample &out);
+
+  void reset();
+  const Stats &stats() const { return stats_; }
+
+private:
+  enum class LineState { Empty, Number, Garbage };
+
+  bool tryFrame(TofSample &out);
+  bool finishLine(TofSample &out);
+
+  uint8_t buf_[kBufferSize];
+  size_t begin_ = 0;
+  size_t end_ = 0;
+
+  LineState line_ = LineState::Empty;
+  bool lineNegative_ = false;
+  int lineDigits_ = 0;
+  int lineValue_ = 0;
+
+  bool haveSequence_ = false;
+  uint16_t lastSequence_ = 0;
+  Stats stats_;
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+// Fuses readings of several downward-facing sensors into the distance at the
+// head's centre and the tilt between the head and the surface, by least
+// squares on z = a + b*x + c*y. Two sensors (or collinear ones) give the tilt
+// along their axis only; a single sensor gives no tilt.
+struct TofPoint {
+  double xMm = 0.0;
+  double yMm = 0.0;
+  double zMm = 0.0;
+};
+
+struct TofFusedDistance {
+  double distanceMm = -1.0;
+  double tiltDeg = -1.0; // -1 = unknown
+};
+
+inline TofFusedDistance fuseTofPoints(const TofPoint *points, size_t n) {
+  constexpr double kRadToDeg = 57.29577951308232;
+  TofFusedDistance out;
+  if (n == 0)
+    return out;
+  if (n == 1) {
+    out.distanceMm = points[0].zMm;
+    return out;
+  }
+
+  // Centre the positions so the normal equations stay well conditioned.
+  double mx = 0.0, my = 0.0, mz = 0.0;
+  for (size_t i = 0; i < n; i++) {
+    mx += points[i].xMm;
+    my += points[i].yMm;
+    mz += points[i].zMm;
+  }
+  mx /= n;
+  my /= n;
+  mz /= n;
+
+  double sxx = 0.0, sxy = 0.0, syy = 0.0, sxz = 0.0, syz = 0.0;
+  for (size_t i = 0; i < n; i++) {
+    const double dx = points[i].xMm - mx;
+    const double dy = points[i].yMm - my;
+    const double dz = points[i].zMm - mz;
+    sxx += dx * dx;
+    sxy += dx * dy;
+    syy += dy * dy;
+    sxz += dx * dz;
+    syz += dy * dz;
+  }
+
+  double b = 0.0, c = 0.0;
+  const double det = sxx * syy - sxy * sxy;
+  const double scale = sxx + syy;
+  if (scale <= 0.0) {
+    // All sensors at the same spot: nothing to fit a slope to.
+    out.distanceMm = mz;
+    return out;
+  }
+  if (det > 1e-9 * scale * scale) {
+    b = (sxz * syy - syz * sxy) / det;
+    c = (syz * sxx - sxz * sxy) / det;
+  } else {
+    // Collinear: fit along the principal axis of the positions.
+    const double angle = 0.5 * std::atan2(2.0 * sxy, sxx - syy);
+    const double ux = std::cos(angle);
+    const double uy = std::sin(angle);
+    double stt = 0.0, stz = 0.0;
+    for (size_t i = 0; i < n; i++) {
+      const double t = (points[i].xMm - mx) * ux + (points[i].yMm - my) * uy;
+      stt += t * t;
+      stz += t * (points[i].zMm - mz);
+    }
+    const double m = stt > 0.0 ? stz / stt : 0.0;
+    b = m * ux;
+    c = m * uy;
+  }
+
+  out.distanceMm = mz - b * mx - c * my;
+  out.tiltDeg = std::atan(std::sqrt(b * b + c * c)) * kRadToDeg;
+  return out;
+}
@@ -0,0 +1,250 @@
+#include "tof_native_backend.h"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace {
+// Data-ready poll spacing; ~10 checks per 33 ms measurement.
+constexpr auto kDataReadyPollInterval = std::chrono::milliseconds(3);
+// Slack between scan measurements to reprogram the ROI before the next one.
+constexpr int kScanRoiSetupMs = 4;
+} // namespace
+
+TofNativeBackend::TofNativeBackend(I2cTransport *transport) : externalTransport_(transport) {}
+
+TofNativeBackend::~TofNativeBackend() {
+  close();
+}
+
+void TofNativeBackend::setDataReadySource(std::unique_ptr<TofDataReadySource> source) {
+  dataReady_ = std::move(source);
+}
+
+bool TofNativeBackend::open(const TofBackendConfig &config) {
+  close();
+
+  I2cTransport *transport = externalTransport_;
+  if (!transport) {
+    if (!linuxTransport_.open(config.bus)) {
+      qWarning() << "ToF: cannot open /dev/i2c-" << config.bus;
+      return false;
+    }
+    transport = &linuxTransport_;
+  }
+
+  auto sensor = std::make_unique<Vl53l1x>(*transport, static_cast<uint8_t>(config.address));
+  setupScanGrid(config.scanColumns, config.scanRows);
+  const bool ok = sensor->init() && configure(*sensor, config.profile) &&
+                  (scanCentres_.empty() || restartScan(*sensor)) && sensor->startRanging();
+  if (!ok) {
+    qWarning().noquote() << "ToF: VL53L1X init failed at address"
+                        << QStringLiteral("0x%1").arg(config.address, 2, 16, QLatin1Char('0'));
+    linuxTransport_.close();
+    return false;
+  }
+
+  // Watch the edge the sensor actually asserts, whatever its GPIO1 polarity.
+  uint8_t polarity = 0;
+  if (dataReady_ &&
+      (!sensor->interruptPolarity(polarity) || !dataReady_->setActiveLow(polarity == 0))) {
+    qWarning() << "ToF: GPIO1 data-ready cannot follow the sensor's polarity; polling instead";
+    dataReady_.reset();
+  }
+
+  sensor_ = std::move(sensor);
+  if (dataReady_)
+    qInfo() << "ToF: data-ready via" << dataReady_->name();
+  if (!scanCentres_.empty())
+    qInfo() << "ToF: ROI scan" << scanBack_.columns << "x" << scanBack_.rows;
+  return true;
+}
+
+void TofNativeBackend::setupScanGrid(int columns, int rows) {
+  scanCentres_.clear();
+  scanFrontReady_ = false;
+  scanBack_ = TofDepthMap{};
+  if (columns <= 0 || rows <= 0)
+    return;
+
+  // The smallest ROI is 4x4 SPADs, so the 16x16 array gives at most 4x4.
+  columns = std::min(columns, 4);
+  rows = std::min(rows, 4);
+  const int width = 16 / columns;
+  const int height = 16 / rows;
+  for (int r = 0; r < rows; r++) {
+    for (int c = 0; c < columns; c++)
+      scanCentres_.push_back(Vl53l1x::roiCenterSpad(c * width + width / 2, r * height + height / 2 - 1));
+  }
+  scanBack_.columns = columns;
+  scanBack_.rows = rows;
+  for (int16_t &mm : scanBack_.distanceMm)
+    mm = -1;
+}
+
+bool TofNativeBackend::restartScan(Vl53l1x &sensor) {
+  scanZone_ = 0;
+  return sensor.setRoi(16 / scanBack_.columns, 16 / scanBack_.rows) &&
+         sensor.setRoiCenter(scanCentres_.front());
+}
+
+bool TofNativeBackend::applyProfile(const TofRangingProfile &profile) {
+  if (!sensor_)
+    return false;
+  // The ULD only latches timing changes between measurements; stop, rewrite
+  // and restart. The device keeps its calibration, so this is a few ms.
+  const int previousBudgetMs = sensor_->timingBudgetMs();
+  const Vl53l1x::DistanceMode previousMode = sensor_->distanceMode();
+  bool ok = sensor_->stopRanging() && configure(*sensor_, profile);
+  if (!scanCentres_.empty())
+    restartScan(*sensor_);
+  if (!ok) {
+    qWarning() << "ToF: cannot apply ranging profile" << profile.name;
+    TofRangingProfile previous;
+    previous.distanceMode = previousMode == Vl53l1x::DistanceMode::Short
+                                ? TofRangingProfile::DistanceMode::Short
+                                : TofRangingProfile::DistanceMode::Long;
+    previous.timingBudgetMs = previousBudgetMs;
+    previous.interMeasurementMs = interMeasurementMs_;
+    configure(*sensor_, previous);
+  }
+  sensor_->clearInterrupt();
+  sensor_->startRanging();
+  return ok;
+}
+
+bool TofNativeBackend::configure(Vl53l1x &sensor, const TofRangingProfile &profile) {
+  const Vl53l1x::DistanceMode mode = profile.distanceMode == TofRangingProfile::DistanceMode::Short
+                                         ? Vl53l1x::DistanceMode::Short
+                                         : Vl53l1x::DistanceMode::Long;
+  // A scan ranges back-to-back whatever the profile's period: the frame rate
+  // is already divided by the number of zones.
+  const int periodMs = scanCentres_.empty()
+                           ? std::max(profile.timingBudgetMs, profile.interMeasurementMs)
+                           : profile.timingBudgetMs + kScanRoiSetupMs;
+  if (!sensor.setDistanceMode(mode) || !sensor.setTimingBudgetMs(profile.timingBudgetMs) ||
+      !sensor.setInterMeasurementMs(periodMs))
+    return false;
+  interMeasurementMs_ = periodMs;
+  if (dataReady_)
+    dataReady_->setMeasurementPeriodMs(periodMs);
+  return true;
+}
+
+void TofNativeBackend::close() {
+  if (sensor_) {
+    sensor_->stopRanging();
+    sensor_.reset();
+  }
+  linuxTransport_.close();
+  scanCentres_.clear();
+  scanFrontReady_ = false;
+}
+
+bool TofNativeBackend::waitForResult(int timeoutMs, int64_t &edgeNs) {
+  if (dataReady_) {
+    // Confirm with the status register either way: it filters stale queued
+    // edges, and on timeout it catches an edge that fired before we started
+    // waiting (e.g. the first measurement), which would never re-trigger.
+    if (!dataReady_->wait(timeoutMs, edgeNs))
+      edgeNs = tofNowNs();
+    bool ready = false;
+    return sensor_->checkForDataReady(ready) && ready;
+  }
+
+  using Clock = std::chrono::steady_clock;
+  const auto deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+  for (;;) {
+    bool ready = false;
+    if (!sensor_->checkForDataReady(ready))
+      return false;
+    if (ready)
+      break;
+    if (Clock::now() >= deadline)
+      return false;
+    std::this_thread::sleep_for(kDataReadyPollInterval);
+  }
+  edgeNs = tofNowNs();
+  return true;
+}
+
+bool TofNativeBackend::read(TofSample &out, int timeoutMs) {
+  if (!sensor_)
+    return false;
+  if (!scanCentres_.empty())
+    return readScan(out, timeoutMs);
+
+  int64_t edgeNs = 0;
+  if (!waitForResult(timeoutMs, edgeNs))
+    return false;
+
+  Vl53l1x::Result result;
+  const bool ok = sensor_->readResult(result);
+  sensor_->clearInterrupt();
+  if (!ok)
+    return false;
+
+  out.timestampNs = edgeNs;
+  out.distanceMm = result.distanceMm;
+  out.rangeStatus = result.rangeStatus;
+  out.signalRateKcps = result.signalRateKcps;
+  out.ambientRateKcps = result.ambientRateKcps;
+  return true;
+}
+
+bool TofNativeBackend::readScan(TofSample &out, int timeoutMs) {
+  const int zones = static_cast<int>(scanCentres_.size());
+  const int64_t deadlineNs = tofNowNs() + static_cast<int64_t>(timeoutMs) * 1'000'000;
+  for (;;) {
+    const int remainingMs = static_cast<int>((deadlineNs - tofNowNs()) / 1'000'000);
+    if (remainingMs <= 0)
+      return false;
+    int64_t edgeNs = 0;
+    if (!waitForResult(remainingMs, edgeNs))
+      continue;
+
+    Vl53l1x::Result result;
+    const bool ok = sensor_->readResult(result);
+    // Program the next zone before the clear releases the next measurement.
+    const int zone = scanZone_;
+    scanZone_ = (scanZone_ + 1) % zones;
+    sensor_->setRoiCenter(scanCentres_[static_cast<size_t>(scanZone_)]);
+    sensor_->clearInterrupt();
+
+    const bool valid = ok && result.rangeStatus == 0 && result.distanceMm > 0;
+    scanBack_.distanceMm[zone] = static_cast<int16_t>(valid ? result.distanceMm : -1);
+    if (zone != zones - 1)
+      continue;
+
+    // Frame complete: publish it and keep assembling into the back buffer.
+    scanBack_.timestampNs = edgeNs;
+    scanBack_.frame++;
+    scanFront_ = scanBack_;
+    scanFrontReady_ = true;
+
+    // The distance sample of a scan is the median over the valid zones.
+    int zonesMm[TofDepthMap::kMaxZones];
+    int n = 0;
+    for (int i = 0; i < zones; i++) {
+      if (scanFront_.distanceMm[i] > 0)
+        zonesMm[n++] = scanFront_.distanceMm[i];
+    }
+    std::nth_element(zonesMm, zonesMm + n / 2, zonesMm + n);
+    out.timestampNs = edgeNs;
+    out.distanceMm = n > 0 ? zonesMm[n / 2] : -1;
+    out.rangeStatus = n > 0 ? 0 : 255;
+    out.signalRateKcps = 0;
+    out.ambientRateKcps = 0;
+    return true;
+  }
+}
+
+bool TofNativeBackend::takeDepthMap(TofDepthMap &out) {
+  if (!scanFrontReady_)
+    return false;
+  out = scanFront_;
+  scanFrontReady_ = false;
+  return true;
+}
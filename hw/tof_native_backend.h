@@ -0,0 +1,53 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "i2c_transport.h"
+#include "tof_backend.h"
+#include "tof_data_ready.h"
+#include "vl53l1x.h"
+
+// In-process VL53L1X driver over /dev/i2c-N or an injected transport. With a
+// data-ready source the result is read on the GPIO1 edge; without one the
+// status register is polled. The ranging profile can change while open. In
+// scan mode it cycles the SPAD ROI over a grid and also yields depth maps.
+class TofNativeBackend final : public TofBackend {
+public:
+  TofNativeBackend() = default;
+  // Uses `transport` instead of opening /dev/i2c-N; not owned.
+  explicit TofNativeBackend(I2cTransport *transport);
+  ~TofNativeBackend() override;
+
+  // Takes effect on the next open().
+  void setDataReadySource(std::unique_ptr<TofDataReadySource> source);
+
+  const char *name() const override { return "native"; }
+  bool open(const TofBackendConfig &config) override;
+  void close() override;
+  bool isOpen() const override { return sensor_ != nullptr; }
+  bool read(TofSample &out, int timeoutMs) override;
+  bool applyProfile(const TofRangingProfile &profile) override;
+  bool takeDepthMap(TofDepthMap &out) override;
+
+private:
+  bool configure(Vl53l1x &sensor, const TofRangingProfile &profile);
+  bool waitForResult(int timeoutMs, int64_t &edgeNs);
+  // ROI scan (config.scanColumns x scanRows): one zone per measurement,
+  // assembled in scanBack_ and published to scanFront_ per full frame.
+  void setupScanGrid(int columns, int rows);
+  bool restartScan(Vl53l1x &sensor);
+  bool readScan(TofSample &out, int timeoutMs);
+
+  I2cTransport *externalTransport_ = nullptr;
+  LinuxI2cTransport linuxTransport_;
+  std::unique_ptr<Vl53l1x> sensor_;
+  std::unique_ptr<TofDataReadySource> dataReady_;
+  int interMeasurementMs_ = 0;
+
+  std::vector<uint8_t> scanCentres_; // empty = full-array ranging
+  int scanZone_ = 0;
+  TofDepthMap scanBack_;
+  TofDepthMap scanFront_;
+  bool scanFrontReady_ = false;
+};
@@ -0,0 +1,176 @@
+#include "tof_python_backend.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+
+#include <algorithm>
+
+namespace {
+QString sanitizeLine(const QByteArray &data) {
+  return QString::fromUtf8(data).trimmed();
+}
+
+// "<mode> <budget ms> <inter-measurement ms>", as TOF.py's --profile and its
+// stdin "profile ..." command expect.
+QByteArray profileArgs(const TofRangingProfile &profile) {
+  const QByteArray mode =
+      profile.distanceMode == TofRangingProfile::DistanceMode::Short ? "short" : "long";
+  return mode + ' ' + QByteArray::number(profile.timingBudgetMs) + ' ' +
+         QByteArray::number(std::max(profile.timingBudgetMs, profile.interMeasurementMs));
+}
+} // namespace
+
+TofPythonBackend::TofPythonBackend(QObject *parent) : QObject(parent) {}
+
+TofPythonBackend::~TofPythonBackend() {
+  close();
+}
+
+bool TofPythonBackend::open(const TofBackendConfig &config) {
+  close();
+
+  decoder_.reset();
+  process_ = new QProcess(this);
+  attachProcessLogging(process_, QStringLiteral("TOF.py"));
+
+  connect(process_, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this,
+          [](int exitCode, QProcess::ExitStatus status) {
+            if (status != QProcess::NormalExit || exitCode != 0) {
+              qWarning() << "TOF.py exited" << exitCode << "status" << status;
+            }
+          });
+
+  QString script = resolveTofScriptPath();
+  if (script.isEmpty())
+    script = QStringLiteral("TOF.py");
+
+  QStringList args;
+  args << script;
+  args << "--bus" << QString::number(config.bus);
+  args << "--addr" << QStringLiteral("0x%1").arg(config.address, 2, 16, QLatin1Char('0'));
+  args << "--interval" << QString::number(std::max(0.05, config.intervalSeconds));
+  // Older scripts only speak text and take no profile; the decoder accepts
+  // either format.
+  supportsProfiles_ = qgetenv("AMUST_TOF_FORMAT").toLower() != "text";
+  if (supportsProfiles_) {
+    args << "--format"
+         << "binary";
+    args << "--profile" << QString::fromLatin1(profileArgs(config.profile));
+  }
+  if (config.durationSeconds > 0.0)
+    args << "--duration" << QString::number(config.durationSeconds);
+
+  const QString python = QStringLiteral("python3");
+  process_->start(python, args);
+  if (!process_->waitForStarted(3000)) {
+    qWarning() << "Failed to start TOF.py:" << process_->errorString();
+    close();
+    return false;
+  }
+  return true;
+}
+
+void TofPythonBackend::close() {
+  if (!process_)
+    return;
+
+  const TofFrameDecoder::Stats &st = decoder_.stats();
+  if (st.crcErrors > 0 || st.sequenceGaps > 0 || st.resyncBytes > 0) {
+    qInfo() << "TOF.py stream: frames" << st.frames << "text" << st.textLines << "crc errors"
+            << st.crcErrors << "gaps" << st.sequenceGaps << "resync bytes" << st.resyncBytes;
+  }
+
+  QObject::disconnect(process_, nullptr, this, nullptr);
+  if (process_->state() != QProcess::NotRunning) {
+    process_->terminate();
+    if (!process_->waitForFinished(1000)) {
+      process_->kill();
+      process_->waitForFinished();
+    }
+  }
+  delete process_;
+  process_ = nullptr;
+}
+
+bool TofPythonBackend::applyProfile(const TofRangingProfile &profile) {
+  if (!isOpen() || !supportsProfiles_)
+    return false;
+  // TOF.py applies it between reads; the process and its I2C session stay up.
+  process_->write("profile " + profileArgs(profile) + '\n');
+  return process_->waitForBytesWritten(100);
+}
+
+bool TofPythonBackend::isOpen() const {
+  return process_ && process_->state() != QProcess::NotRunning;
+}
+
+bool TofPythonBackend::read(TofSample &out, int timeoutMs) {
+  if (!process_)
+    return false;
+
+  QElapsedTimer waited;
+  waited.start();
+  for (;;) {
+    if (decoder_.next(out)) {
+      if (out.timestampNs == 0)
+        out.timestampNs = tofNowNs();
+      return true;
+    }
+
+    if (process_->bytesAvailable() > 0) {
+      uint8_t *dst = decoder_.writePtr();
+      const qint64 n = process_->read(reinterpret_cast<char *>(dst),
+                                      static_cast<qint64>(decoder_.writable()));
+      if (n > 0) {
+        decoder_.commit(static_cast<size_t>(n));
+        continue;
+      }
+    }
+
+    const qint64 remaining = timeoutMs - waited.elapsed();
+    if (remaining <= 0 || process_->state() == QProcess::NotRunning)
+      return false;
+    process_->waitForReadyRead(static_cast<int>(remaining));
+  }
+}
+
+QString TofPythonBackend::resolveTofScriptPath() const {
+  const QByteArray env = qgetenv("AMUST_TOF_SCRIPT");
+  if (!env.isEmpty()) {
+    const QString p = QString::fromUtf8(env);
+    if (QFileInfo::exists(p))
+      return QFileInfo(p).canonicalFilePath();
+  }
+
+  const QString dir = QCoreApplication::applicationDirPath();
+  QStringList candidates;
+  candidates << (dir + QDir::separator() + QStringLiteral("TOF.py"));
+  candidates << (dir + QDir::separator() + QStringLiteral("../TOF.py"));
+  candidates << (dir + QDir::separator() + QStringLiteral("../../TOF.py"));
+  candidates << (dir + QDir::separator() + QStringLiteral("../Resources/TOF.py"));
+  candidates << (dir + QDir::separator() + QStringLiteral("../share/amust/TOF.py"));
+  candidates << (dir + QDir::separator() + QStringLiteral("../../share/amust/TOF.py"));
+  for (const QString &p : candidates) {
+    if (QFileInfo::exists(p))
+      return QFileInfo(p).canonicalFilePath();
+  }
+  return QString();
+}
+
+void TofPythonBackend::attachProcessLogging(QProcess *process, const QString &label) {
+  connect(process, &QProcess::readyReadStandardError, this, [process, label]() {
+    if (!process)
+      return;
+    const QString line = sanitizeLine(process->readAllStandardError());
+    if (!line.isEmpty())
+      qWarning().noquote() << label << ":" << line;
+  });
+  connect(process, &QProcess::errorOccurred, this, [process, label](QProcess::ProcessError error) {
+    if (!process)
+      return;
+    qWarning() << label << "error" << error << process->errorString();
+  });
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <QObject>
+#include <QProcess>
+
+#include "tof_backend.h"
+#include "tof_frame.h"
+
+// Fallback backend: runs `python3 TOF.py` and decodes its stdout (binary
+// frames, or text lines with AMUST_TOF_FORMAT=text). Lives on the
+// acquisition thread, so it only uses QProcess's blocking waitFor* API.
+class TofPythonBackend final : public QObject, public TofBackend {
+  Q_OBJECT
+
+public:
+  explicit TofPythonBackend(QObject *parent = nullptr);
+  ~TofPythonBackend() override;
+
+  const char *name() const override { return "python"; }
+  bool open(const TofBackendConfig &config) override;
+  void close() override;
+  bool isOpen() const override;
+  bool read(TofSample &out, int timeoutMs) override;
+  bool applyProfile(const TofRangingProfile &profile) override;
+
+private:
+  QString resolveTofScriptPath() const;
+  void attachProcessLogging(QProcess *process, const QString &label);
+
+  QProcess *process_ = nullptr;
+  TofFrameDecoder decoder_;
+  bool supportsProfiles_ = false;
+};
@@ -0,0 +1,220 @@
+#include "tof_replay_backend.h"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "amust_config.h"
+#include "tof_frame.h"
+
+namespace {
+// Longest pause played back; anything above the heartbeat timeout would make
+// the supervisor restart the replay.
+constexpr int64_t kMaxGapNs = 1'000'000'000;
+// Synthetic sweep: 50 Hz, one min -> max -> min cycle every 8 s.
+constexpr int kSweepPeriodMs = 20;
+constexpr int kSweepSamples = 400;
+} // namespace
+
+TofReplayBackend::TofReplayBackend(std::string path, double speed)
+    : path_(std::move(path)), speed_(std::max(0.0, speed)) {}
+
+TofReplayBackend::~TofReplayBackend() {
+  close();
+}
+
+bool TofReplayBackend::open(const TofBackendConfig &config) {
+  (void)config;
+  close();
+  if (path_ == "sim") {
+    buildSweep();
+  } else if (!mapFile()) {
+    qWarning() << "ToF: cannot map replay trace" << path_.c_str();
+    return false;
+  }
+
+  rewind();
+  if (!nextRecord(pending_)) {
+    qWarning() << "ToF: replay trace" << path_.c_str() << "holds no valid frames";
+    close();
+    return false;
+  }
+  havePending_ = true;
+  lastTraceNs_ = pending_.timestampNs;
+  if (speed_ > 0.0)
+    qInfo() << "ToF: replaying" << path_.c_str() << "at" << speed_ << "x";
+  else
+    qInfo() << "ToF: replaying" << path_.c_str() << "as fast as possible";
+  return true;
+}
+
+bool TofReplayBackend::mapFile() {
+#if defined(__linux__) || defined(__APPLE__)
+  const int fd = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+  struct stat st {};
+  void *mapping = MAP_FAILED;
+  if (::fstat(fd, &st) == 0 && st.st_size > 0)
+    mapping = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED)
+    return false;
+  ::madvise(mapping, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+  mapping_ = mapping;
+  data_ = static_cast<const uint8_t *>(mapping);
+  size_ = static_cast<size_t>(st.st_size);
+  return true;
+#else
+  return false;
+#endif
+}
+
+void TofReplayBackend::buildSweep() {
+  sweep_.resize(kSweepSamples * TofFrame::kSize);
+  const int spanMm = AmustConfig::kTofSimMaxMm - AmustConfig::kTofSimMinMm;
+  for (int i = 0; i < kSweepSamples; i++) {
+    // Triangle wave, so the guidance zones are crossed in both directions.
+    const double phase = static_cast<double>(i) / kSweepSamples;
+    const double up = phase < 0.5 ? phase * 2.0 : (1.0 - phase) * 2.0;
+    TofSample sample;
+    sample.timestampNs = static_cast<int64_t>(i) * kSweepPeriodMs * 1'000'000;
+    sample.distanceMm = AmustConfig::kTofSimMinMm + static_cast<int>(std::lround(up * spanMm));
+    uint8_t frame[TofFrame::kSize];
+    TofFrame::encode(sample, static_cast<uint16_t>(i), frame);
+    std::copy(frame, frame + TofFrame::kSize, sweep_.begin() + i * TofFrame::kSize);
+  }
+  data_ = sweep_.data();
+  size_ = sweep_.size();
+}
+
+void TofReplayBackend::close() {
+#if defined(__linux__) || defined(__APPLE__)
+  if (mapping_)
+    ::munmap(mapping_, size_);
+#endif
+  mapping_ = nullptr;
+  sweep_.clear();
+  data_ = nullptr;
+  size_ = 0;
+  havePending_ = false;
+}
+
+void TofReplayBackend::rewind() {
+  offset_ = 0;
+  playheadNs_ = 0;
+  startNs_ = tofNowNs();
+}
+
+bool TofReplayBackend::nextRecord(TofSample &out) {
+  // Records are fixed-size, but resync byte-wise past anything corrupt.
+  while (offset_ < size_) {
+    uint16_t sequence = 0;
+    const size_t n = TofFrame::decode(data_ + offset_, size_ - offset_, out, sequence);
+    if (n > 0) {
+      offset_ += n;
+      return true;
+    }
+    offset_++;
+  }
+  return false;
+}
+
+bool TofReplayBackend::read(TofSample &out, int timeoutMs) {
+  if (!data_)
+    return false;
+
+  if (!havePending_) {
+    if (!nextRecord(pending_)) {
+      loops_++;
+      rewind();
+      if (!nextRecord(pending_))
+        return false;
+      lastTraceNs_ = pending_.timestampNs;
+    }
+    havePending_ = true;
+    playheadNs_ += std::clamp<int64_t>(pending_.timestampNs - lastTraceNs_, 0, kMaxGapNs);
+    lastTraceNs_ = pending_.timestampNs;
+  }
+
+  if (speed_ > 0.0) {
+    const int64_t dueNs = startNs_ + static_cast<int64_t>(playheadNs_ / speed_);
+    const int64_t waitNs = dueNs - tofNowNs();
+    if (waitNs > static_cast<int64_t>(timeoutMs) * 1'000'000) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+      return false;
+    }
+    if (waitNs > 0)
+      std::this_thread::sleep_for(std::chrono::nanoseconds(waitNs));
+  }
+
+  out = pending_;
+  out.timestampNs = tofNowNs();
+  havePending_ = false;
+  return true;
+}
+
+bool TofReplayBackend::applyProfile(const TofRangingProfile &profile) {
+  (void)profile;
+  return true;
+}
+
+TofRecordingBackend::TofRecordingBackend(std::unique_ptr<TofBackend> inner, std::string path)
+    : inner_(std::move(inner)), path_(std::move(path)) {}
+
+TofRecordingBackend::~TofRecordingBackend() {
+  close();
+}
+
+bool TofRecordingBackend::open(const TofBackendConfig &config) {
+  if (!inner_->open(config))
+    return false;
+  // Appends, so a trace survives supervisor restarts of the live backend.
+  file_ = std::fopen(path_.c_str(), "ab");
+  if (!file_)
+    qWarning() << "ToF: cannot record to" << path_.c_str();
+  else
+    qInfo() << "ToF: recording samples to" << path_.c_str();
+  return true;
+}
+
+void TofRecordingBackend::close() {
+  inner_->close();
+  if (file_) {
+    std::fclose(file_);
+    file_ = nullptr;
+  }
+}
+
+bool TofRecordingBackend::read(TofSample &out, int timeoutMs) {
+  if (!inner_->read(out, timeoutMs))
+    return false;
+  if (file_) {
+    uint8_t frame[TofFrame::kSize];
+    TofFrame::encode(out, sequence_++, frame);
+    // Buffered by stdio; flushed on close.
+    if (std::fwrite(frame, sizeof(frame), 1, file_) != 1) {
+      qWarning() << "ToF: recording to" << path_.c_str() << "failed; stopped";
+      std::fclose(file_);
+      file_ = nullptr;
+    }
+  }
+  return true;
+}
+
+bool TofRecordingBackend::applyProfile(const TofRangingProfile &profile) {
+  return inner_->applyProfile(profile);
+}
+
+bool TofRecordingBackend::takeDepthMap(TofDepthMap &out) {
+  return inner_->takeDepthMap(out);
+}
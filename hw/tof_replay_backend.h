@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tof_backend.h"
+
+// Plays back a trace of TofFrame records (the format of `TOF.py --format
+// binary` and of TofRecordingBackend) from a memory-mapped file. `speed` is
+// the playback rate relative to the recorded timestamps; 0 plays as fast as
+// the consumer reads. Gaps in the trace are capped so the supervisor never
+// mistakes one for a hang, and playback loops at the end. Samples are
+// re-stamped when they are played. The path "sim" plays a synthetic sweep
+// over AmustConfig::kTofSimMinMm..kTofSimMaxMm instead of a file.
+class TofReplayBackend final : public TofBackend {
+public:
+  TofReplayBackend(std::string path, double speed);
+  ~TofReplayBackend() override;
+
+  TofReplayBackend(const TofReplayBackend &) = delete;
+  TofReplayBackend &operator=(const TofReplayBackend &) = delete;
+
+  const char *name() const override { return "replay"; }
+  bool open(const TofBackendConfig &config) override;
+  void close() override;
+  bool isOpen() const override { return data_ != nullptr; }
+  bool read(TofSample &out, int timeoutMs) override;
+  // The trace is fixed; accept any profile so switching stays quiet.
+  bool applyProfile(const TofRangingProfile &profile) override;
+
+private:
+  bool mapFile();
+  void buildSweep();
+  bool nextRecord(TofSample &out);
+  void rewind();
+
+  std::string path_;
+  double speed_;
+
+  const uint8_t *data_ = nullptr;
+  size_t size_ = 0;
+  void *mapping_ = nullptr; // mmap()ed file, or null for the in-memory sweep
+  std::vector<uint8_t> sweep_;
+
+  size_t offset_ = 0;
+  bool havePending_ = false;
+  TofSample pending_;
+  int64_t lastTraceNs_ = 0;
+  int64_t playheadNs_ = 0; // trace time since rewind, gaps capped
+  int64_t startNs_ = 0;    // wall clock at rewind
+  uint64_t loops_ = 0;
+};
+
+// Passes samples of another backend through while appending them, as
+// TofFrame records, to a trace file that TofReplayBackend can play back.
+// Raw (unfiltered) samples are recorded so a replay runs the same filter.
+class TofRecordingBackend final : public TofBackend {
+public:
+  TofRecordingBackend(std::unique_ptr<TofBackend> inner, std::string path);
+  ~TofRecordingBackend() override;
+
+  TofRecordingBackend(const TofRecordingBackend &) = delete;
+  TofRecordingBackend &operator=(const TofRecordingBackend &) = delete;
+
+  const char *name() const override { return inner_->name(); }
+  bool open(const TofBackendConfig &config) override;
+  void close() override;
+  bool isOpen() const override { return inner_->isOpen(); }
+  bool read(TofSample &out, int timeoutMs) override;
+  bool applyProfile(const TofRangingProfile &profile) override;
+  bool takeDepthMap(TofDepthMap &out) override;
+
+private:
+  std::unique_ptr<TofBackend> inner_;
+  std::string path_;
+  std::FILE *file_ = nullptr;
+  uint16_t sequence_ = 0;
+};
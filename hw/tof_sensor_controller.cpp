@@ -1,16 +1,24 @@
 #include "tof_sensor_controller.h"
 
-#include <QCoreApplication>
 #include <QDebug>
-#include <QDir>
-#include <QFileInfo>
 
 #include <algorithm>
+#include <cstring>
+#include <memory>
+
+#include "amust_config.h"
+#include "i2c_transport.h"
+#include "tof_acquisition_thread.h"
+#include "tof_array_backend.h"
+#include "tof_data_ready.h"
+#include "tof_native_backend.h"
+#include "tof_python_backend.h"
+#include "tof_replay_backend.h"
+#include "vl53l1x.h"
 
 namespace {
-QString sanitizeLine(const QByteArray &data) {
-  return QString::fromUtf8(data).trimmed();
-}
+// The GUI thread picks up the newest sample once per display frame.
+constexpr int kFrameIntervalMs = 16;
 
 bool envTruthy(const QByteArray &v) {
   if (v.isEmpty())
@@ -18,143 +26,305 @@ bool envTruthy(const QByteArray &v) {
   const QByteArray lower = v.toLower();
   return lower == "1" || lower == "true" || lower == "yes" || lower == "on";
 }
+
+// AMUST_TOF_SCAN: truthy for the configured grid, or "<columns>x<rows>".
+bool parseScanGrid(const QByteArray &v, int &columns, int &rows) {
+  if (envTruthy(v)) {
+    columns = AmustConfig::kTofScanColumns;
+    rows = AmustConfig::kTofScanRows;
+    return true;
+  }
+  const QList<QByteArray> parts = v.toLower().split('x');
+  if (parts.size() != 2)
+    return false;
+  bool okColumns = false;
+  bool okRows = false;
+  columns = parts[0].toInt(&okColumns);
+  rows = parts[1].toInt(&okRows);
+  return okColumns && okRows && columns >= 1 && columns <= 4 && rows >= 1 && rows <= 4;
+}
 } // namespace
 
-TofSensorController::TofSensorController(QObject *parent) : QObject(parent) {}
+TofSensorController::TofSensorController(QObject *parent) : QObject(parent) {
+  frameTimer_.setInterval(kFrameIntervalMs);
+  connect(&frameTimer_, &QTimer::timeout, this, [this]() { drainLatest(); });
+}
 
 TofSensorController::~TofSensorController() {
   stop();
 }
 
-bool TofSensorController::start(double intervalSeconds, std::function<void(int mm)> onDistanceUpdate,
+bool TofSensorController::start(double intervalSeconds,
+                                std::function<void(const TofSample &sample)> onSample,
                                 double durationSeconds) {
   stop();
 
-  distanceCallback_ = std::move(onDistanceUpdate);
-  process_ = new QProcess(this);
-  attachProcessLogging(process_, QStringLiteral("TOF.py"));
-
-  connect(process_, &QProcess::readyReadStandardOutput, this, [this]() {
-    if (!process_)
-      return;
-    const QList<QByteArray> lines = process_->readAllStandardOutput().split('\n');
-    for (const QByteArray &line : lines) {
-      const QString trimmed = sanitizeLine(line);
-      if (trimmed.isEmpty())
-        continue;
-      bool ok = false;
-      const int mm = trimmed.toInt(&ok);
-      if (!ok)
-        continue;
-      const int normalizedMm = std::max(-1, mm);
-      if (distanceCallback_)
-        distanceCallback_(normalizedMm);
-    }
-  });
-
-  connect(process_, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this,
-          [this](int exitCode, QProcess::ExitStatus status) {
-            if (status != QProcess::NormalExit || exitCode != 0) {
-              qWarning() << "TOF.py exited" << exitCode << "status" << status;
-            }
-            if (process_) {
-              process_->deleteLater();
-              process_ = nullptr;
-            }
-          });
-
-  QString script = resolveTofScriptPath();
-  if (script.isEmpty())
-    script = QStringLiteral("TOF.py");
-
-  QStringList args;
-  args << script;
+  // Optionally force-disable to avoid noisy failures in dev environments.
+  if (envTruthy(qgetenv("AMUST_DISABLE_TOF")))
+    return false;
+
+  TofBackendConfig config;
+  config.intervalSeconds = intervalSeconds;
+  config.durationSeconds = durationSeconds;
+  if (profileSet_) {
+    config.profile = profile_;
+  } else {
+    config.profile.interMeasurementMs = static_cast<int>(intervalSeconds * 1000.0);
+  }
 
   const QByteArray envBus = qgetenv("AMUST_TOF_BUS");
   const QByteArray envAddr = qgetenv("AMUST_TOF_ADDR");
-  if (!envBus.isEmpty()) {
-    args << "--bus" << QString::fromUtf8(envBus);
+  const bool fakeBus = envBus.toLower() == "fake";
+  if (!envBus.isEmpty() && !fakeBus) {
+    const int bus = parseI2cBus(envBus.toStdString());
+    if (bus < 0) {
+      qWarning() << "ToF: invalid AMUST_TOF_BUS" << envBus;
+      return false;
+    }
+    config.bus = bus;
   }
   if (!envAddr.isEmpty()) {
-    args << "--addr" << QString::fromUtf8(envAddr);
+    bool ok = false;
+    const int addr = envAddr.toInt(&ok, 0);
+    if (!ok || addr <= 0 || addr > 0x7F) {
+      qWarning() << "ToF: invalid AMUST_TOF_ADDR" << envAddr;
+      return false;
+    }
+    config.address = addr;
   }
 
-  args << "--interval" << QString::number(std::max(0.05, intervalSeconds));
-  if (durationSeconds > 0.0)
-    args << "--duration" << QString::number(durationSeconds);
+  const QByteArray envScan = qgetenv("AMUST_TOF_SCAN");
+  if (!envScan.isEmpty() && envScan != "0") {
+    if (!parseScanGrid(envScan, config.scanColumns, config.scanRows)) {
+      qWarning() << "ToF: invalid AMUST_TOF_SCAN" << envScan;
+      return false;
+    }
+    if (AmustConfig::kTofArraySize > 1)
+      qWarning() << "ToF: AMUST_TOF_SCAN ignored with a sensor array";
+  }
 
-  const QString python = QStringLiteral("python3");
-  process_->start(python, args);
-  if (!process_->waitForStarted(3000)) {
-    qWarning() << "Failed to start TOF.py:" << process_->errorString();
-    stop();
-    return false;
+  if (fakeBus) {
+    fakeBus_ = std::make_unique<FakeI2cTransport>();
+    const int midMm = (AmustConfig::kTofMinMm + AmustConfig::kTofMaxMm) / 2;
+    if (AmustConfig::kTofArraySize > 1) {
+      for (const AmustConfig::TofArraySensor &spec : AmustConfig::kTofArray)
+        installFakeVl53l1x(*fakeBus_, static_cast<uint8_t>(spec.address), midMm);
+    } else {
+      installFakeVl53l1x(*fakeBus_, static_cast<uint8_t>(config.address), midMm);
+    }
   }
 
-  // Optionally force-disable to avoid noisy failures in dev environments.
-  if (envTruthy(qgetenv("AMUST_DISABLE_TOF"))) {
-    stop();
-    return false;
+  replayPath_ = qgetenv("AMUST_TOF_REPLAY");
+  recordPath_ = qgetenv("AMUST_TOF_RECORD");
+  const QByteArray envSpeed = qgetenv("AMUST_TOF_REPLAY_SPEED").toLower();
+  replaySpeed_ = 1.0;
+  if (envSpeed == "max") {
+    replaySpeed_ = 0.0;
+  } else if (!envSpeed.isEmpty()) {
+    bool ok = false;
+    replaySpeed_ = envSpeed.toDouble(&ok);
+    if (!ok || replaySpeed_ <= 0.0) {
+      qWarning() << "ToF: invalid AMUST_TOF_REPLAY_SPEED" << envSpeed;
+      return false;
+    }
   }
 
+  QByteArray kind = qgetenv("AMUST_TOF_BACKEND").toLower();
+  if (kind.isEmpty())
+    kind = replayPath_.isEmpty() ? "auto" : "replay";
+  if (kind == "replay" && replayPath_.isEmpty())
+    replayPath_ = "sim";
+  drdyMode_ = qgetenv("AMUST_TOF_DRDY").toLower();
+  if (drdyMode_.isEmpty())
+    drdyMode_ = fakeBus ? "sim" : "auto";
+
+  // Runs on the acquisition thread; the python backend's QProcess must be
+  // created there.
+  auto opener = [this, kind, fakeBus](const TofBackendConfig &cfg) {
+    std::unique_ptr<TofBackend> backend;
+    if (kind == "replay")
+      return openBackend("replay", cfg);
+    if (kind == "native" || kind == "auto")
+      backend = openBackend("native", cfg);
+    if (!backend && !fakeBus && (kind == "python" || kind == "auto"))
+      backend = openBackend("python", cfg);
+    return backend;
+  };
+
+  // Never waits for the backend: opening (including TOF.py start-up) and any
+  // restarts happen on the acquisition thread; progress is reported through
+  // the state callback.
+  sampleCallback_ = std::move(onSample);
+  reportedState_ = TofSensorState::Stopped;
+  acquisition_ = std::make_unique<TofAcquisitionThread>(opener, config);
+  acquisition_->start();
+  frameTimer_.start();
+  drainLatest();
   return true;
 }
 
-void TofSensorController::stop() {
-  distanceCallback_ = nullptr;
-  if (!process_)
+void TofSensorController::setStateCallback(std::function<void(TofSensorState state)> onState) {
+  stateCallback_ = std::move(onState);
+}
+
+void TofSensorController::setDepthMapCallback(std::function<void(const TofDepthMap &map)> onMap) {
+  depthMapCallback_ = std::move(onMap);
+}
+
+std::unique_ptr<TofBackend> TofSensorController::openBackend(const QByteArray &kind,
+                                                             const TofBackendConfig &config) {
+  std::unique_ptr<TofBackend> backend;
+  if (kind == "native" && AmustConfig::kTofArraySize > 1) {
+    backend = std::make_unique<TofArrayBackend>(fakeBus_.get());
+  } else if (kind == "native") {
+    auto native = std::make_unique<TofNativeBackend>(fakeBus_.get());
+    native->setDataReadySource(openDataReadySource(config));
+    backend = std::move(native);
+  } else if (kind == "python") {
+    backend = std::make_unique<TofPythonBackend>();
+  } else if (kind == "replay") {
+    backend = std::make_unique<TofReplayBackend>(replayPath_.toStdString(), replaySpeed_);
+  } else {
+    return nullptr;
+  }
+  if (!recordPath_.isEmpty() && kind != "replay")
+    backend = std::make_unique<TofRecordingBackend>(std::move(backend), recordPath_.toStdString());
+
+  if (!backend->open(config))
+    return nullptr;
+  return backend;
+}
+
+std::unique_ptr<TofDataReadySource>
+TofSensorController::openDataReadySource(const TofBackendConfig &config) const {
+  if (drdyMode_ == "sim") {
+    // Emulates the sensor's measurement clock; follows profile changes.
+    return std::make_unique<SoftwareDataReadySource>(
+        std::max(config.profile.timingBudgetMs, config.profile.interMeasurementMs));
+  }
+  if (drdyMode_ == "gpio" || drdyMode_ == "auto") {
+    auto gpio = std::make_unique<GpiodDataReadySource>();
+    // Active low as Vl53l1x::init() programs it; the native backend checks
+    // the sensor's actual polarity once it is up (setActiveLow()).
+    if (gpio->open(AmustConfig::kTofGpio1Line, /*activeLow=*/true))
+      return gpio;
+    if (drdyMode_ == "gpio")
+      qWarning() << "ToF: GPIO1 data-ready unavailable; polling instead";
+  }
+  return nullptr;
+}
+
+void TofSensorController::setRangingProfile(const TofRangingProfile &profile) {
+  if (profileSet_ && std::strcmp(profile_.name, profile.name) == 0)
     return;
+  if (acquisition_) {
+    const TofStats st = stats();
+    qInfo().nospace() << "ToF: profile " << st.profile << " ran at " << st.sampleRateHz
+                      << " Hz, latency avg " << st.latencyAvgUs << " us max "
+                      << st.latencyMaxUs << " us; switching to " << profile.name;
+    acquisition_->requestProfile(profile);
+    resetLatency();
+  }
+  profile_ = profile;
+  profileSet_ = true;
+}
 
-  QObject::disconnect(process_, nullptr, this, nullptr);
-  if (process_->state() != QProcess::NotRunning) {
-    process_->terminate();
-    if (!process_->waitForFinished(1000)) {
-      process_->kill();
-      process_->waitForFinished();
+void TofSensorController::resetLatency() {
+  latencyCount_ = 0;
+  latencySumNs_ = 0;
+  latencyMaxNs_ = 0;
+}
+
+void TofSensorController::drainLatest() {
+  if (!acquisition_)
+    return;
+
+  const TofSensorState state =
+      acquisition_->isFinished() ? TofSensorState::Stopped : acquisition_->state();
+  if (state != reportedState_) {
+    reportedState_ = state;
+    if (state == TofSensorState::Running)
+      qInfo() << "ToF: first sample after" << acquisition_->timeToFirstSampleMs() << "ms";
+    if (stateCallback_)
+      stateCallback_(state);
+  }
+
+  TofSample sample;
+  if (acquisition_->ring().drainLatest(sample)) {
+    if (sample.timestampNs > 0) {
+      const int64_t latencyNs = tofNowNs() - sample.timestampNs;
+      latencyCount_++;
+      latencySumNs_ += latencyNs;
+      latencyMaxNs_ = std::max(latencyMaxNs_, latencyNs);
     }
+    if (sampleCallback_)
+      sampleCallback_(sample);
   }
-  process_->deleteLater();
-  process_ = nullptr;
+
+  TofDepthMap map;
+  if (acquisition_->depthMaps().drainLatest(map) && depthMapCallback_)
+    depthMapCallback_(map);
+
+  if (acquisition_->isFinished() && acquisition_->ring().size() == 0)
+    frameTimer_.stop();
+}
+
+void TofSensorController::stop() {
+  frameTimer_.stop();
+  sampleCallback_ = nullptr;
+  if (acquisition_) {
+    if (!acquisition_->stopAndWait(AmustConfig::kTofStopTimeoutMs)) {
+      // Never block the GUI on a hung bus: the thread exits once its read
+      // returns, taking the fake bus it may still be reading with it.
+      qWarning() << "ToF:" << acquisition_->backendName() << "backend still blocked after"
+                 << AmustConfig::kTofStopTimeoutMs << "ms; stopping in the background";
+      TofAcquisitionThread *orphan = acquisition_.release();
+      FakeI2cTransport *bus = fakeBus_.release();
+      auto reaped = std::make_shared<bool>(false);
+      auto reap = [orphan, bus, reaped]() {
+        if (*reaped)
+          return;
+        *reaped = true;
+        delete bus;
+        orphan->deleteLater();
+      };
+      connect(orphan, &QThread::finished, orphan, reap);
+      if (orphan->isFinished())
+        reap();
+    }
+    acquisition_.reset();
+    if (reportedState_ != TofSensorState::Stopped && stateCallback_)
+      stateCallback_(TofSensorState::Stopped);
+  }
+  reportedState_ = TofSensorState::Stopped;
+  fakeBus_.reset();
+  resetLatency();
 }
 
 bool TofSensorController::isRunning() const {
-  return process_ && process_->state() != QProcess::NotRunning;
+  return acquisition_ && acquisition_->isRunning();
 }
 
-QString TofSensorController::resolveTofScriptPath() const {
-  const QByteArray env = qgetenv("AMUST_TOF_SCRIPT");
-  if (!env.isEmpty()) {
-    const QString p = QString::fromUtf8(env);
-    if (QFileInfo::exists(p))
-      return QFileInfo(p).canonicalFilePath();
-  }
+const char *TofSensorController::backendName() const {
+  return acquisition_ ? acquisition_->backendName() : "none";
+}
 
-  const QString dir = QCoreApplication::applicationDirPath();
-  QStringList candidates;
-  candidates << (dir + QDir::separator() + QStringLiteral("TOF.py"));
-  candidates << (dir + QDir::separator() + QStringLiteral("../TOF.py"));
-  candidates << (dir + QDir::separator() + QStringLiteral("../../TOF.py"));
-  candidates << (dir + QDir::separator() + QStringLiteral("../Resources/TOF.py"));
-  candidates << (dir + QDir::separator() + QStringLiteral("../share/amust/TOF.py"));
-  candidates << (dir + QDir::separator() + QStringLiteral("../../share/amust/TOF.py"));
-  for (const QString &p : candidates) {
-    if (QFileInfo::exists(p))
-      return QFileInfo(p).canonicalFilePath();
-  }
-  return QString();
-}
-
-void TofSensorController::attachProcessLogging(QProcess *process, const QString &label) {
-  connect(process, &QProcess::readyReadStandardError, this, [process, label]() {
-    if (!process)
-      return;
-    const QString line = sanitizeLine(process->readAllStandardError());
-    if (!line.isEmpty())
-      qWarning().noquote() << label << ":" << line;
-  });
-  connect(process, &QProcess::errorOccurred, this, [process, label](QProcess::ProcessError error) {
-    if (!process)
-      return;
-    qWarning() << label << "error" << error << process->errorString();
-  });
+TofStats TofSensorController::stats() const {
+  TofStats out;
+  if (!acquisition_)
+    return out;
+  out.samples = acquisition_->sampleCount();
+  out.overflows = acquisition_->ring().overflowCount();
+  out.dropped = acquisition_->ring().droppedCount();
+  out.state = acquisition_->state();
+  out.restarts = acquisition_->restartCount();
+  out.timeToFirstSampleMs = acquisition_->timeToFirstSampleMs();
+  out.profile = acquisition_->profileName();
+  const int64_t sinceNs = acquisition_->profileSinceNs();
+  if (sinceNs > 0 && tofNowNs() > sinceNs)
+    out.sampleRateHz = acquisition_->profileSampleCount() * 1e9 / (tofNowNs() - sinceNs);
+  if (latencyCount_ > 0)
+    out.latencyAvgUs = latencySumNs_ / static_cast<int64_t>(latencyCount_) / 1000;
+  out.latencyMaxUs = latencyMaxNs_ / 1000;
+  return out;
 }
@@ -1,10 +1,49 @@
 #pragma once
 
 #include <QObject>
-#include <QProcess>
+#include <QTimer>
 
+#include <cstdint>
 #include <functional>
+#include <memory>
 
+#include "tof_backend.h"
+
+class FakeI2cTransport;
+class TofAcquisitionThread;
+class TofDataReadySource;
+
+struct TofStats {
+  TofSensorState state = TofSensorState::Stopped;
+  uint64_t restarts = 0;            // backend reopen attempts by the supervisor
+  int64_t timeToFirstSampleMs = -1; // latest (re)open to its first sample
+  uint64_t samples = 0;             // read by the acquisition thread
+  uint64_t overflows = 0;           // arrived with the ring full (kept in its latest slot)
+  uint64_t dropped = 0;             // superseded before the UI drained them
+  // Under the ranging profile currently running:
+  const char *profile = "none";
+  double sampleRateHz = 0.0; // achieved, not configured
+  int64_t latencyAvgUs = 0;  // sample timestamp (data-ready edge) to GUI callback
+  int64_t latencyMaxUs = 0;
+};
+
+// Owns the active ToF backend. Backend selection (env AMUST_TOF_BACKEND):
+//   native (in-process VL53L1X over /dev/i2c-N), python (TOF.py subprocess),
+//   auto (default: native, falling back to python),
+//   replay (recorded trace from AMUST_TOF_REPLAY=<file>, or "sim" for a
+//   synthetic sweep; AMUST_TOF_REPLAY_SPEED=1 (default), N or max). Setting
+//   AMUST_TOF_REPLAY alone selects replay. AMUST_TOF_RECORD=<file> appends
+//   the live backend's raw samples to a trace in the same format.
+// With several sensors in AmustConfig::kTofArray the native driver becomes a
+// TofArrayBackend and samples carry the fused distance plus tilt.
+// AMUST_TOF_BUS=fake runs the native driver against in-memory devices.
+// The native backend reads on the GPIO1 data-ready edge when available
+// (AMUST_TOF_DRDY=auto|gpio|sim|off; sim is the default on the fake bus).
+// AMUST_TOF_SCAN=1 (or CxR) makes a single native sensor sweep its ROI and
+// deliver coarse depth maps alongside the samples.
+// Samples are acquired and filtered on a dedicated thread that also restarts a
+// failed or hung backend; the callbacks run on the GUI thread, the sample one
+// at most once per frame with the newest filtered sample.
 class TofSensorController final : public QObject {
   Q_OBJECT
 
@@ -12,16 +51,42 @@ public:
   explicit TofSensorController(QObject *parent = nullptr);
   ~TofSensorController() override;
 
-  bool start(double intervalSeconds, std::function<void(int mm)> onDistanceUpdate,
+  // Returns immediately; false only if ToF is disabled or misconfigured.
+  bool start(double intervalSeconds, std::function<void(const TofSample &sample)> onSample,
              double durationSeconds = 0.0);
+  // Called on every supervisor state change (e.g. Running -> Restarting).
+  void setStateCallback(std::function<void(TofSensorState state)> onState);
+  // Called with the newest complete depth map while an ROI scan is running.
+  void setDepthMapCallback(std::function<void(const TofDepthMap &map)> onMap);
   void stop();
   bool isRunning() const;
+  // Switches ranging parameters without restarting the backend. Remembered
+  // across stop()/start(); until first called, start() ranges in short mode
+  // at its interval. Logs the previous profile's rate and latency.
+  void setRangingProfile(const TofRangingProfile &profile);
+  const char *backendName() const;
+  TofStats stats() const;
 
 private:
-  QString resolveTofScriptPath() const;
-  void attachProcessLogging(QProcess *process, const QString &label);
+  std::unique_ptr<TofBackend> openBackend(const QByteArray &kind, const TofBackendConfig &config);
+  std::unique_ptr<TofDataReadySource> openDataReadySource(const TofBackendConfig &config) const;
+  void drainLatest();
+  void resetLatency();
 
-  QProcess *process_ = nullptr;
-  std::function<void(int mm)> distanceCallback_;
+  QTimer frameTimer_;
+  QByteArray drdyMode_;
+  QByteArray replayPath_;
+  QByteArray recordPath_;
+  double replaySpeed_ = 1.0;
+  TofRangingProfile profile_;
+  bool profileSet_ = false;
+  std::unique_ptr<FakeI2cTransport> fakeBus_;
+  std::unique_ptr<TofAcquisitionThread> acquisition_;
+  std::function<void(const TofSample &sample)> sampleCallback_;
+  std::function<void(TofSensorState state)> stateCallback_;
+  std::function<void(const TofDepthMap &map)> depthMapCallback_;
+  TofSensorState reportedState_ = TofSensorState::Stopped;
+  uint64_t latencyCount_ = 0;
+  int64_t latencySumNs_ = 0;
+  int64_t latencyMaxNs_ = 0;
 };
-
@@ -0,0 +1,364 @@
+#include "vl53l1x.h"
+
+#include "i2c_transport.h"
+
+#include <chrono>
+#include <memory>
+#include <thread>
+
+namespace {
+
+constexpr uint16_t kI2cSlaveDeviceAddress = 0x0001;
+constexpr uint16_t kVhvConfigTimeoutMacropLoopBound = 0x0008;
+constexpr uint16_t kVhvConfigInit = 0x000B;
+constexpr uint16_t kGpioHvMuxCtrl = 0x0030;
+constexpr uint16_t kGpioTioHvStatus = 0x0031;
+constexpr uint16_t kPhasecalConfigTimeoutMacrop = 0x004B;
+constexpr uint16_t kRangeConfigTimeoutMacropAHi = 0x005E;
+constexpr uint16_t kRangeConfigVcselPeriodA = 0x0060;
+constexpr uint16_t kRangeConfigTimeoutMacropBHi = 0x0061;
+constexpr uint16_t kRangeConfigVcselPeriodB = 0x0063;
+constexpr uint16_t kRangeConfigValidPhaseHigh = 0x0069;
+constexpr uint16_t kSystemIntermeasurementPeriod = 0x006C;
+constexpr uint16_t kSdConfigWoiSd0 = 0x0078;
+constexpr uint16_t kSdConfigInitialPhaseSd0 = 0x007A;
+constexpr uint16_t kRoiConfigUserRoiCentreSpad = 0x007F;
+constexpr uint16_t kRoiConfigUserRoiRequestedGlobalXySize = 0x0080;
+constexpr uint16_t kSystemInterruptClear = 0x0086;
+constexpr uint16_t kSystemModeStart = 0x0087;
+constexpr uint16_t kResultRangeStatus = 0x0089;
+constexpr uint16_t kResultAmbientCountRateMcpsSd0 = 0x0090;
+constexpr uint16_t kResultFinalRangeMmSd0 = 0x0096;
+constexpr uint16_t kResultPeakSignalCountRateMcpsSd0 = 0x0098;
+constexpr uint16_t kResultOscCalibrateVal = 0x00DE;
+constexpr uint16_t kFirmwareSystemStatus = 0x00E5;
+constexpr uint16_t kIdentificationModelId = 0x010F;
+constexpr uint16_t kRoiOpticalCentre = 0x013E;
+
+constexpr uint16_t kDefaultConfigStart = 0x002D;
+
+// ULD default configuration for registers 0x2D..0x87.
+constexpr uint8_t kDefaultConfig[] = {
+    0x00, 0x00, 0x00, 0x01, 0x02, 0x00, 0x02, 0x08, 0x00, 0x08, 0x10, 0x01, 0x01, 0x00, 0x00, 0x00,
+    0x00, 0xff, 0x00, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x20, 0x0b, 0x00, 0x00, 0x02, 0x0a, 0x21,
+    0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x00, 0xc8, 0x00, 0x00, 0x38, 0xff, 0x01, 0x00, 0x08, 0x00,
+    0x00, 0x01, 0xcc, 0x0f, 0x01, 0xf1, 0x0d, 0x01, 0x68, 0x00, 0x80, 0x08, 0xb8, 0x00, 0x00, 0x00,
+    0x00, 0x0f, 0x89, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x0f, 0x0d, 0x0e, 0x0e, 0x00,
+    0x00, 0x02, 0xc7, 0xff, 0x9B, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00,
+};
+static_assert(sizeof(kDefaultConfig) == 0x87 - 0x2D + 1, "default config must cover 0x2D..0x87");
+
+// Raw RESULT__RANGE_STATUS (low 5 bits) -> ULD range status.
+constexpr uint8_t kRangeStatusMap[24] = {255, 255, 255, 5,   2,   4,  1,  7,  3,   0,  255, 255,
+                                         9,   13,  255, 255, 255, 255, 10, 6,  255, 255, 11,  12};
+
+struct TimingEntry {
+  int budgetMs;
+  uint16_t aHi;
+  uint16_t bHi;
+};
+
+constexpr TimingEntry kShortTiming[] = {
+    {15, 0x001D, 0x0027}, {20, 0x0051, 0x006E},  {33, 0x00D6, 0x006E}, {50, 0x01AE, 0x01E8},
+    {100, 0x02E1, 0x0388}, {200, 0x03E1, 0x0496}, {500, 0x0591, 0x05C1},
+};
+
+constexpr TimingEntry kLongTiming[] = {
+    {20, 0x001E, 0x0022},  {33, 0x0060, 0x006E},  {50, 0x00AD, 0x00C6},
+    {100, 0x01CC, 0x01EA}, {200, 0x02D9, 0x02F8}, {500, 0x048F, 0x04A4},
+};
+
+template <size_t N> const TimingEntry *findTiming(const TimingEntry (&table)[N], int ms) {
+  for (const TimingEntry &e : table) {
+    if (e.budgetMs == ms)
+      return &e;
+  }
+  return nullptr;
+}
+
+void sleepMs(int ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+} // namespace
+
+Vl53l1x::Vl53l1x(I2cTransport &transport, uint8_t address)
+    : transport_(transport), address_(address) {}
+
+bool Vl53l1x::init() {
+  uint8_t boot = 0;
+  for (int i = 0; i < 100 && !(boot & 0x01); i++) {
+    if (!read8(kFirmwareSystemStatus, boot))
+      boot = 0;
+    if (!(boot & 0x01))
+      sleepMs(2);
+  }
+  if (!(boot & 0x01))
+    return false;
+
+  uint16_t id = 0;
+  if (!readModelId(id) || id != kModelId)
+    return false;
+
+  if (!transport_.writeRegisters(address_, kDefaultConfigStart, 2, kDefaultConfig,
+                                 sizeof(kDefaultConfig)))
+    return false;
+  polarity_ = -1;
+  // GPIO1 is open-drain and pulled up on the host side, so the idle level
+  // is high: assert data ready by pulling it low (the default config has
+  // it active high, which reads as "ready" whenever nothing drives it).
+  if (!setInterruptPolarity(0))
+    return false;
+  mode_ = DistanceMode::Long;
+  timingBudgetMs_ = 100;
+
+  // One throwaway measurement runs the VHV calibration.
+  if (!startRanging())
+    return false;
+  bool ready = false;
+  for (int i = 0; i < 500 && !ready; i++) {
+    if (!checkForDataReady(ready))
+      return false;
+    if (!ready)
+      sleepMs(2);
+  }
+  if (!ready)
+    return false;
+
+  return clearInterrupt() && stopRanging() && write8(kVhvConfigTimeoutMacropLoopBound, 0x09) &&
+         write8(kVhvConfigInit, 0x00);
+}
+
+bool Vl53l1x::startRanging() {
+  return write8(kSystemModeStart, 0x40);
+}
+
+bool Vl53l1x::stopRanging() {
+  return write8(kSystemModeStart, 0x00);
+}
+
+bool Vl53l1x::checkForDataReady(bool &ready) {
+  uint8_t polarity = 0;
+  uint8_t status = 0;
+  if (!interruptPolarity(polarity) || !read8(kGpioTioHvStatus, status))
+    return false;
+  ready = (status & 0x01) == polarity;
+  return true;
+}
+
+bool Vl53l1x::clearInterrupt() {
+  return write8(kSystemInterruptClear, 0x01);
+}
+
+bool Vl53l1x::readResult(Result &out) {
+  uint8_t buf[kResultPeakSignalCountRateMcpsSd0 + 2 - kResultRangeStatus];
+  if (!transport_.readRegisters(address_, kResultRangeStatus, 2, buf, sizeof(buf)))
+    return false;
+
+  auto be16 = [&](uint16_t reg) {
+    const size_t i = reg - kResultRangeStatus;
+    return static_cast<uint16_t>((buf[i] << 8) | buf[i + 1]);
+  };
+
+  const uint8_t raw = buf[0] & 0x1F;
+  out.rangeStatus = raw < sizeof(kRangeStatusMap) ? kRangeStatusMap[raw] : 255;
+  out.distanceMm = be16(kResultFinalRangeMmSd0);
+  out.signalRateKcps = be16(kResultPeakSignalCountRateMcpsSd0) * 8;
+  out.ambientRateKcps = be16(kResultAmbientCountRateMcpsSd0) * 8;
+  return true;
+}
+
+bool Vl53l1x::setDistanceMode(DistanceMode mode) {
+  const bool isShort = mode == DistanceMode::Short;
+  const bool ok = write8(kPhasecalConfigTimeoutMacrop, isShort ? 0x14 : 0x0A) &&
+                  write8(kRangeConfigVcselPeriodA, isShort ? 0x07 : 0x0F) &&
+                  write8(kRangeConfigVcselPeriodB, isShort ? 0x05 : 0x0D) &&
+                  write8(kRangeConfigValidPhaseHigh, isShort ? 0x38 : 0xB8) &&
+                  write16(kSdConfigWoiSd0, isShort ? 0x0705 : 0x0F0D) &&
+                  write16(kSdConfigInitialPhaseSd0, isShort ? 0x0606 : 0x0E0E);
+  if (!ok)
+    return false;
+  mode_ = mode;
+  // Macro-period timeouts are mode specific; re-apply the current budget. A
+  // budget the new mode lacks (15 ms in long mode) is left for the caller to
+  // replace with setTimingBudgetMs().
+  const bool budgetValid = isShort ? findTiming(kShortTiming, timingBudgetMs_) != nullptr
+                                   : findTiming(kLongTiming, timingBudgetMs_) != nullptr;
+  return !budgetValid || setTimingBudgetMs(timingBudgetMs_);
+}
+
+bool Vl53l1x::setTimingBudgetMs(int ms) {
+  const TimingEntry *e = mode_ == DistanceMode::Short ? findTiming(kShortTiming, ms)
+                                                      : findTiming(kLongTiming, ms);
+  if (!e)
+    return false;
+  if (!write16(kRangeConfigTimeoutMacropAHi, e->aHi) ||
+      !write16(kRangeConfigTimeoutMacropBHi, e->bHi))
+    return false;
+  timingBudgetMs_ = ms;
+  return true;
+}
+
+bool Vl53l1x::setInterMeasurementMs(int ms) {
+  uint16_t osc = 0;
+  if (!read16(kResultOscCalibrateVal, osc))
+    return false;
+  const uint32_t clockPll = osc & 0x3FF;
+  return write32(kSystemIntermeasurementPeriod,
+                 static_cast<uint32_t>(clockPll * static_cast<uint32_t>(ms) * 1.075));
+}
+
+bool Vl53l1x::setI2cAddress(uint8_t address) {
+  if (!write8(kI2cSlaveDeviceAddress, address & 0x7F))
+    return false;
+  address_ = address & 0x7F;
+  return true;
+}
+
+bool Vl53l1x::setRoi(int width, int height) {
+  width = width < 4 ? 4 : (width > 16 ? 16 : width);
+  height = height < 4 ? 4 : (height > 16 ? 16 : height);
+  uint8_t centre = 199;
+  if (width <= 10 && height <= 10 && !read8(kRoiOpticalCentre, centre))
+    return false;
+  return write8(kRoiConfigUserRoiCentreSpad, centre) &&
+         write8(kRoiConfigUserRoiRequestedGlobalXySize,
+                static_cast<uint8_t>(((height - 1) << 4) | (width - 1)));
+}
+
+bool Vl53l1x::setRoiCenter(uint8_t spad) {
+  return write8(kRoiConfigUserRoiCentreSpad, spad);
+}
+
+uint8_t Vl53l1x::roiCenterSpad(int column, int row) {
+  // The lower half of the rows is numbered from 128 upwards column by
+  // column, the upper half from 127 downwards.
+  return static_cast<uint8_t>(row < 8 ? 128 + column * 8 + row : 127 - column * 8 - (row - 8));
+}
+
+bool Vl53l1x::readModelId(uint16_t &id) {
+  return read16(kIdentificationModelId, id);
+}
+
+bool Vl53l1x::interruptPolarity(uint8_t &polarity) {
+  if (polarity_ < 0) {
+    uint8_t ctrl = 0;
+    if (!read8(kGpioHvMuxCtrl, ctrl))
+      return false;
+    polarity_ = (ctrl & 0x10) ? 0 : 1;
+  }
+  polarity = static_cast<uint8_t>(polarity_);
+  return true;
+}
+
+bool Vl53l1x::setInterruptPolarity(uint8_t polarity) {
+  uint8_t ctrl = 0;
+  if (!read8(kGpioHvMuxCtrl, ctrl))
+    return false;
+  ctrl = static_cast<uint8_t>((ctrl & ~0x10) | (polarity ? 0x00 : 0x10));
+  if (!write8(kGpioHvMuxCtrl, ctrl))
+    return false;
+  polarity_ = polarity ? 1 : 0;
+  return true;
+}
+
+bool Vl53l1x::write8(uint16_t reg, uint8_t value) {
+  return transport_.writeRegisters(address_, reg, 2, &value, 1);
+}
+
+bool Vl53l1x::write16(uint16_t reg, uint16_t value) {
+  const uint8_t b[2] = {static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value & 0xFF)};
+  return transport_.writeRegisters(address_, reg, 2, b, sizeof(b));
+}
+
+bool Vl53l1x::write32(uint16_t reg, uint32_t value) {
+  const uint8_t b[4] = {static_cast<uint8_t>(value >> 24), static_cast<uint8_t>(value >> 16),
+                        static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value & 0xFF)};
+  return transport_.writeRegisters(address_, reg, 2, b, sizeof(b));
+}
+
+bool Vl53l1x::read8(uint16_t reg, uint8_t &value) {
+  return transport_.readRegisters(address_, reg, 2, &value, 1);
+}
+
+bool Vl53l1x::read16(uint16_t reg, uint16_t &value) {
+  uint8_t b[2] = {0, 0};
+  if (!transport_.readRegisters(address_, reg, 2, b, sizeof(b)))
+    return false;
+  value = static_cast<uint16_t>((b[0] << 8) | b[1]);
+  return true;
+}
+
+void installFakeVl53l1x(FakeI2cTransport &bus, uint8_t address, int distanceMm) {
+  bus.addDevice(address);
+  bus.poke(address, kFirmwareSystemStatus, 0x03);
+  bus.poke(address, kIdentificationModelId, static_cast<uint8_t>(Vl53l1x::kModelId >> 8));
+  bus.poke(address, kIdentificationModelId + 1, static_cast<uint8_t>(Vl53l1x::kModelId & 0xFF));
+  bus.poke(address, kResultOscCalibrateVal, 0x01);
+  bus.poke(address, kResultOscCalibrateVal + 1, 0x00);
+  bus.poke(address, kRoiOpticalCentre, 199);
+
+  // Measurements complete at start + k * period; clearing the interrupt
+  // consumes the latest one, so status reads ready again at the next boundary.
+  struct Clock {
+    bool ranging = false;
+    std::chrono::steady_clock::time_point next;
+  };
+  auto clock = std::make_shared<Clock>();
+  FakeI2cTransport *fake = &bus;
+  auto periodOf = [fake, address]() {
+    uint32_t reg = 0;
+    for (int i = 0; i < 4; i++)
+      reg = (reg << 8) | fake->peek(address, static_cast<uint16_t>(kSystemIntermeasurementPeriod + i));
+    const uint32_t clockPll =
+        ((fake->peek(address, kResultOscCalibrateVal) << 8) |
+         fake->peek(address, kResultOscCalibrateVal + 1)) & 0x3FF;
+    const double ms = clockPll ? reg / (clockPll * 1.075) : 0.0;
+    return std::chrono::microseconds(static_cast<int64_t>(ms * 1000.0));
+  };
+  bus.setWriteHook(address, [clock, periodOf](uint8_t, uint16_t reg, uint8_t value) {
+    const auto now = std::chrono::steady_clock::now();
+    if (reg == kSystemModeStart) {
+      clock->ranging = value != 0;
+      clock->next = now + periodOf();
+    } else if (reg == kSystemInterruptClear) {
+      const auto period = periodOf();
+      if (period.count() <= 0)
+        clock->next = now;
+      while (clock->next <= now && period.count() > 0)
+        clock->next += period;
+    }
+  });
+
+  // A small left-to-right slope across the SPAD array, so ROI scans of the
+  // fake produce a non-flat map; the default full-array centre reads `mm`.
+  auto distanceAt = [fake, address, distanceMm]() {
+    const int spad = fake->peek(address, kRoiConfigUserRoiCentreSpad);
+    const int column = spad >= 128 ? (spad - 128) / 8 : (127 - spad) / 8;
+    const int mm = distanceMm < 0 ? 0 : distanceMm + (column - 8) / 2;
+    return static_cast<uint16_t>(mm < 0 ? 0 : mm);
+  };
+  bus.setReadHook(address, [fake, address, distanceAt, clock](uint8_t, uint16_t reg,
+                                                              uint8_t &value) {
+    switch (reg) {
+    case kGpioTioHvStatus: {
+      // Follows the programmed polarity (GPIO_HV_MUX__CTRL bit 4 = active low).
+      const bool ready = clock->ranging && std::chrono::steady_clock::now() >= clock->next;
+      const bool activeLow = (fake->peek(address, kGpioHvMuxCtrl) & 0x10) != 0;
+      value = ready != activeLow ? 0x01 : 0x00;
+      break;
+    }
+    case kResultRangeStatus:
+      value = 0x09; // maps to status 0 (valid)
+      break;
+    case kResultFinalRangeMmSd0:
+      value = static_cast<uint8_t>(distanceAt() >> 8);
+      break;
+    case kResultFinalRangeMmSd0 + 1:
+      value = static_cast<uint8_t>(distanceAt() & 0xFF);
+      break;
+    default:
+      break;
+    }
+  });
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+
+class I2cTransport;
+class FakeI2cTransport;
+
+// Register-level VL53L1X driver (port of ST's ultra-lite driver sequence).
+// All calls are synchronous I2C transactions; none allocate.
+class Vl53l1x final {
+public:
+  enum class DistanceMode { Short = 1, Long = 2 };
+
+  struct Result {
+    int distanceMm = -1;
+    int rangeStatus = 255; // 0 = valid; see ULD status mapping
+    int signalRateKcps = 0;
+    int ambientRateKcps = 0;
+  };
+
+  static constexpr uint8_t kDefaultAddress = 0x29;
+  static constexpr uint16_t kModelId = 0xEACC;
+
+  explicit Vl53l1x(I2cTransport &transport, uint8_t address = kDefaultAddress);
+
+  // Waits for firmware boot, checks the model id and loads the default config.
+  bool init();
+
+  bool startRanging();
+  bool stopRanging();
+  bool checkForDataReady(bool &ready);
+  bool clearInterrupt();
+  // Reads status, distance and rates in one burst transaction.
+  bool readResult(Result &out);
+
+  bool setDistanceMode(DistanceMode mode);
+  bool setTimingBudgetMs(int ms);
+  bool setInterMeasurementMs(int ms);
+  bool setI2cAddress(uint8_t address);
+  // SPAD region of interest, 4..16 SPADs per side. setRoi() re-centres on the
+  // optical centre like the ULD; setRoiCenter() then moves it.
+  bool setRoi(int width, int height);
+  bool setRoiCenter(uint8_t spad);
+  // ST's centre-SPAD number for column 0..15 (left to right) and row 0..15
+  // of the 16x16 array, as used by setRoiCenter().
+  static uint8_t roiCenterSpad(int column, int row);
+
+  // GPIO1 data-ready polarity as programmed (ULD numbering: 1 = active
+  // high, 0 = active low). init() makes it active low.
+  bool interruptPolarity(uint8_t &polarity);
+
+  DistanceMode distanceMode() const { return mode_; }
+  int timingBudgetMs() const { return timingBudgetMs_; }
+  uint8_t address() const { return address_; }
+
+private:
+  bool readModelId(uint16_t &id);
+  bool setInterruptPolarity(uint8_t polarity);
+
+  bool write8(uint16_t reg, uint8_t value);
+  bool write16(uint16_t reg, uint16_t value);
+  bool write32(uint16_t reg, uint32_t value);
+  bool read8(uint16_t reg, uint8_t &value);
+  bool read16(uint16_t reg, uint16_t &value);
+
+  I2cTransport &transport_;
+  uint8_t address_;
+  DistanceMode mode_ = DistanceMode::Long;
+  int timingBudgetMs_ = 100;
+  int polarity_ = -1;
+};
+
+// Makes `bus` answer like a booted VL53L1X at `address` that measures
+// `distanceMm` once per programmed inter-measurement period while ranging.
+// For dev boxes and tests without hardware.
+void installFakeVl53l1x(FakeI2cTransport &bus, uint8_t address, int distanceMm);
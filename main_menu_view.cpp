@@ -0,0 +1,74 @@
+#include "main_menu_view.h"
+
+#include <cstring>
+
+void formatMinutesSeconds(int ms, char *out) {
+  const int totalSeconds = ms > 0 ? ms / 1000 : 0;
+  const int minutes = (totalSeconds / 60) % 60;
+  const int seconds = totalSeconds % 60;
+  char *p = out;
+  if (minutes >= 10)
+    *p++ = static_cast<char>('0' + minutes / 10);
+  *p++ = static_cast<char>('0' + minutes % 10);
+  *p++ = ':';
+  *p++ = static_cast<char>('0' + seconds / 10);
+  *p++ = static_cast<char>('0' + seconds % 10);
+  *p = '\0';
+}
+
+MainMenuView MainMenuView::from(const SessionSnapshot &session, bool interlockOpen,
+                                bool emergencyStop) {
+  MainMenuView v;
+  v.state = session.state;
+  switch (session.state) {
+  case DeviceState::Ready:
+    formatMinutesSeconds(session.setDurationMs, v.timeText);
+    break;
+  case DeviceState::Done:
+    std::memcpy(v.timeText, "DONE", 5);
+    break;
+  case DeviceState::Running:
+  case DeviceState::Paused:
+    formatMinutesSeconds(session.remainingMs, v.timeText);
+    break;
+  }
+  v.progressPercent = session.progressPercent;
+  if (session.state == DeviceState::Running && session.runDurationMs > 0)
+    v.progressRate = 1'000'000.0 / session.runDurationMs;
+
+  const bool tripped = interlockOpen || emergencyStop;
+  v.canAdjust = session.state == DeviceState::Ready;
+  v.startEnabled = session.state == DeviceState::Ready && !tripped;
+  v.pauseEnabled = session.state == DeviceState::Running ||
+                   (session.state == DeviceState::Paused && !tripped);
+  v.pauseResumes = session.state == DeviceState::Paused;
+  v.stopEnabled = session.state != DeviceState::Ready;
+  v.stopDone = session.state == DeviceState::Done;
+  v.exposing = session.state == DeviceState::Running;
+  v.emergencyStop = emergencyStop;
+  v.interlockOpen = interlockOpen;
+  return v;
+}
+
+uint32_t MainMenuView::diff(const MainMenuView &a, const MainMenuView &b) {
+  uint32_t fields = 0;
+  if (a.state != b.state)
+    fields |= kState;
+  if (std::strcmp(a.timeText, b.timeText) != 0)
+    fields |= kTime;
+  if (a.progressPercent != b.progressPercent || a.progressRate != b.progressRate)
+    fields |= kProgress;
+  if (a.canAdjust != b.canAdjust)
+    fields |= kAdjust;
+  if (a.startEnabled != b.startEnabled)
+    fields |= kStart;
+  if (a.pauseEnabled != b.pauseEnabled || a.pauseResumes != b.pauseResumes)
+    fields |= kPause;
+  if (a.stopEnabled != b.stopEnabled || a.stopDone != b.stopDone)
+    fields |= kStop;
+  if (a.exposing != b.exposing)
+    fields |= kExposing;
+  if (a.emergencyStop != b.emergencyStop || a.interlockOpen != b.interlockOpen)
+    fields |= kSafety;
+  return fields;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+#include "session_engine.h"
+
+// Everything MainMenuWidget shows about the session and the safety inputs,
+// as plain values: building and comparing one never allocates, even the
+// time text, which lives in a fixed buffer. The widget keeps the view it
+// last applied and only touches the widgets behind the fields that differ.
+struct MainMenuView {
+  enum Field : uint32_t {
+    kState = 1u << 0,    // top bar, ToF ranging profile
+    kTime = 1u << 1,     // output time label
+    kProgress = 1u << 2, // progress pill (percent and rate)
+    kAdjust = 1u << 3,   // -1m / -10s / +10s / +1m
+    kStart = 1u << 4,
+    kPause = 1u << 5,    // enabled, PAUSE / RESUME
+    kStop = 1u << 6,     // enabled, STOP / DONE
+    kExposing = 1u << 7, // laser / LED / energy pills
+    kSafety = 1u << 8,   // top bar
+    kAllFields = (1u << 9) - 1,
+  };
+
+  DeviceState state = DeviceState::Ready;
+  char timeText[8] = {}; // "m:ss" or "DONE"
+  int progressPercent = 0;
+  // How fast progress advances while Running, in permille per second; the
+  // pill interpolates between whole percents with it. 0 otherwise.
+  double progressRate = 0.0;
+  bool canAdjust = false;
+  bool startEnabled = false;
+  bool pauseEnabled = false;
+  bool pauseResumes = false;
+  bool stopEnabled = false;
+  bool stopDone = false;
+  bool exposing = false;
+  bool emergencyStop = false;
+  bool interlockOpen = false;
+
+  static MainMenuView from(const SessionSnapshot &session, bool interlockOpen,
+                           bool emergencyStop);
+  // Field bits that differ between a and b.
+  static uint32_t diff(const MainMenuView &a, const MainMenuView &b);
+};
+
+// "m:ss" as QTime(0, 0).addMSecs(ms).toString("m:ss") gives it (minutes
+// wrap at an hour), into out, which holds at least 6 bytes.
+void formatMinutesSeconds(int ms, char *out);
@@ -5,33 +5,29 @@
 
 #include <QFrame>
 #include <QFontDatabase>
+#include <QFontMetrics>
 #include <QGridLayout>
 #include <QHBoxLayout>
+#include <QPaintEvent>
 #include <QPainter>
-#include <QPainterPath>
+#include <QResizeEvent>
+#include <QShowEvent>
+#include <QShortcut>
 #include <QSizePolicy>
+#include <QSocketNotifier>
 #include <QTime>
 #include <QVBoxLayout>
 #include <QDebug>
 
+#include "chrome_renderer.h"
+#include "frame_scheduler.h"
 #include "progress_pill.h"
+#include "status_pill.h"
+#include "tof_depth_map_widget.h"
 #include "amust_config.h"
 
 namespace {
 
-QRectF fitAspect(const QRectF &outer, double aspectW, double aspectH) {
-  const double target = aspectW / aspectH;
-  const double actual = outer.width() / outer.height();
-  if (actual > target) {
-    const double w = outer.height() * target;
-    const double x = outer.x() + (outer.width() - w) * 0.5;
-    return QRectF(x, outer.y(), w, outer.height());
-  }
-  const double h = outer.width() / target;
-  const double y = outer.y() + (outer.height() - h) * 0.5;
-  return QRectF(outer.x(), y, outer.width(), h);
-}
-
 QFont fixedFont(int pixelSize) {
   QFont f = QFontDatabase::systemFont(QFontDatabase::FixedFont);
   f.setPixelSize(pixelSize);
@@ -44,22 +40,6 @@ QColor withAlpha(const QColor &c, double a01) {
   return out;
 }
 
-QString pillStyle(const QString &bgRgba, const QString &borderRgba, const QString &textRgba = QString()) {
-  QString style =
-      "QLabel {"
-      "  background: %1;"
-      "  border: 1px solid %2;"
-      "  border-radius: 10px;"
-      "  padding: 6px 10px;";
-  if (!textRgba.isEmpty())
-    style += "  color: %3;";
-  style += "}";
-
-  if (textRgba.isEmpty())
-    return QString(style).arg(bgRgba, borderRgba);
-  return QString(style).arg(bgRgba, borderRgba, textRgba);
-}
-
 QString cardStyle() {
   return QString(
       "QFrame {"
@@ -109,9 +89,32 @@ bool envTruthy(const QByteArray &v) {
   return lower == "1" || lower == "true" || lower == "yes" || lower == "on";
 }
 
+// Session exposure commands go to the GPIO thread, which times the
+// exposure itself and reports back through its report queue. A command the
+// queue could not take is refused, so the session does not move on.
+class GpioSessionExposure final : public SessionExposure {
+public:
+  explicit GpioSessionExposure(GpioOutputThread &gpio) : gpio_(gpio) {}
+
+  bool start(int64_t durationNs) override { return gpio_.startExposure(durationNs); }
+  bool pause() override { return gpio_.pauseExposure(); }
+  bool resume() override { return gpio_.resumeExposure(); }
+  bool stop() override { return gpio_.stopExposure(); }
+  int64_t deliveredNs() const override { return gpio_.exposureDeliveredNs(); }
+  uint32_t startSeq() const override { return gpio_.lastStartSeq(); }
+  bool isActive() const override { return gpio_.exposureActive(); }
+
+private:
+  GpioOutputThread &gpio_;
+};
+
 } // namespace
 
-MainMenuWidget::MainMenuWidget(QWidget *parent) : QWidget(parent), tofSensor_(this) {
+MainMenuWidget::MainMenuWidget(QWidget *parent)
+    : QWidget(parent), tofSensor_(this),
+      sessionExposure_(std::make_unique<GpioSessionExposure>(gpio_)),
+      session_(std::make_unique<SessionEngine>(SessionClock::steady(), *sessionExposure_)),
+      paintTimer_("main menu") {
   setAttribute(Qt::WA_OpaquePaintEvent);
   setAutoFillBackground(false);
 
@@ -145,11 +148,7 @@ MainMenuWidget::MainMenuWidget(QWidget *parent) : QWidget(parent), tofSensor_(th
   tofValueLabel_->setMinimumHeight(52);
   tofValueLabel_->setStyleSheet("QLabel { padding: 6px 0; }" + monoStyle(28, true));
 
-  tofStatusLabel_ = new QLabel("—", tofCard);
-  tofStatusLabel_->setAlignment(Qt::AlignCenter);
-  tofStatusLabel_->setFixedHeight(34);
-  tofStatusLabel_->setStyleSheet(pillStyle("rgba(255,255,255,0.10)", "rgba(255,255,255,0.12)") +
-                                 monoStyle(12, true));
+  tofStatusPill_ = new StatusPill(tofCard);
 
   tofHintLabel_ = new QLabel("Maintain target distance (e.g. 100–120 mm)", tofCard);
   tofHintLabel_->setMinimumHeight(28);
@@ -159,9 +158,11 @@ MainMenuWidget::MainMenuWidget(QWidget *parent) : QWidget(parent), tofSensor_(th
   tofLayout->addWidget(tofTitle);
   tofLayout->addWidget(tofValueLabel_);
   tofLayout->addSpacing(24);
-  tofLayout->addWidget(tofStatusLabel_);
+  tofLayout->addWidget(tofStatusPill_);
   tofLayout->addSpacing(8);
   tofLayout->addWidget(tofHintLabel_);
+  tofDepthMap_ = new TofDepthMapWidget(tofCard);
+  tofLayout->addWidget(tofDepthMap_);
   tofLayout->addStretch(1);
 
   // Indicators card
@@ -185,25 +186,22 @@ MainMenuWidget::MainMenuWidget(QWidget *parent) : QWidget(parent), tofSensor_(th
     return l;
   };
   auto mkValue = [&](const QString &t) {
-    auto *l = new QLabel(t, ioCard);
-    l->setAlignment(Qt::AlignCenter);
-    l->setFixedHeight(34);
-    l->setStyleSheet(pillStyle("rgba(255,255,255,0.10)", "rgba(255,255,255,0.12)") +
-                     monoStyle(12, true));
-    return l;
+    auto *pill = new StatusPill(ioCard);
+    pill->setState(StatusPill::Tone::Neutral, t);
+    return pill;
   };
 
   ioLayout->addWidget(mkName("LASER"), 1, 0);
-  laserValueLabel_ = mkValue("OFF");
-  ioLayout->addWidget(laserValueLabel_, 1, 1);
+  laserPill_ = mkValue("OFF");
+  ioLayout->addWidget(laserPill_, 1, 1);
 
   ioLayout->addWidget(mkName("LED"), 2, 0);
-  led1ValueLabel_ = mkValue("OFF");
-  ioLayout->addWidget(led1ValueLabel_, 2, 1);
+  ledPill_ = mkValue("OFF");
+  ioLayout->addWidget(ledPill_, 2, 1);
 
   ioLayout->addWidget(mkName("ENERGY"), 3, 0);
-  xrayValueLabel_ = mkValue("IDLE");
-  ioLayout->addWidget(xrayValueLabel_, 3, 1);
+  xrayPill_ = mkValue("IDLE");
+  ioLayout->addWidget(xrayPill_, 3, 1);
 
   // Controls row
   auto *controlsCard = new QFrame(this);
@@ -218,7 +216,8 @@ MainMenuWidget::MainMenuWidget(QWidget *parent) : QWidget(parent), tofSensor_(th
   outTitle->setStyleSheet(titleStyle());
   controlsOuter->addWidget(outTitle);
 
-  outputTimeLabel_ = new QLabel(QTime(0, 0).addMSecs(outputSetDurationMs_).toString("m:ss"), controlsCard);
+  outputTimeLabel_ = new QLabel(
+      QTime(0, 0).addMSecs(session_->snapshot().setDurationMs).toString("m:ss"), controlsCard);
   outputTimeLabel_->setAlignment(Qt::AlignCenter);
   outputTimeLabel_->setMinimumHeight(72);
   outputTimeLabel_->setStyleSheet(
@@ -300,186 +299,284 @@ MainMenuWidget::MainMenuWidget(QWidget *parent) : QWidget(parent), tofSensor_(th
   centerWrap->setStretch(1, 8);
   centerWrap->setStretch(2, 1);
 
-  clockTimer_.setInterval(1000);
-  connect(&clockTimer_, &QTimer::timeout, this, [this]() { update(); });
-  clockTimer_.start();
-
-  tickTimer_.setInterval(50);
-  connect(&tickTimer_, &QTimer::timeout, this, [this]() {
-    if (state_ == DeviceState::Running && xrayActive_) {
-      const int elapsedTotal =
-          outputElapsedAccumMs_ + static_cast<int>(outputElapsed_.elapsed());
-      outputRemainingMs_ = std::max(0, outputRunDurationMs_ - elapsedTotal);
-      progress_ = static_cast<int>(100.0 *
-                                   (elapsedTotal / double(std::max(1, outputRunDurationMs_))));
-      if (outputRemainingMs_ <= 0) {
-        enterDone();
-      }
-    } else if (state_ == DeviceState::Ready) {
-      progress_ = 0;
-    }
-
-    if (outputTimeLabel_) {
-      if (state_ == DeviceState::Ready) {
-        outputTimeLabel_->setText(QTime(0, 0).addMSecs(outputSetDurationMs_).toString("m:ss"));
-      } else if (state_ == DeviceState::Done) {
-        outputTimeLabel_->setText("DONE");
-      } else {
-        outputTimeLabel_->setText(QTime(0, 0).addMSecs(outputRemainingMs_).toString("m:ss"));
-      }
-    }
-
-    if (outputProgressBar_) {
-      outputProgressBar_->setVisible(true);
-      outputProgressBar_->setValue(state_ == DeviceState::Ready ? 0 : progress_);
-    }
+  // Ticked by the shared frame scheduler, and only while this screen shows.
+  // Safety does not depend on it: the GPIO thread acts on its inputs itself.
+  FrameScheduler &scheduler = FrameScheduler::instance();
+  scheduler.subscribe(this, 1000, [this]() {
+    if (!clockElement_.setKey(this, timeText()))
+      paintTimer_.countSkipped();
+  });
 
-    updateControlsEnabled();
-    updateIndicators();
-    update();
+  // The session reports its own changes and names the next moment its
+  // display will change; nothing ticks while it is Ready, Paused or Done.
+  sessionTickId_ = scheduler.subscribe(this, 0, [this]() {
+    QElapsedTimer tickTime;
+    tickTime.start();
+    session_->advance();
+    paintTimer_.recordTick(tickTime.nsecsElapsed());
+  });
+  session_->setDeadlineCallback([this](int64_t deadlineNs) {
+    if (deadlineNs == 0)
+      return;
+    const int64_t leftNs = std::max<int64_t>(0, deadlineNs - SessionClock::steady().nowNs());
+    FrameScheduler::instance().requestTick(sessionTickId_,
+                                           static_cast<int>((leftNs + 999'999) / 1'000'000));
   });
-  tickTimer_.start();
+  session_->setChangeCallback([this](const SessionSnapshot &) { refreshView(); });
+  session_->setErrorCallback([this](const char *what) {
+    qWarning() << "Session:" << what << "- staying"
+               << deviceStateName(session_->snapshot().state);
+  });
+
+  // Input edges and exposure reports wake the GUI through the GPIO thread's
+  // eventfd; only without one are the queues polled.
+  if (gpio_.notifyFd() >= 0) {
+    auto *notifier = new QSocketNotifier(gpio_.notifyFd(), QSocketNotifier::Read, this);
+    connect(notifier, &QSocketNotifier::activated, this, [this]() { serviceGpio(); });
+  } else {
+    scheduler.subscribe(this, AmustConfig::kUiTickIntervalMs, [this]() { serviceGpio(); });
+  }
 
   const bool enableTof =
       AmustConfig::kTofEnableByDefault || envTruthy(qgetenv("AMUST_ENABLE_TOF"));
   if (enableTof) {
+    // Startup and restarts run on the sensor's own thread; until the first
+    // sample (and whenever it drops out) the card shows the sensor state
+    // instead of a stale distance.
+    tofSensor_.setStateCallback([this](TofSensorState state) {
+      if (still_)
+        return;
+      tofSensorState_ = state;
+      if (state != TofSensorState::Running) {
+        tofDistanceMm_ = -1;
+        tofZone_ = TofZone::NoTarget;
+        tofTiltDeg_ = -1.0;
+      }
+      updateToFUi();
+      updateTofProfile();
+    });
+    tofSensor_.setDepthMapCallback([this](const TofDepthMap &map) {
+      if (!still_)
+        tofDepthMap_->setDepthMap(map);
+    });
     usingRealTof_ = tofSensor_.start(
         AmustConfig::kTofPollIntervalSeconds,
-        [this](int mm) {
-          tofDistanceMm_ = mm;
+        [this](const TofSample &sample) {
+          if (still_)
+            return;
+          tofDistanceMm_ = sample.distanceMm;
+          tofZone_ = sample.zone;
+          tofTiltDeg_ = sample.tiltDeg;
           updateToFUi();
+          updateTofProfile();
         },
         /*durationSeconds=*/0.0);
+    updateTofProfile();
   }
   if (!usingRealTof_) {
     tofDistanceMm_ = -1;
+    tofZone_ = TofZone::NoTarget;
     updateToFUi();
   }
 
-  auto clampSetDuration = [this]() {
-    // 10s .. 10m
-    outputSetDurationMs_ = std::clamp(outputSetDurationMs_, AmustConfig::kOutputMinMs,
-                                      AmustConfig::kOutputMaxMs);
-    if (state_ == DeviceState::Ready) {
-      outputRunDurationMs_ = outputSetDurationMs_;
-      outputRemainingMs_ = outputSetDurationMs_;
-    }
-  };
-  auto refreshSetLabel = [this]() {
-    if (!outputTimeLabel_)
-      return;
-    outputTimeLabel_->setText(QTime(0, 0).addMSecs(outputSetDurationMs_).toString("m:ss"));
-  };
+  connect(outputMinus10sButton_, &QPushButton::clicked, this,
+          [this]() { session_->adjustSetDuration(-10'000); });
+  connect(outputPlus10sButton_, &QPushButton::clicked, this,
+          [this]() { session_->adjustSetDuration(10'000); });
+  connect(outputMinus1mButton_, &QPushButton::clicked, this,
+          [this]() { session_->adjustSetDuration(-60'000); });
+  connect(outputPlus1mButton_, &QPushButton::clicked, this,
+          [this]() { session_->adjustSetDuration(60'000); });
 
-  connect(outputMinus10sButton_, &QPushButton::clicked, this, [this, clampSetDuration, refreshSetLabel]() {
-    outputSetDurationMs_ -= 10'000;
-    clampSetDuration();
-    refreshSetLabel();
-  });
-  connect(outputPlus10sButton_, &QPushButton::clicked, this, [this, clampSetDuration, refreshSetLabel]() {
-    outputSetDurationMs_ += 10'000;
-    clampSetDuration();
-    refreshSetLabel();
-  });
-  connect(outputMinus1mButton_, &QPushButton::clicked, this, [this, clampSetDuration, refreshSetLabel]() {
-    outputSetDurationMs_ -= 60'000;
-    clampSetDuration();
-    refreshSetLabel();
-  });
-  connect(outputPlus1mButton_, &QPushButton::clicked, this, [this, clampSetDuration, refreshSetLabel]() {
-    outputSetDurationMs_ += 60'000;
-    clampSetDuration();
-    refreshSetLabel();
-  });
-
-  connect(startButton_, &QPushButton::clicked, this, [this]() { startXray(); });
-  connect(pauseButton_, &QPushButton::clicked, this, [this]() { pauseOrResume(); });
-  connect(stopButton_, &QPushButton::clicked, this, [this]() { stopAndReset(); });
+  connect(startButton_, &QPushButton::clicked, this, [this]() { session_->start(); });
+  connect(pauseButton_, &QPushButton::clicked, this, [this]() { session_->pauseOrResume(); });
+  connect(stopButton_, &QPushButton::clicked, this, [this]() { session_->stop(); });
 
   updateToFUi();
-  updateIndicators();
-  updateControlsEnabled();
+  refreshView(MainMenuView::kAllFields);
 
   if (!gpio_.isInitialized()) {
     qWarning() << "GPIO: initialized=false (no output control active)";
   }
+  if (SimulatedGpioInputs *sim = gpio_.simulatedInputs()) {
+    // F5 interlock, F6 e-stop, F7 footswitch (press toggles the input).
+    auto bindToggle = [this, sim](Qt::Key key, GpioInput input) {
+      auto *shortcut = new QShortcut(QKeySequence(key), this);
+      connect(shortcut, &QShortcut::activated, this, [this, sim, input]() {
+        sim->inject(input, !gpio_.isAsserted(input));
+      });
+    };
+    bindToggle(Qt::Key_F5, GpioInput::Interlock);
+    bindToggle(Qt::Key_F6, GpioInput::EmergencyStop);
+    bindToggle(Qt::Key_F7, GpioInput::Footswitch);
+  }
+  gpio_.start();
+}
+
+void MainMenuWidget::showStill(const MainMenuStill &still) {
+  still_ = still;
+  tofSensorState_ = still.tofState;
+  tofDistanceMm_ = still.tofDistanceMm;
+  tofZone_ = still.tofZone;
+  tofTiltDeg_ = still.tofTiltDeg;
+  updateToFUi();
+  refreshView();
+  clockElement_.setKey(this, timeText());
 }
 
 QString MainMenuWidget::timeText() const {
+  if (still_)
+    return still_->clockText;
   return QTime::currentTime().toString("hh:mm");
 }
 
-void MainMenuWidget::setState(DeviceState next) {
-  state_ = next;
-  switch (state_) {
-  case DeviceState::Ready:
-    deviceState_ = "READY";
-    break;
-  case DeviceState::Running:
-    deviceState_ = "RUNNING";
-    break;
-  case DeviceState::Paused:
-    deviceState_ = "PAUSE";
-    break;
-  case DeviceState::Done:
-    deviceState_ = "DONE";
-    break;
-  }
-  updateIndicators();
-  updateControlsEnabled();
-  update();
+QString MainMenuWidget::stateText() const {
+  QString text = QString("STATE %1").arg(deviceStateName(view_.state));
+  if (view_.emergencyStop)
+    text += "  E-STOP";
+  else if (view_.interlockOpen)
+    text += "  INTERLOCK OPEN";
+  return text;
 }
 
-void MainMenuWidget::startXray() {
-  if (state_ != DeviceState::Ready)
-    return;
+void MainMenuWidget::resizeEvent(QResizeEvent *event) {
+  QWidget::resizeEvent(event);
+  const QRectF topBar = ChromeLayout::forRect(QRectF(rect())).topBar;
+  // Text can bleed a pixel past its box when antialiased.
+  stateElement_.setRect(
+      QRectF(topBar.left(), topBar.top(), topBar.width() * 0.45, topBar.height())
+          .toAlignedRect()
+          .adjusted(-1, -1, 1, 1));
+  const int clockW = QFontMetrics(fixedFont(16)).horizontalAdvance(QStringLiteral("00:00")) + 8;
+  clockElement_.setRect(
+      QRectF(topBar.center().x() - clockW * 0.5, topBar.top(), clockW, topBar.height())
+          .toAlignedRect()
+          .adjusted(-1, -1, 1, 1));
+  // The resize repaints everything anyway; record what it will show.
+  stateElement_.setKey(this, stateText());
+  clockElement_.setKey(this, timeText());
+}
 
-  xrayActive_ = true;
-  outputRunDurationMs_ = outputSetDurationMs_;
-  outputRemainingMs_ = outputRunDurationMs_;
-  outputElapsedAccumMs_ = 0;
-  outputElapsed_.restart();
-  setState(DeviceState::Running);
+void MainMenuWidget::showEvent(QShowEvent *event) {
+  QWidget::showEvent(event);
+  // Inputs are only polled while this screen shows. A footswitch press from
+  // before it appeared must not start an exposure; the safety inputs are
+  // read from their current level anyway.
+  GpioInputEvent input;
+  int discarded = 0;
+  while (gpio_.takeInputEvent(input))
+    discarded++;
+  if (discarded > 0)
+    qInfo() << "GPIO: discarded" << discarded << "input edge(s) queued while the menu was hidden";
 }
 
-void MainMenuWidget::pauseOrResume() {
-  if (state_ == DeviceState::Running) {
-    // Pause: stop x-ray (LEDs off), keep remaining time.
-    xrayActive_ = false;
-    outputElapsedAccumMs_ += static_cast<int>(outputElapsed_.elapsed());
-    outputRemainingMs_ = std::max(0, outputRunDurationMs_ - outputElapsedAccumMs_);
-    setState(DeviceState::Paused);
-  } else if (state_ == DeviceState::Paused) {
-    // Resume: continue for remaining time.
-    xrayActive_ = true;
-    // Keep original total duration so progress continues, not reset.
-    outputElapsed_.restart();
-    setState(DeviceState::Running);
+void MainMenuWidget::serviceGpio() {
+  gpio_.acknowledgeNotify();
+
+  // Safety inputs have already been acted on by the GPIO thread; the
+  // footswitch is START / RESUME, but only while this screen shows.
+  const bool shown = isVisible();
+  bool anyInput = false;
+  GpioInputEvent input;
+  while (gpio_.takeInputEvent(input)) {
+    anyInput = true;
+    if (input.input == GpioInput::Footswitch) {
+      if (input.asserted && shown)
+        session_->footswitch();
+    } else {
+      qWarning() << "GPIO:" << (input.input == GpioInput::Interlock ? "interlock" : "e-stop")
+                 << (input.asserted ? "asserted" : "released");
+    }
+  }
+
+  // The GPIO thread ends the exposure on its own deadline; the session only
+  // picks up the result, and drops it if it belongs to an earlier start.
+  ExposureReport report;
+  while (gpio_.takeExposureReport(report)) {
+    qInfo().nospace() << "Exposure: "
+                      << (report.interlocked ? "interlocked"
+                                             : report.completed ? "completed" : "stopped")
+                      << ", requested " << report.requestedNs / 1'000'000 << " ms, delivered "
+                      << report.deliveredNs / 1'000 << " us ("
+                      << (report.errorNs >= 0 ? "overshoot " : "undershoot ")
+                      << std::abs(report.errorNs) / 1'000 << " us) in " << report.segments
+                      << " segment(s), start #" << report.startSeq;
+    session_->exposureEnded(report);
   }
+
+  if (anyInput)
+    refreshView();
 }
 
-void MainMenuWidget::enterDone() {
-  if (state_ == DeviceState::Done)
+void MainMenuWidget::refreshView(uint32_t force) {
+  MainMenuView next =
+      still_ ? MainMenuView::from(still_->session, still_->interlockOpen, still_->emergencyStop)
+             : MainMenuView::from(session_->snapshot(), gpio_.isAsserted(GpioInput::Interlock),
+                                  gpio_.isAsserted(GpioInput::EmergencyStop));
+  if (still_)
+    next.progressRate = 0.0;
+  const uint32_t fields = MainMenuView::diff(view_, next) | force;
+  if (fields == 0)
     return;
-
-  xrayActive_ = false;
-  progress_ = 100;
-  outputRemainingMs_ = 0;
-  outputElapsedAccumMs_ = outputRunDurationMs_;
-  setState(DeviceState::Done);
+  view_ = next;
+
+  if (fields & MainMenuView::kTime)
+    outputTimeLabel_->setText(QLatin1String(view_.timeText));
+  if (fields & MainMenuView::kProgress) {
+    // The session only reports whole percents; the pill fills in between
+    // by itself, stopping short of the next one until it is reported.
+    const int permille = view_.progressPercent * 10;
+    outputProgressBar_->setProgress(permille, view_.progressRate, std::min(1000, permille + 10));
+  }
+  if (fields & MainMenuView::kAdjust) {
+    for (auto *b :
+         {outputMinus10sButton_, outputPlus10sButton_, outputMinus1mButton_, outputPlus1mButton_})
+      b->setEnabled(view_.canAdjust);
+  }
+  if (fields & MainMenuView::kStart)
+    startButton_->setEnabled(view_.startEnabled);
+  if (fields & MainMenuView::kPause) {
+    pauseButton_->setEnabled(view_.pauseEnabled);
+    pauseButton_->setText(view_.pauseResumes ? "RESUME" : "PAUSE");
+  }
+  if (fields & MainMenuView::kStop) {
+    stopButton_->setEnabled(view_.stopEnabled);
+    stopButton_->setText(view_.stopDone ? "DONE" : "STOP");
+  }
+  if (fields & MainMenuView::kExposing) {
+    // The lines themselves (LED1, LED2 and Laser share line 17) follow the
+    // exposure on the GPIO thread; these pills only mirror the UI state.
+    const bool on = view_.exposing;
+    laserPill_->setState(on ? StatusPill::Tone::Ok : StatusPill::Tone::Off,
+                         on ? QStringLiteral("ON") : QStringLiteral("OFF"));
+    ledPill_->setState(on ? StatusPill::Tone::Alert : StatusPill::Tone::Off,
+                       on ? QStringLiteral("ON") : QStringLiteral("OFF"));
+    xrayPill_->setState(on ? StatusPill::Tone::Alert : StatusPill::Tone::Off,
+                        on ? QStringLiteral("RUNNING") : QStringLiteral("READY"));
+  }
+  if (fields & MainMenuView::kState)
+    updateTofProfile();
+  if (fields & (MainMenuView::kState | MainMenuView::kSafety))
+    stateElement_.setKey(this, stateText());
 }
 
-void MainMenuWidget::stopAndReset() {
-  xrayActive_ = false;
-  progress_ = 0;
-  outputRunDurationMs_ = outputSetDurationMs_;
-  outputRemainingMs_ = outputSetDurationMs_;
-  outputElapsedAccumMs_ = 0;
-  setState(DeviceState::Ready);
+void MainMenuWidget::updateTofProfile() {
+  if (!usingRealTof_)
+    return;
+
+  // Fast short-range ranging while someone is positioning a target or an
+  // exposure is in progress; slow long-range ranging otherwise.
+  if (tofDistanceMm_ >= 0 && tofDistanceMm_ <= AmustConfig::kTofPositioningMaxMm)
+    tofNearTargetTimer_.restart();
+  const bool positioning =
+      tofNearTargetTimer_.isValid() && tofNearTargetTimer_.elapsed() < AmustConfig::kTofIdleAfterMs;
+  const DeviceState state = session_->snapshot().state;
+  const bool active = positioning || state == DeviceState::Running || state == DeviceState::Paused;
+  tofSensor_.setRangingProfile(active ? TofRangingProfile::active() : TofRangingProfile::idle());
 }
 
 void MainMenuWidget::updateToFUi() {
-  if (!tofValueLabel_ || !tofStatusLabel_ || !tofHintLabel_)
+  if (!tofValueLabel_ || !tofStatusPill_ || !tofHintLabel_)
     return;
 
   if (tofDistanceMm_ < 0) {
@@ -488,251 +585,87 @@ void MainMenuWidget::updateToFUi() {
     tofValueLabel_->setText(QString::number(tofDistanceMm_) + " mm");
   }
 
-  // Target distance window (tune as needed).
-  constexpr int kMin = AmustConfig::kTofMinMm;
-  constexpr int kMax = AmustConfig::kTofMaxMm;
-
   QString status;
-  QString bg;
-  QString border;
-  QString text;
-
-  if (tofDistanceMm_ < 0) {
-    status = "TOF SENSOR NOT DETECTED";
-    bg = "rgba(255, 70, 70, 0.26)";
-    border = "rgba(255, 70, 70, 0.55)";
-    text = "rgba(255, 190, 190, 0.98)";
-  } else if (tofDistanceMm_ < kMin) {
-    status = "TOO CLOSE";
-    bg = "rgba(255, 70, 70, 0.26)";
-    border = "rgba(255, 70, 70, 0.55)";
-    text = "rgba(255, 190, 190, 0.98)";
-  } else if (tofDistanceMm_ > kMax) {
-    status = "TOO FAR";
-    bg = "rgba(255, 180, 40, 0.26)";
-    border = "rgba(255, 180, 40, 0.55)";
-    text = "rgba(255, 225, 170, 0.98)";
-  } else {
-    status = "OK";
-    bg = "rgba(70, 255, 180, 0.22)";
-    border = "rgba(70, 255, 180, 0.50)";
-    text = "rgba(190, 255, 230, 0.98)";
+  StatusPill::Tone tone = StatusPill::Tone::Alert;
+
+  // Zone comes from the acquisition thread's filter, with hysteresis on the
+  // kTofMinMm..kTofMaxMm edges.
+  switch (tofZone_) {
+  case TofZone::NoTarget:
+    if (tofSensorState_ == TofSensorState::Running)
+      status = QStringLiteral("NO TARGET");
+    else if (tofSensorState_ == TofSensorState::Starting)
+      status = QStringLiteral("TOF SENSOR STARTING");
+    else if (tofSensorState_ == TofSensorState::Restarting)
+      status = QStringLiteral("TOF SENSOR RESTARTING");
+    else
+      status = QStringLiteral("TOF SENSOR NOT DETECTED");
+    tone = StatusPill::Tone::Alert;
+    break;
+  case TofZone::TooClose:
+    status = QStringLiteral("TOO CLOSE");
+    tone = StatusPill::Tone::Alert;
+    break;
+  case TofZone::TooFar:
+    status = QStringLiteral("TOO FAR");
+    tone = StatusPill::Tone::Warn;
+    break;
+  case TofZone::Ok:
+    status = QStringLiteral("OK");
+    tone = StatusPill::Tone::Ok;
+    break;
   }
 
-  tofStatusLabel_->setText(status);
-  tofStatusLabel_->setStyleSheet(pillStyle(bg, border, text) + monoStyle(12, true));
-  tofHintLabel_->setText(QString("Target: %1–%2 mm (adjust position)")
-                             .arg(AmustConfig::kTofMinMm)
-                             .arg(AmustConfig::kTofMaxMm));
-  updateControlsEnabled();
-}
-
-void MainMenuWidget::updateIndicators() {
-  if (!laserValueLabel_ || !led1ValueLabel_ || !xrayValueLabel_)
-    return;
-
-  const bool xrayOn = (state_ == DeviceState::Running && xrayActive_);
-  const bool laserOn = xrayOn;
-  const bool ledsOn = xrayOn;
-
-  laserValueLabel_->setText(laserOn ? "ON" : "OFF");
-  laserValueLabel_->setStyleSheet(
-      pillStyle(laserOn ? "rgba(70,255,180,0.22)" : "rgba(255,255,255,0.06)",
-                laserOn ? "rgba(70,255,180,0.50)" : "rgba(255,255,255,0.10)",
-                laserOn ? "rgba(190,255,230,0.98)" : "rgba(255,255,255,0.55)") +
-      monoStyle(12, true));
-
-  auto ledStyle = [&](bool on) {
-    return pillStyle(on ? "rgba(255,70,70,0.26)" : "rgba(255,255,255,0.06)",
-                    on ? "rgba(255,70,70,0.55)" : "rgba(255,255,255,0.10)",
-                    on ? "rgba(255,190,190,0.98)" : "rgba(255,255,255,0.55)") +
-           monoStyle(12, true);
-  };
-
-  led1ValueLabel_->setText(ledsOn ? "ON" : "OFF");
-  led1ValueLabel_->setStyleSheet(ledStyle(ledsOn));
-
-  const QString xrayText = xrayOn ? "RUNNING" : "READY";
-
-  xrayValueLabel_->setText(xrayText);
-  xrayValueLabel_->setStyleSheet(
-      pillStyle(xrayOn ? "rgba(255,70,70,0.26)" : "rgba(255,255,255,0.06)",
-                xrayOn ? "rgba(255,70,70,0.55)" : "rgba(255,255,255,0.10)",
-                xrayOn ? "rgba(255,190,190,0.98)" : "rgba(255,255,255,0.55)") +
-      monoStyle(12, true));
-
-  // During RUNNING, LED1, LED2, and Laser are tied to the same GPIO line (17).
-  gpio_.setLaser(laserOn);
-  gpio_.setLed1(ledsOn);
-  gpio_.setLed2(ledsOn);
-  gpio_.setXrayEnable(xrayOn);
-}
-
-void MainMenuWidget::updateControlsEnabled() {
-  if (!startButton_ || !pauseButton_ || !stopButton_ || !outputMinus10sButton_ || !outputPlus10sButton_ ||
-      !outputMinus1mButton_ || !outputPlus1mButton_)
-    return;
-
-  const bool canAdjust = (state_ == DeviceState::Ready);
-  outputMinus10sButton_->setEnabled(canAdjust);
-  outputPlus10sButton_->setEnabled(canAdjust);
-  outputMinus1mButton_->setEnabled(canAdjust);
-  outputPlus1mButton_->setEnabled(canAdjust);
-
-  startButton_->setEnabled(state_ == DeviceState::Ready);
-  pauseButton_->setEnabled(state_ == DeviceState::Running || state_ == DeviceState::Paused);
-  pauseButton_->setText(state_ == DeviceState::Paused ? "RESUME" : "PAUSE");
+  // A sensor array also reports tilt; the distance only counts as OK while
+  // the head is square to the surface.
+  if (tofZone_ == TofZone::Ok && tofTiltDeg_ > AmustConfig::kTofMaxTiltDeg) {
+    status = QStringLiteral("TILTED");
+    tone = StatusPill::Tone::Warn;
+  }
 
-  stopButton_->setEnabled(state_ != DeviceState::Ready);
-  if (state_ == DeviceState::Done) {
-    stopButton_->setText("DONE");
-    pauseButton_->setEnabled(false);
+  tofStatusPill_->setState(tone, status);
+  if (tofTiltDeg_ >= 0.0) {
+    tofHintLabel_->setText(QString("Target: %1–%2 mm, tilt ≤ %3° (now %4°)")
+                               .arg(AmustConfig::kTofMinMm)
+                               .arg(AmustConfig::kTofMaxMm)
+                               .arg(AmustConfig::kTofMaxTiltDeg, 0, 'f', 0)
+                               .arg(tofTiltDeg_, 0, 'f', 1));
   } else {
-    stopButton_->setText("STOP");
+    tofHintLabel_->setText(QString("Target: %1–%2 mm (adjust position)")
+                               .arg(AmustConfig::kTofMinMm)
+                               .arg(AmustConfig::kTofMaxMm));
   }
 }
 
 void MainMenuWidget::paintEvent(QPaintEvent *event) {
-  Q_UNUSED(event);
+  QElapsedTimer paintTime;
+  paintTime.start();
 
   QPainter p(this);
+  const QRect dirty = event->rect();
+  const ChromeLayout &chrome = chrome_.paint(p, size(), devicePixelRatioF(), dirty);
   p.setRenderHint(QPainter::Antialiasing, true);
 
-  // Full-screen blue background
-  const QRectF screen = fitAspect(QRectF(rect()), 1024.0, 600.0);
-  {
-    QLinearGradient bg(screen.topLeft(), screen.bottomLeft());
-    bg.setColorAt(0.0, QColor("#1a4d7a"));
-    bg.setColorAt(0.5, QColor("#2b7bc4"));
-    bg.setColorAt(1.0, QColor("#0f2d4a"));
-    p.fillRect(screen, bg);
-
-    QRadialGradient glow(screen.center(), screen.width() * 0.55);
-    glow.setColorAt(0.0, withAlpha(QColor("#3a8dd8"), 0.22));
-    glow.setColorAt(0.6, withAlpha(QColor("#3a8dd8"), 0.05));
-    glow.setColorAt(1.0, withAlpha(QColor("#3a8dd8"), 0.0));
-    p.fillRect(screen, glow);
-  }
-
-  // Content paddings (keep same chrome as BootScreenWidget)
-  const qreal padXBar = screen.width() * 0.04;
-  const qreal topPad = screen.height() * 0.03;
-  const qreal bottomPad = screen.height() * 0.02;
-  const QRectF contentBar = screen.adjusted(padXBar, topPad, -padXBar, -bottomPad);
-
-  // Top bar
-  const qreal topBarH = contentBar.height() * 0.06;
-  const QRectF topBar(contentBar.left(), contentBar.top(), contentBar.width(), topBarH);
-  const qreal topLineY = topBar.bottom();
+  const QRectF &topBar = chrome.topBar;
+  const qreal topBarH = topBar.height();
 
   // Top left: state
-  {
+  if (dirty.intersects(stateElement_.rect())) {
     p.setFont(fixedFont(14));
     p.setPen(withAlpha(Qt::white, 0.72));
-    const QString left = QString("STATE %1").arg(deviceState_);
     p.drawText(QRectF(topBar.left(), topBar.top(), topBar.width() * 0.45, topBarH),
-               Qt::AlignVCenter | Qt::AlignLeft, left);
+               Qt::AlignVCenter | Qt::AlignLeft, stateText());
   }
 
   // Top center: time
-  {
+  if (dirty.intersects(clockElement_.rect())) {
     p.setFont(fixedFont(16));
     p.setPen(withAlpha(Qt::white, 0.82));
     p.drawText(QRectF(topBar.left(), topBar.top(), topBar.width(), topBarH),
                Qt::AlignVCenter | Qt::AlignHCenter, timeText());
   }
 
-  // Top right: dots
-  {
-    const int dotCount = 7;
-    const qreal r = 4.0;
-    const qreal gap = 6.0;
-    const qreal totalW = dotCount * (2 * r) + (dotCount - 1) * gap;
-    const qreal x0 = topBar.right() - totalW;
-    const qreal y0 = topBar.center().y() - r;
-    p.setPen(Qt::NoPen);
-    p.setBrush(withAlpha(Qt::white, 0.55));
-    for (int i = 0; i < dotCount; i++) {
-      p.drawEllipse(QRectF(x0 + i * (2 * r + gap), y0, 2 * r, 2 * r));
-    }
-  }
-
-  // Top border line
-  {
-    QLinearGradient line(QPointF(contentBar.left(), topLineY), QPointF(contentBar.right(), topLineY));
-    line.setColorAt(0.0, withAlpha(Qt::white, 0.55));
-    line.setColorAt(0.5, withAlpha(Qt::white, 0.8));
-    line.setColorAt(1.0, withAlpha(Qt::white, 0.55));
-    p.setPen(QPen(QBrush(line), 1.0));
-    p.drawLine(QPointF(contentBar.left(), topLineY), QPointF(contentBar.right(), topLineY));
-  }
-
-  // Bottom bar layout
-  const qreal bottomBarH = contentBar.height() * 0.12;
-  const QRectF bottomBar(contentBar.left(), contentBar.bottom() - bottomBarH, contentBar.width(),
-                         bottomBarH);
-  const qreal footerHeight = 18.0;
-  const qreal footerTopY = bottomBar.bottom() - footerHeight;
-  const qreal topLineOffset = topLineY - topBar.top();
-  qreal bottomLineY = bottomBar.bottom() - topLineOffset;
-  bottomLineY = std::min(bottomLineY, footerTopY - 10.0);
-
-  // Bottom border line
-  {
-    QLinearGradient line(QPointF(contentBar.left(), bottomLineY),
-                         QPointF(contentBar.right(), bottomLineY));
-    line.setColorAt(0.0, withAlpha(Qt::white, 0.55));
-    line.setColorAt(0.5, withAlpha(Qt::white, 0.8));
-    line.setColorAt(1.0, withAlpha(Qt::white, 0.55));
-    p.setPen(QPen(QBrush(line), 1.0));
-    p.drawLine(QPointF(contentBar.left(), bottomLineY), QPointF(contentBar.right(), bottomLineY));
-  }
-
-  // Left decorative circles
-  {
-    const QPointF base(contentBar.left() + 20, bottomLineY);
-    p.setPen(QPen(withAlpha(Qt::white, 0.7), 2.0));
-    p.setBrush(Qt::NoBrush);
-    p.drawEllipse(base, 4.0, 4.0);
-    p.setBrush(withAlpha(Qt::white, 0.18));
-    p.drawEllipse(QPointF(base.x() + 16, base.y()), 6.0, 6.0);
-    p.setBrush(Qt::NoBrush);
-    p.drawEllipse(QPointF(base.x() + 32, base.y()), 4.0, 4.0);
-  }
-
-  // ECG line (right)
-  {
-    const QRectF ecg(contentBar.right() - 110, bottomLineY - 14, 100, 28);
-    QPainterPath path;
-    path.moveTo(ecg.left(), ecg.center().y());
-    path.lineTo(ecg.left() + ecg.width() * 0.2, ecg.center().y());
-    path.lineTo(ecg.left() + ecg.width() * 0.25, ecg.top() + ecg.height() * 0.25);
-    path.lineTo(ecg.left() + ecg.width() * 0.3, ecg.bottom() - ecg.height() * 0.25);
-    path.lineTo(ecg.left() + ecg.width() * 0.35, ecg.center().y());
-    path.lineTo(ecg.right(), ecg.center().y());
-    p.setBrush(Qt::NoBrush);
-    p.setPen(QPen(withAlpha(Qt::white, 0.9), 2.0, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
-    p.drawPath(path);
-  }
-
-  // Footer text
-  {
-    p.setFont(fixedFont(11));
-    p.setPen(withAlpha(Qt::white, 0.5));
-    const QString footer = QString::fromUtf8(
-        u8"UMUSTR&D | Model AMUST-A001RPIW | HW Rev.C | FIRMWARE v1.0.0");
-    p.drawText(QRectF(contentBar.left(), footerTopY, contentBar.width(), 16),
-               Qt::AlignHCenter, footer);
-  }
-
-  // Screen glare
-  {
-    QRectF glare(screen.left(), screen.top(), screen.width(), screen.height() * 0.22);
-    QLinearGradient g(glare.topLeft(), glare.bottomLeft());
-    g.setColorAt(0.0, withAlpha(Qt::white, 0.06));
-    g.setColorAt(1.0, withAlpha(Qt::white, 0.0));
-    p.setPen(Qt::NoPen);
-    p.setBrush(g);
-    p.drawRect(glare);
-  }
+  chrome_.paintGlare(p, dirty);
+  p.end();
+  paintTimer_.record(paintTime.nsecsElapsed(), event->region(), chrome_);
 }
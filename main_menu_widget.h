@@ -1,18 +1,36 @@
 #pragma once
 
 #include <memory>
+#include <optional>
 
 #include <QElapsedTimer>
 #include <QLabel>
 #include <QPushButton>
-#include <QTimer>
 #include <QWidget>
 
 #include "amust_config.h"
-#include "gpio_controller.h"
+#include "chrome_renderer.h"
+#include "gpio_output_thread.h"
 #include "hw/tof_sensor_controller.h"
+#include "main_menu_view.h"
+#include "session_engine.h"
 
 class ProgressPill;
+class StatusPill;
+class TofDepthMapWidget;
+
+// A fixed main menu for tools/render_bench: what to show instead of the
+// live session, safety inputs, ToF readings and clock.
+struct MainMenuStill {
+  SessionSnapshot session;
+  bool interlockOpen = false;
+  bool emergencyStop = false;
+  TofSensorState tofState = TofSensorState::Stopped;
+  int tofDistanceMm = -1;
+  TofZone tofZone = TofZone::NoTarget;
+  double tofTiltDeg = -1.0;
+  QString clockText = QStringLiteral("12:00");
+};
 
 class MainMenuWidget final : public QWidget {
   Q_OBJECT
@@ -20,50 +38,47 @@ class MainMenuWidget final : public QWidget {
 public:
   explicit MainMenuWidget(QWidget *parent = nullptr);
 
+  // Shows `still` from now on; the live sources keep running but no longer
+  // reach the screen, and the progress pill does not interpolate, so two
+  // renders of the same still are identical.
+  void showStill(const MainMenuStill &still);
+
 protected:
   void paintEvent(QPaintEvent *event) override;
+  void resizeEvent(QResizeEvent *event) override;
+  void showEvent(QShowEvent *event) override;
 
 private:
-  enum class DeviceState { Ready, Running, Paused, Done };
-
-  void setState(DeviceState next);
-  void startXray();
-  void pauseOrResume();
-  void enterDone();
-  void stopAndReset();
+  // Drains the GPIO thread's input edges and exposure reports.
+  void serviceGpio();
+  // Rebuilds the view from the session and safety inputs and updates the
+  // widgets behind the fields that changed (plus those in `force`).
+  void refreshView(uint32_t force = 0);
 
   void updateToFUi();
-  void updateIndicators();
-  void updateControlsEnabled();
+  void updateTofProfile();
 
   QString timeText() const;
+  // Top-bar state, including an active e-stop or open interlock.
+  QString stateText() const;
 
-  QTimer tickTimer_;
-  QTimer clockTimer_;
-  QTimer tofTimer_;
   TofSensorController tofSensor_;
   bool usingRealTof_ = false;
 
-  int progress_ = 0;
   int tofDistanceMm_ = -1;
-
-  DeviceState state_ = DeviceState::Ready;
-  bool xrayActive_ = false;
-  int outputSetDurationMs_ = AmustConfig::kOutputDefaultMs;
-  int outputRunDurationMs_ = AmustConfig::kOutputDefaultMs;
-  int outputRemainingMs_ = AmustConfig::kOutputDefaultMs;
-  QElapsedTimer outputElapsed_;
-  int outputElapsedAccumMs_ = 0;
-
-  QString deviceState_ = "READY";
+  TofZone tofZone_ = TofZone::NoTarget;
+  double tofTiltDeg_ = -1.0; // -1 = unknown (single sensor)
+  TofSensorState tofSensorState_ = TofSensorState::Stopped;
+  QElapsedTimer tofNearTargetTimer_; // since a target was last within positioning range
 
   QLabel *tofValueLabel_ = nullptr;
-  QLabel *tofStatusLabel_ = nullptr;
+  StatusPill *tofStatusPill_ = nullptr;
   QLabel *tofHintLabel_ = nullptr;
+  TofDepthMapWidget *tofDepthMap_ = nullptr;
 
-  QLabel *laserValueLabel_ = nullptr;
-  QLabel *led1ValueLabel_ = nullptr;
-  QLabel *xrayValueLabel_ = nullptr;
+  StatusPill *laserPill_ = nullptr;
+  StatusPill *ledPill_ = nullptr;
+  StatusPill *xrayPill_ = nullptr;
 
   QLabel *outputTimeLabel_ = nullptr;
   ProgressPill *outputProgressBar_ = nullptr;
@@ -76,5 +91,15 @@ private:
   QPushButton *pauseButton_ = nullptr;
   QPushButton *stopButton_ = nullptr;
 
-  GpioController gpio_;
+  GpioOutputThread gpio_;
+  std::unique_ptr<SessionExposure> sessionExposure_; // drives gpio_
+  std::unique_ptr<SessionEngine> session_;
+  int sessionTickId_ = -1; // FrameScheduler, on demand at session deadlines
+  MainMenuView view_;       // as last applied to the widgets
+  std::optional<MainMenuStill> still_;
+
+  ChromeRenderer chrome_;
+  PaintTimer paintTimer_;
+  DirtyElement stateElement_;
+  DirtyElement clockElement_;
 };
@@ -1,58 +1,171 @@
 #include "progress_pill.h"
 
 #include <algorithm>
+#include <cmath>
 
 #include <QPainter>
 #include <QPainterPath>
+#include <QResizeEvent>
 
-ProgressPill::ProgressPill(QWidget *parent) : QWidget(parent) {
-  setMinimumHeight(30);
-}
+#include "frame_scheduler.h"
 
-void ProgressPill::setValue(int value01to100) {
-  const int next = std::clamp(value01to100, 0, 100);
-  if (next == value_) {
-    return;
-  }
-  value_ = next;
-  update();
-}
+namespace {
 
-void ProgressPill::paintEvent(QPaintEvent *event) {
-  Q_UNUSED(event);
+const QColor kTrackBorder(255, 255, 255, 26);
+const QColor kTrackFill(255, 255, 255, 31);
+const QColor kBarFill(255, 255, 255, 140);
+const QColor kTextColor(255, 255, 255, 190);
 
-  QPainter p(this);
-  p.setRenderHint(QPainter::Antialiasing, true);
+// The empty track, or with full set the track completely filled; the
+// widget shows the left part of one and the right part of the other.
+QPixmap renderTrack(const QSize &size, qreal dpr, bool full) {
+  QPixmap pm(QSize(qRound(size.width() * dpr), qRound(size.height() * dpr)));
+  pm.setDevicePixelRatio(dpr);
+  pm.fill(Qt::transparent);
 
-  const QRectF r = QRectF(rect()).adjusted(0.5, 0.5, -0.5, -0.5);
+  QPainter p(&pm);
+  p.setRenderHint(QPainter::Antialiasing, true);
+  const QRectF r = QRectF(QPointF(0, 0), QSizeF(size)).adjusted(0.5, 0.5, -0.5, -0.5);
   const qreal radius = r.height() * 0.5;
 
-  // Track
   QPainterPath trackPath;
   trackPath.addRoundedRect(r, radius, radius);
-  p.setPen(QPen(QColor(255, 255, 255, 26), 1.0));
-  p.setBrush(QColor(255, 255, 255, 31));
+  p.setPen(QPen(kTrackBorder, 1.0));
+  p.setBrush(kTrackFill);
   p.drawPath(trackPath);
 
-  // Fill (clip to rounded track so it "fills" instead of looking like a blob that grows)
-  const qreal w = r.width() * (value_ / 100.0);
-  if (w > 0.0) {
-    QRectF fill = r;
-    fill.setWidth(std::max(w, 1.0));
-
-    p.save();
+  // Clipped to the rounded track so it "fills" instead of looking like a
+  // blob that grows.
+  if (full) {
     p.setClipPath(trackPath);
     p.setPen(Qt::NoPen);
-    p.setBrush(QColor(255, 255, 255, 140));
-    p.drawRect(fill);
-    p.restore();
+    p.setBrush(kBarFill);
+    p.drawRect(r);
+  }
+  return pm;
+}
+
+} // namespace
+
+ProgressPill::ProgressPill(QWidget *parent) : QWidget(parent) {
+  setMinimumHeight(30);
+  text_.setTextFormat(Qt::PlainText);
+  text_.setPerformanceHint(QStaticText::AggressiveCaching);
+  text_.setText(QStringLiteral("0%"));
+  clock_.start();
+  tickId_ = FrameScheduler::instance().subscribe(this, 0, [this]() { onTick(); });
+}
+
+void ProgressPill::setProgress(int permille, double permillePerSecond, int limitPermille) {
+  const int next = std::clamp(permille, 0, 1000);
+  const int64_t nowNs = clock_.nsecsElapsed();
+  const double current = valueAt(nowNs);
+
+  if (next / 10 != permille_ / 10) {
+    text_.setText(QString::number(next / 10) + QLatin1Char('%'));
+    textDirty_ = true;
+    update();
+  }
+  limit_ = std::clamp(double(std::max(limitPermille, next)), 0.0, 1000.0);
+  baseValue_ = next == permille_ ? std::min(current, limit_) : next;
+  baseNs_ = nowNs;
+  rate_ = std::max(0.0, permillePerSecond);
+  permille_ = next;
+
+  updateFill(fillPixels(baseValue_));
+  scheduleTick(baseValue_);
+}
+
+double ProgressPill::valueAt(int64_t nowNs) const {
+  if (rate_ <= 0.0)
+    return baseValue_;
+  return std::min(limit_, baseValue_ + rate_ * double(nowNs - baseNs_) * 1e-9);
+}
+
+int ProgressPill::fillPixels(double value) const {
+  const int width = qRound(this->width() * devicePixelRatioF());
+  const int px = int(std::lround(value * width / 1000.0));
+  return value > 0.0 ? std::max(px, 1) : 0;
+}
+
+void ProgressPill::ensureCache() {
+  const qreal dpr = devicePixelRatioF();
+  const QSize devSize(qRound(width() * dpr), qRound(height() * dpr));
+  if (track_.size() != devSize || track_.devicePixelRatio() != dpr) {
+    track_ = renderTrack(size(), dpr, false);
+    filled_ = renderTrack(size(), dpr, true);
+    textFont_ = font();
+    textFont_.setBold(true);
+    textFont_.setPixelSize(std::max(10, int((height() - 1) * 0.45)));
+    textDirty_ = true;
+    shownFillPx_ = fillPixels(valueAt(clock_.nsecsElapsed()));
+  }
+  if (textDirty_) {
+    text_.prepare(QTransform(), textFont_);
+    const QSizeF ts = text_.size();
+    textPos_ = QPointF((width() - ts.width()) * 0.5, (height() - ts.height()) * 0.5);
+    textDirty_ = false;
+  }
+}
+
+void ProgressPill::updateFill(int fillPx) {
+  if (fillPx == shownFillPx_)
+    return;
+  // Only the strip between the old and the new fill edge changes. Paint
+  // uses this edge rather than the time of the paint, so the strip is
+  // always exactly what changed.
+  const qreal dpr = devicePixelRatioF();
+  const int left = int(std::floor(std::min(fillPx, shownFillPx_) / dpr)) - 1;
+  const int right = int(std::ceil(std::max(fillPx, shownFillPx_) / dpr)) + 1;
+  shownFillPx_ = fillPx;
+  update(QRect(left, 0, right - left, height()));
+}
+
+void ProgressPill::onTick() {
+  const double value = valueAt(clock_.nsecsElapsed());
+  updateFill(fillPixels(value));
+  scheduleTick(value);
+}
+
+void ProgressPill::scheduleTick(double value) {
+  if (rate_ <= 0.0 || value >= limit_)
+    return;
+  // Wake up when the fill edge reaches the next device pixel (or the
+  // limit), not every frame: a 10-minute exposure across a few hundred
+  // pixels moves about once a second.
+  const int width = qRound(this->width() * devicePixelRatioF());
+  double target = limit_;
+  if (width > 0)
+    target = std::min(target, (fillPixels(value) + 0.5) * 1000.0 / width);
+  const int delayMs = int(std::ceil(std::max(0.0, target - value) / rate_ * 1000.0));
+  FrameScheduler::instance().requestTick(tickId_, delayMs);
+}
+
+void ProgressPill::resizeEvent(QResizeEvent *event) {
+  QWidget::resizeEvent(event);
+  const double value = valueAt(clock_.nsecsElapsed());
+  shownFillPx_ = fillPixels(value);
+  scheduleTick(value);
+}
+
+void ProgressPill::paintEvent(QPaintEvent *event) {
+  Q_UNUSED(event);
+  ensureCache();
+
+  const int fill = shownFillPx_;
+  QPainter p(this);
+  const qreal dpr = track_.devicePixelRatio();
+  const qreal edge = fill / dpr;
+  if (fill > 0) {
+    p.drawPixmap(QRectF(0, 0, edge, height()), filled_,
+                 QRectF(0, 0, fill, filled_.height()));
+  }
+  if (fill < track_.width()) {
+    p.drawPixmap(QRectF(edge, 0, width() - edge, height()), track_,
+                 QRectF(fill, 0, track_.width() - fill, track_.height()));
   }
 
-  // Percent text
-  p.setPen(QColor(255, 255, 255, 190));
-  QFont f = font();
-  f.setBold(true);
-  f.setPixelSize(std::max(10, int(r.height() * 0.45)));
-  p.setFont(f);
-  p.drawText(r, Qt::AlignCenter, QString::number(value_) + "%");
+  p.setPen(kTextColor);
+  p.setFont(textFont_);
+  p.drawStaticText(textPos_, text_);
 }
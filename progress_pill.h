@@ -1,20 +1,58 @@
 #pragma once
 
+#include <QElapsedTimer>
+#include <QFont>
+#include <QPixmap>
+#include <QStaticText>
 #include <QWidget>
 
+#include <cstdint>
+
+// Rounded progress track with a "N%" label. The fill has permille
+// resolution and, given a rate, keeps advancing on its own between
+// setProgress() calls: it schedules its own frames (FrameScheduler, on
+// demand) for when the fill edge next reaches a new device pixel. The empty
+// and full track are rendered once per size into pixmaps, so a frame is two
+// blits and a prepared QStaticText.
 class ProgressPill final : public QWidget {
   Q_OBJECT
 
 public:
   explicit ProgressPill(QWidget *parent = nullptr);
 
-  void setValue(int value01to100);
-  int value() const { return value_; }
+  // permille (0..1000) is the value now; the label shows it in whole
+  // percent. While permillePerSecond > 0 the fill advances from there up to
+  // limitPermille. Setting the same permille again only changes the rate,
+  // from wherever the fill has got to, so pausing never moves it back.
+  void setProgress(int permille, double permillePerSecond = 0.0, int limitPermille = 1000);
+  int permille() const { return permille_; }
 
 protected:
   void paintEvent(QPaintEvent *event) override;
+  void resizeEvent(QResizeEvent *event) override;
 
 private:
-  int value_ = 0;
-};
+  double valueAt(int64_t nowNs) const;
+  int fillPixels(double value) const; // device pixels
+  void ensureCache();
+  void updateFill(int fillPx);
+  void onTick();
+  void scheduleTick(double value);
+
+  QElapsedTimer clock_;
+  int tickId_ = 0;
 
+  int permille_ = 0;       // as last set
+  double baseValue_ = 0.0; // permille at baseNs_, interpolated from here
+  int64_t baseNs_ = 0;
+  double rate_ = 0.0; // permille per second
+  double limit_ = 1000.0;
+  int shownFillPx_ = 0; // device pixels, as painted or about to be
+
+  QPixmap track_;
+  QPixmap filled_;
+  QFont textFont_;
+  QStaticText text_;
+  QPointF textPos_;
+  bool textDirty_ = true;
+};
@@ -0,0 +1,246 @@
+#include "pwm_output.h"
+
+#include <QByteArray>
+#include <QDebug>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+namespace {
+constexpr const char *kDefaultPwmRoot = "/sys/class/pwm";
+// udev applies permissions to a freshly exported channel asynchronously.
+constexpr int kExportWaitSteps = 20;
+constexpr auto kExportWaitStep = std::chrono::milliseconds(5);
+
+#if defined(__linux__)
+bool writeFile(const std::string &path, const std::string &text) {
+  const int fd = ::open(path.c_str(), O_WRONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+  const bool ok = ::write(fd, text.data(), text.size()) == static_cast<ssize_t>(text.size());
+  ::close(fd);
+  return ok;
+}
+
+int openAttribute(const std::string &path) {
+  int fd = -1;
+  for (int i = 0; i < kExportWaitSteps && fd < 0; i++) {
+    fd = ::open(path.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd < 0)
+      std::this_thread::sleep_for(kExportWaitStep);
+  }
+  return fd;
+}
+#endif
+} // namespace
+
+SysfsPwmChannel::SysfsPwmChannel(std::string root) : root_(std::move(root)) {
+  if (root_.empty()) {
+    const QByteArray env = qgetenv("AMUST_PWM_SYSFS");
+    root_ = env.isEmpty() ? kDefaultPwmRoot : env.toStdString();
+  }
+}
+
+SysfsPwmChannel::~SysfsPwmChannel() {
+  close();
+}
+
+bool SysfsPwmChannel::open(int chip, int channel, int64_t periodNs) {
+  close();
+#if defined(__linux__)
+  const std::string chipDir = root_ + "/pwmchip" + std::to_string(chip);
+  const std::string channelDir = chipDir + "/pwm" + std::to_string(channel);
+  struct stat st {};
+  if (::stat(channelDir.c_str(), &st) != 0 &&
+      !writeFile(chipDir + "/export", std::to_string(channel))) {
+    qWarning() << "PWM: cannot export" << channelDir.c_str();
+    return false;
+  }
+  periodFd_ = openAttribute(channelDir + "/period");
+  dutyFd_ = openAttribute(channelDir + "/duty_cycle");
+  enableFd_ = openAttribute(channelDir + "/enable");
+  if (periodFd_ < 0 || dutyFd_ < 0 || enableFd_ < 0) {
+    qWarning() << "PWM: cannot open" << channelDir.c_str();
+    close();
+    return false;
+  }
+  // Duty first: the kernel rejects a period shorter than the current duty.
+  periodNs_ = -1;
+  dutyNs_ = -1;
+  if (!writeValue(dutyFd_, 0) || !writeValue(periodFd_, periodNs) || !writeValue(enableFd_, 1)) {
+    qWarning() << "PWM: cannot configure" << channelDir.c_str();
+    close();
+    return false;
+  }
+  dutyNs_ = 0;
+  periodNs_ = periodNs;
+  return true;
+#else
+  Q_UNUSED(chip);
+  Q_UNUSED(channel);
+  Q_UNUSED(periodNs);
+  return false;
+#endif
+}
+
+void SysfsPwmChannel::close() {
+#if defined(__linux__)
+  if (enableFd_ >= 0)
+    writeValue(enableFd_, 0);
+  for (int *fd : {&periodFd_, &dutyFd_, &enableFd_}) {
+    if (*fd >= 0)
+      ::close(*fd);
+    *fd = -1;
+  }
+#endif
+}
+
+bool SysfsPwmChannel::apply(int64_t periodNs, int64_t dutyNs) {
+  if (!isOpen())
+    return false;
+  dutyNs = std::min(dutyNs, periodNs);
+  if (periodNs != periodNs_) {
+    // Keep duty <= period at every step.
+    const bool dutyFirst = dutyNs_ > periodNs;
+    if (dutyFirst && !writeValue(dutyFd_, dutyNs))
+      return false;
+    if (!writeValue(periodFd_, periodNs))
+      return false;
+    periodNs_ = periodNs;
+    if (dutyFirst)
+      dutyNs_ = dutyNs;
+  }
+  if (dutyNs != dutyNs_) {
+    if (!writeValue(dutyFd_, dutyNs))
+      return false;
+    dutyNs_ = dutyNs;
+  }
+  return true;
+}
+
+bool SysfsPwmChannel::writeValue(int fd, int64_t value) {
+#if defined(__linux__)
+  char text[24];
+  const int len = std::snprintf(text, sizeof(text), "%lld\n", static_cast<long long>(value));
+  writes_++;
+  return ::pwrite(fd, text, static_cast<size_t>(len), 0) == len;
+#else
+  Q_UNUSED(fd);
+  Q_UNUSED(value);
+  return false;
+#endif
+}
+
+bool createMockPwmSysfs(const std::string &root, int chip, int channels) {
+#if defined(__linux__)
+  auto create = [](const std::string &path, const std::string &text) {
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+      return false;
+    const bool ok = ::write(fd, text.data(), text.size()) == static_cast<ssize_t>(text.size());
+    ::close(fd);
+    return ok;
+  };
+  const std::string chipDir = root + "/pwmchip" + std::to_string(chip);
+  ::mkdir(root.c_str(), 0755);
+  if (::mkdir(chipDir.c_str(), 0755) != 0 && errno != EEXIST)
+    return false;
+  bool ok = create(chipDir + "/export", "") && create(chipDir + "/unexport", "") &&
+            create(chipDir + "/npwm", std::to_string(channels) + "\n");
+  for (int c = 0; c < channels && ok; c++) {
+    const std::string dir = chipDir + "/pwm" + std::to_string(c);
+    if (::mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+      return false;
+    ok = create(dir + "/period", "0\n") && create(dir + "/duty_cycle", "0\n") &&
+         create(dir + "/enable", "0\n") && create(dir + "/polarity", "normal\n");
+  }
+  return ok;
+#else
+  Q_UNUSED(root);
+  Q_UNUSED(chip);
+  Q_UNUSED(channels);
+  return false;
+#endif
+}
+
+SoftPwm::SoftPwm() {
+#if defined(__linux__)
+  timerFd_ = ::timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+  if (timerFd_ < 0)
+    qWarning() << "PWM: timerfd unavailable; using poll timeouts";
+#endif
+}
+
+SoftPwm::~SoftPwm() {
+#if defined(__linux__)
+  if (timerFd_ >= 0)
+    ::close(timerFd_);
+#endif
+}
+
+void SoftPwm::set(PwmOutput output, const PwmSetting &setting, int64_t nowNs) {
+  Wave &wave = waves_[static_cast<size_t>(output)];
+  wave.setting = setting;
+  wave.phaseNs = nowNs;
+}
+
+const PwmSetting &SoftPwm::setting(PwmOutput output) const {
+  return waves_[static_cast<size_t>(output)].setting;
+}
+
+bool SoftPwm::level(PwmOutput output, int64_t nowNs) const {
+  const Wave &wave = waves_[static_cast<size_t>(output)];
+  if (!wave.setting.isModulated())
+    return wave.setting.periodNs == 0 || wave.setting.dutyNs > 0;
+  return (nowNs - wave.phaseNs) % wave.setting.periodNs < wave.setting.dutyNs;
+}
+
+int64_t SoftPwm::arm(uint32_t activeMask, int64_t nowNs) {
+  int64_t next = 0;
+  for (size_t i = 0; i < kPwmOutputCount; i++) {
+    const Wave &wave = waves_[i];
+    if (!((activeMask >> i) & 1u) || !wave.setting.isModulated() || wave.setting.dutyNs <= 0)
+      continue;
+    const int64_t periodNs = wave.setting.periodNs;
+    const int64_t intoNs = (nowNs - wave.phaseNs) % periodNs;
+    const int64_t cycleNs = nowNs - intoNs;
+    const int64_t edgeNs =
+        intoNs < wave.setting.dutyNs ? cycleNs + wave.setting.dutyNs : cycleNs + periodNs;
+    if (next == 0 || edgeNs < next)
+      next = edgeNs;
+  }
+  if (next == nextEdgeNs_)
+    return next; // already armed there
+  nextEdgeNs_ = next;
+#if defined(__linux__)
+  if (timerFd_ >= 0) {
+    // it_value 0 disarms.
+    itimerspec spec{};
+    if (next > 0) {
+      spec.it_value.tv_sec = static_cast<time_t>(next / 1'000'000'000);
+      spec.it_value.tv_nsec = static_cast<long>(next % 1'000'000'000);
+    }
+    ::timerfd_settime(timerFd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+  }
+#endif
+  return next;
+}
+
+void SoftPwm::acknowledgeTimer() {
+#if defined(__linux__)
+  if (timerFd_ >= 0) {
+    uint64_t expirations = 0;
+    (void)::read(timerFd_, &expirations, sizeof(expirations));
+  }
+#endif
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Outputs that can be dimmed or pulsed. X-ray enable is deliberately not one.
+enum class PwmOutput : uint8_t { Laser, Led1, Led2 };
+inline constexpr size_t kPwmOutputCount = 3;
+
+// A period of 0, or a duty that covers the period, is steady on. The output's
+// on/off state still gates it: an output that is off stays off.
+struct PwmSetting {
+  int64_t periodNs = 0;
+  int64_t dutyNs = 0;
+
+  bool isModulated() const { return periodNs > 0 && dutyNs < periodNs; }
+};
+
+inline bool operator==(const PwmSetting &a, const PwmSetting &b) {
+  return a.periodNs == b.periodNs && a.dutyNs == b.dutyNs;
+}
+
+// One channel of the kernel PWM class (<root>/pwmchipN/pwmM), exported on
+// open(). The attribute files stay open, and apply() rewrites only the values
+// that changed, so a set-point update is one or two pwrite()s.
+class SysfsPwmChannel final {
+public:
+  // Empty root = AMUST_PWM_SYSFS, else /sys/class/pwm.
+  explicit SysfsPwmChannel(std::string root = {});
+  ~SysfsPwmChannel();
+
+  SysfsPwmChannel(const SysfsPwmChannel &) = delete;
+  SysfsPwmChannel &operator=(const SysfsPwmChannel &) = delete;
+
+  // Starts enabled with the given period and 0 duty.
+  bool open(int chip, int channel, int64_t periodNs);
+  // Disables the channel; it stays exported.
+  void close();
+  bool isOpen() const { return enableFd_ >= 0; }
+  bool apply(int64_t periodNs, int64_t dutyNs);
+
+  uint64_t writeCount() const { return writes_; }
+
+private:
+  bool writeValue(int fd, int64_t value);
+
+  std::string root_;
+  int periodFd_ = -1;
+  int dutyFd_ = -1;
+  int enableFd_ = -1;
+  int64_t periodNs_ = 0;
+  int64_t dutyNs_ = 0;
+  uint64_t writes_ = 0;
+};
+
+// Lays out <root>/pwmchipN with `channels` already-exported channels (plain
+// files: values land at offset 0, newline-terminated). For tests and dev
+// boxes: point AMUST_PWM_SYSFS at `root`.
+bool createMockPwmSysfs(const std::string &root, int chip, int channels);
+
+// Software PWM for outputs without a PWM channel, confined to the GPIO thread.
+// Each wave starts its phase at set(); the thread asks level() when it
+// drives the outputs and sleeps on timerFd(), armed at the next edge.
+class SoftPwm final {
+public:
+  SoftPwm();
+  ~SoftPwm();
+
+  SoftPwm(const SoftPwm &) = delete;
+  SoftPwm &operator=(const SoftPwm &) = delete;
+
+  int timerFd() const { return timerFd_; }
+
+  void set(PwmOutput output, const PwmSetting &setting, int64_t nowNs);
+  const PwmSetting &setting(PwmOutput output) const;
+  bool level(PwmOutput output, int64_t nowNs) const;
+  // Arms the timer at the next edge of the outputs in `activeMask` (bit per
+  // PwmOutput), or disarms it; returns that edge (0 = none).
+  int64_t arm(uint32_t activeMask, int64_t nowNs);
+  void acknowledgeTimer();
+  int64_t nextEdgeNs() const { return nextEdgeNs_; }
+
+private:
+  struct Wave {
+    PwmSetting setting;
+    int64_t phaseNs = 0;
+  };
+
+  int timerFd_ = -1;
+  Wave waves_[kPwmOutputCount];
+  int64_t nextEdgeNs_ = 0;
+};
@@ -0,0 +1,230 @@
+#include "session_engine.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+constexpr int64_t kNsPerMs = 1'000'000;
+constexpr int64_t kNsPerSecond = 1'000'000'000;
+
+class SteadySessionClock final : public SessionClock {
+public:
+  int64_t nowNs() const override {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+};
+
+} // namespace
+
+const char *deviceStateName(DeviceState state) {
+  switch (state) {
+  case DeviceState::Ready:
+    return "READY";
+  case DeviceState::Running:
+    return "RUNNING";
+  case DeviceState::Paused:
+    return "PAUSE";
+  case DeviceState::Done:
+    return "DONE";
+  }
+  return "?";
+}
+
+const SessionClock &SessionClock::steady() {
+  static const SteadySessionClock clock;
+  return clock;
+}
+
+bool SessionSnapshot::operator==(const SessionSnapshot &other) const {
+  return state == other.state && setDurationMs == other.setDurationMs &&
+         runDurationMs == other.runDurationMs && remainingMs == other.remainingMs &&
+         progressPercent == other.progressPercent;
+}
+
+SessionEngine::SessionEngine(const SessionClock &clock, SessionExposure &exposure)
+    : clock_(clock), exposure_(exposure) {
+  snapshot_ = compute();
+}
+
+void SessionEngine::setChangeCallback(
+    std::function<void(const SessionSnapshot &snapshot)> onChange) {
+  onChange_ = std::move(onChange);
+}
+
+void SessionEngine::setDeadlineCallback(std::function<void(int64_t deadlineNs)> onDeadline) {
+  onDeadline_ = std::move(onDeadline);
+}
+
+void SessionEngine::setErrorCallback(std::function<void(const char *what)> onError) {
+  onError_ = std::move(onError);
+}
+
+bool SessionEngine::start() {
+  if (state_ != DeviceState::Ready)
+    return false;
+  if (!exposure_.start(int64_t{setDurationMs_} * kNsPerMs))
+    return refused("exposure start not queued");
+  runDurationMs_ = setDurationMs_;
+  enter(DeviceState::Running);
+  return true;
+}
+
+bool SessionEngine::pauseOrResume() {
+  if (state_ == DeviceState::Running) {
+    // Keeps the remaining time; the x-ray (and the LEDs with it) goes off.
+    if (!exposure_.pause())
+      return refused("exposure pause not queued");
+    enter(DeviceState::Paused);
+    return true;
+  }
+  if (state_ == DeviceState::Paused) {
+    if (!exposure_.resume())
+      return refused("exposure resume not queued");
+    enter(DeviceState::Running);
+    return true;
+  }
+  return false;
+}
+
+bool SessionEngine::stop() {
+  // Ready has no exposure left to stop; Done normally has none either, but
+  // the outputs must not stay on behind a READY screen if it does.
+  const bool live = state_ == DeviceState::Running || state_ == DeviceState::Paused ||
+                    (state_ == DeviceState::Done && exposure_.isActive());
+  if (live && !exposure_.stop())
+    return refused("exposure stop not queued");
+  reset();
+  return true;
+}
+
+void SessionEngine::reset() {
+  runDurationMs_ = setDurationMs_;
+  enter(DeviceState::Ready);
+}
+
+bool SessionEngine::refused(const char *what) {
+  if (onError_)
+    onError_(what);
+  return false;
+}
+
+void SessionEngine::footswitch() {
+  if (state_ == DeviceState::Ready)
+    start();
+  else if (state_ == DeviceState::Paused)
+    pauseOrResume();
+}
+
+void SessionEngine::exposureEnded(const ExposureReport &report) {
+  // Still queued when this session stopped it and started another.
+  if (report.startSeq != exposure_.startSeq())
+    return;
+  if (report.completed && (state_ == DeviceState::Running || state_ == DeviceState::Paused)) {
+    doneDeliveredNs_ = report.deliveredNs;
+    enter(DeviceState::Done);
+  } else if (report.interlocked && state_ != DeviceState::Ready) {
+    // The exposure side has already ended it; there is nothing to stop.
+    reset();
+  }
+}
+
+bool SessionEngine::adjustSetDuration(int deltaMs) {
+  const int next = std::clamp(setDurationMs_ + deltaMs, AmustConfig::kOutputMinMs,
+                              AmustConfig::kOutputMaxMs);
+  if (next == setDurationMs_)
+    return false;
+  setDurationMs_ = next;
+  if (state_ == DeviceState::Ready)
+    runDurationMs_ = setDurationMs_;
+  publish();
+  return true;
+}
+
+void SessionEngine::advance() {
+  publish();
+}
+
+int64_t SessionEngine::deliveredNs() const {
+  switch (state_) {
+  case DeviceState::Ready:
+    return 0;
+  case DeviceState::Running:
+  case DeviceState::Paused:
+    return exposure_.deliveredNs();
+  case DeviceState::Done:
+    return doneDeliveredNs_;
+  }
+  return 0;
+}
+
+void SessionEngine::enter(DeviceState state) {
+  state_ = state;
+  publish();
+}
+
+void SessionEngine::publish() {
+  const SessionSnapshot next = compute();
+  if (next != snapshot_) {
+    snapshot_ = next;
+    if (onChange_)
+      onChange_(snapshot_);
+  }
+  const int64_t deadlineNs = computeDeadline(clock_.nowNs());
+  if (deadlineNs != deadlineNs_) {
+    deadlineNs_ = deadlineNs;
+    if (onDeadline_)
+      onDeadline_(deadlineNs_);
+  }
+}
+
+SessionSnapshot SessionEngine::compute() const {
+  SessionSnapshot s;
+  s.state = state_;
+  s.setDurationMs = setDurationMs_;
+  s.runDurationMs = runDurationMs_;
+  switch (state_) {
+  case DeviceState::Ready:
+    s.remainingMs = static_cast<int>(runDurationMs_ / 1000 * 1000);
+    s.progressPercent = 0;
+    break;
+  case DeviceState::Running:
+  case DeviceState::Paused: {
+    const int64_t runNs = int64_t{runDurationMs_} * kNsPerMs;
+    const int64_t delivered = exposure_.deliveredNs();
+    const int64_t remainingNs = std::max<int64_t>(0, runNs - delivered);
+    s.remainingMs = static_cast<int>(remainingNs / kNsPerSecond * 1000);
+    s.progressPercent =
+        static_cast<int>(std::min<int64_t>(100, 100 * delivered / std::max<int64_t>(1, runNs)));
+    break;
+  }
+  case DeviceState::Done:
+    s.remainingMs = 0;
+    s.progressPercent = 100;
+    break;
+  }
+  return s;
+}
+
+int64_t SessionEngine::computeDeadline(int64_t nowNs) const {
+  if (state_ != DeviceState::Running)
+    return 0;
+  const int64_t runNs = int64_t{runDurationMs_} * kNsPerMs;
+  const int64_t delivered = exposure_.deliveredNs();
+  // Past the end the hardware's report moves the session on, not time.
+  if (delivered >= runNs)
+    return 0;
+
+  // Delivered time at which the shown seconds next drop...
+  const int64_t secondsLeft = (runNs - delivered) / kNsPerSecond;
+  int64_t next = secondsLeft > 0 ? runNs - secondsLeft * kNsPerSecond + 1 : runNs;
+  // ...or the shown percentage next rises.
+  const int64_t percent = 100 * delivered / runNs;
+  if (percent < 100)
+    next = std::min(next, ((percent + 1) * runNs + 99) / 100);
+  next = std::min(next, runNs);
+  // Delivered time runs with the clock while Running.
+  return nowNs + (next - delivered);
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+#include "amust_config.h"
+#include "exposure_engine.h"
+
+enum class DeviceState { Ready, Running, Paused, Done };
+
+// "READY", "RUNNING", "PAUSE", "DONE" as shown in the top bar.
+const char *deviceStateName(DeviceState state);
+
+// Monotonic time source for SessionEngine. steady() is the real clock (the
+// one GpioOutputThread stamps edges with); tests and the session simulator
+// use ManualSessionClock to fast-forward.
+class SessionClock {
+public:
+  virtual ~SessionClock() = default;
+  virtual int64_t nowNs() const = 0;
+
+  static const SessionClock &steady();
+};
+
+class ManualSessionClock final : public SessionClock {
+public:
+  int64_t nowNs() const override { return nowNs_; }
+  void set(int64_t nowNs) { nowNs_ = nowNs; }
+  void advance(int64_t ns) { nowNs_ += ns; }
+
+private:
+  int64_t nowNs_ = 0;
+};
+
+// Where the session's exposure commands go: GpioOutputThread in the
+// application, a recorder in the simulator. The outcome comes back through
+// SessionEngine::exposureEnded(), and the time shown while it runs is
+// deliveredNs(), as measured where the outputs are driven. Each command
+// returns false when it could not be passed on (a full queue); the session
+// then stays where it was.
+class SessionExposure {
+public:
+  virtual ~SessionExposure() = default;
+  virtual bool start(int64_t durationNs) = 0;
+  virtual bool pause() = 0;
+  virtual bool resume() = 0;
+  virtual bool stop() = 0;
+  // On-time since the last start(); 0 until that start has taken effect.
+  virtual int64_t deliveredNs() const = 0;
+  // Sequence number of the last start() passed on; each ExposureReport
+  // carries the one it ends.
+  virtual uint32_t startSeq() const = 0;
+  // True until the exposure of the last start() has ended where the
+  // outputs are driven.
+  virtual bool isActive() const = 0;
+};
+
+// Everything the UI shows about the session. Time-derived fields are kept
+// at display resolution (whole seconds, whole percent), so two snapshots
+// only differ when the screen would.
+struct SessionSnapshot {
+  DeviceState state = DeviceState::Ready;
+  int setDurationMs = AmustConfig::kOutputDefaultMs;
+  int runDurationMs = AmustConfig::kOutputDefaultMs;
+  int remainingMs = AmustConfig::kOutputDefaultMs; // rounded down to whole seconds
+  int progressPercent = 0;
+
+  bool operator==(const SessionSnapshot &other) const;
+  bool operator!=(const SessionSnapshot &other) const { return !(*this == other); }
+};
+
+// The exposure session state machine, without any UI or timer of its own.
+// Commands (buttons, footswitch) and exposure outcomes move it between
+// states; between them it only changes as time passes while Running, and
+// nextDeadlineNs() says when that will next be visible. The host calls
+// advance() then. The change callback runs only when the snapshot differs
+// from the last one reported; the deadline callback whenever the next
+// deadline moves (0 = none, nothing will change until the next command);
+// the error callback when a command was not passed on to the exposure.
+class SessionEngine final {
+public:
+  SessionEngine(const SessionClock &clock, SessionExposure &exposure);
+
+  void setChangeCallback(std::function<void(const SessionSnapshot &snapshot)> onChange);
+  void setDeadlineCallback(std::function<void(int64_t deadlineNs)> onDeadline);
+  void setErrorCallback(std::function<void(const char *what)> onError);
+
+  // Ready -> Running. False in any other state, or if the exposure did not
+  // take the command.
+  bool start();
+  // Running <-> Paused. False in Ready or Done, or as for start().
+  bool pauseOrResume();
+  // Any state -> Ready, stopping an exposure in progress (in Done too, if
+  // the exposure side still has it active). False, staying put, if the
+  // exposure did not take the stop.
+  bool stop();
+  // START in Ready, RESUME while paused; ignored otherwise.
+  void footswitch();
+  // From the exposure side: completion -> Done, interlock -> Ready. Reports
+  // of an earlier start (read after a stop and a new start) are ignored.
+  void exposureEnded(const ExposureReport &report);
+  // Clamped to kOutputMinMs..kOutputMaxMs; the next start() runs for it.
+  bool adjustSetDuration(int deltaMs);
+
+  // Re-evaluates the time-derived fields; cheap and harmless at any time.
+  void advance();
+
+  const SessionSnapshot &snapshot() const { return snapshot_; }
+  int64_t nextDeadlineNs() const { return deadlineNs_; }
+  // Exposure time delivered so far in this session, as the exposure reports
+  // it (the final report's figure once Done).
+  int64_t deliveredNs() const;
+
+private:
+  void enter(DeviceState state);
+  void reset();
+  bool refused(const char *what);
+  void publish();
+  SessionSnapshot compute() const;
+  int64_t computeDeadline(int64_t nowNs) const;
+
+  const SessionClock &clock_;
+  SessionExposure &exposure_;
+  std::function<void(const SessionSnapshot &snapshot)> onChange_;
+  std::function<void(int64_t deadlineNs)> onDeadline_;
+  std::function<void(const char *what)> onError_;
+
+  DeviceState state_ = DeviceState::Ready;
+  int setDurationMs_ = AmustConfig::kOutputDefaultMs;
+  int runDurationMs_ = AmustConfig::kOutputDefaultMs;
+  int64_t doneDeliveredNs_ = 0; // valid while Done
+
+  SessionSnapshot snapshot_;
+  int64_t deadlineNs_ = 0;
+};
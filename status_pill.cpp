@@ -0,0 +1,88 @@
+#include "status_pill.h"
+
+#include <QFontDatabase>
+#include <QFontMetrics>
+#include <QPainter>
+
+namespace {
+
+struct PillColors {
+  QColor background;
+  QColor border;
+  QColor text;
+};
+
+constexpr int kPillHeight = 34;
+constexpr int kPillPaddingX = 10;
+constexpr qreal kPillRadius = 10.0;
+
+// Indexed by StatusPill::Tone.
+const PillColors &pillColors(StatusPill::Tone tone) {
+  static const PillColors kColors[] = {
+      // Neutral
+      {QColor(255, 255, 255, 26), QColor(255, 255, 255, 31), QColor(255, 255, 255, 219)},
+      // Off
+      {QColor(255, 255, 255, 15), QColor(255, 255, 255, 26), QColor(255, 255, 255, 140)},
+      // Ok
+      {QColor(70, 255, 180, 56), QColor(70, 255, 180, 128), QColor(190, 255, 230, 250)},
+      // Warn
+      {QColor(255, 180, 40, 66), QColor(255, 180, 40, 140), QColor(255, 225, 170, 250)},
+      // Alert
+      {QColor(255, 70, 70, 66), QColor(255, 70, 70, 140), QColor(255, 190, 190, 250)},
+  };
+  return kColors[static_cast<int>(tone)];
+}
+
+const QFont &pillFont() {
+  static const QFont font = [] {
+    QFont f = QFontDatabase::systemFont(QFontDatabase::FixedFont);
+    f.setPixelSize(12);
+    f.setBold(true);
+    return f;
+  }();
+  return font;
+}
+
+} // namespace
+
+StatusPill::StatusPill(QWidget *parent) : QWidget(parent), text_(QStringLiteral("—")) {
+  setFixedHeight(kPillHeight);
+  setSizePolicy(QSizePolicy::Preferred, QSizePolicy::Fixed);
+}
+
+void StatusPill::setState(Tone tone, const QString &text) {
+  if (tone == tone_ && text == text_)
+    return;
+  tone_ = tone;
+  if (text != text_) {
+    text_ = text;
+    updateGeometry();
+  }
+  update();
+}
+
+QSize StatusPill::sizeHint() const {
+  return QSize(QFontMetrics(pillFont()).horizontalAdvance(text_) + 2 * kPillPaddingX + 2,
+               kPillHeight);
+}
+
+QSize StatusPill::minimumSizeHint() const {
+  return sizeHint();
+}
+
+void StatusPill::paintEvent(QPaintEvent *event) {
+  Q_UNUSED(event);
+
+  QPainter p(this);
+  p.setRenderHint(QPainter::Antialiasing, true);
+
+  const PillColors &colors = pillColors(tone_);
+  const QRectF r = QRectF(rect()).adjusted(0.5, 0.5, -0.5, -0.5);
+  p.setPen(QPen(colors.border, 1.0));
+  p.setBrush(colors.background);
+  p.drawRoundedRect(r, kPillRadius, kPillRadius);
+
+  p.setPen(colors.text);
+  p.setFont(pillFont());
+  p.drawText(r.adjusted(kPillPaddingX, 0, -kPillPaddingX, 0), Qt::AlignCenter, text_);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <QString>
+#include <QWidget>
+
+// Rounded status label drawn with a fixed palette per tone, so changing
+// state is an assignment plus a repaint instead of a style sheet reparse.
+class StatusPill final : public QWidget {
+  Q_OBJECT
+
+public:
+  enum class Tone { Neutral, Off, Ok, Warn, Alert };
+
+  explicit StatusPill(QWidget *parent = nullptr);
+
+  // Repaints only if the tone or text differs from what is shown.
+  void setState(Tone tone, const QString &text);
+  Tone tone() const { return tone_; }
+  const QString &text() const { return text_; }
+
+  QSize sizeHint() const override;
+  QSize minimumSizeHint() const override;
+
+protected:
+  void paintEvent(QPaintEvent *event) override;
+
+private:
+  Tone tone_ = Tone::Neutral;
+  QString text_;
+};
@@ -0,0 +1,64 @@
+#include "tof_depth_map_widget.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <QPainter>
+
+#include "amust_config.h"
+
+namespace {
+QColor zoneColor(int distanceMm) {
+  if (distanceMm <= 0)
+    return QColor(255, 255, 255, 31);
+  if (distanceMm < AmustConfig::kTofMinMm)
+    return QColor(255, 70, 70, 140);
+  if (distanceMm > AmustConfig::kTofMaxMm)
+    return QColor(255, 180, 40, 140);
+  return QColor(70, 255, 180, 130);
+}
+} // namespace
+
+TofDepthMapWidget::TofDepthMapWidget(QWidget *parent) : QWidget(parent) {
+  setMinimumHeight(48);
+  // Only a scanning sensor produces maps; stay out of the layout until then.
+  hide();
+}
+
+void TofDepthMapWidget::setDepthMap(const TofDepthMap &map) {
+  if (map.columns == map_.columns && map.rows == map_.rows &&
+      std::memcmp(map.distanceMm, map_.distanceMm, sizeof(map.distanceMm)) == 0)
+    return;
+  map_ = map;
+  setVisible(map_.columns > 0 && map_.rows > 0);
+  update();
+}
+
+void TofDepthMapWidget::paintEvent(QPaintEvent *event) {
+  Q_UNUSED(event);
+  if (map_.columns <= 0 || map_.rows <= 0)
+    return;
+
+  QPainter p(this);
+  p.setRenderHint(QPainter::Antialiasing, true);
+
+  // Square cells, centred in the widget.
+  constexpr qreal kGap = 3.0;
+  const qreal cell = std::min((width() - kGap * (map_.columns - 1)) / map_.columns,
+                              (height() - kGap * (map_.rows - 1)) / map_.rows);
+  if (cell <= 0.0)
+    return;
+  const qreal gridW = cell * map_.columns + kGap * (map_.columns - 1);
+  const qreal gridH = cell * map_.rows + kGap * (map_.rows - 1);
+  const QPointF origin((width() - gridW) * 0.5, (height() - gridH) * 0.5);
+
+  p.setPen(QPen(QColor(255, 255, 255, 26), 1.0));
+  for (int r = 0; r < map_.rows; r++) {
+    for (int c = 0; c < map_.columns; c++) {
+      const QRectF cellRect(origin.x() + c * (cell + kGap), origin.y() + r * (cell + kGap), cell,
+                            cell);
+      p.setBrush(zoneColor(map_.distanceMm[r * map_.columns + c]));
+      p.drawRoundedRect(cellRect.adjusted(0.5, 0.5, -0.5, -0.5), 4.0, 4.0);
+    }
+  }
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <QWidget>
+
+#include "hw/tof_backend.h"
+
+// Coarse ToF depth map from an ROI scan: one cell per zone, coloured like the
+// distance pill (OK / too close / too far; grey where the zone had no target).
+class TofDepthMapWidget final : public QWidget {
+  Q_OBJECT
+
+public:
+  explicit TofDepthMapWidget(QWidget *parent = nullptr);
+
+  void setDepthMap(const TofDepthMap &map);
+
+protected:
+  void paintEvent(QPaintEvent *event) override;
+
+private:
+  TofDepthMap map_;
+};
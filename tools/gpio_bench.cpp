@@ -0,0 +1,615 @@
+// Toggle throughput and per-write latency of each GPIO backend, through the
+// same GpioOutputLines path the application uses.
+//
+//   amust_gpio_bench [--backend sim|gpiod|gpio-sim|expander|all] [--lines 17,27] [--count N]
+//   amust_gpio_bench --check
+//
+// Hardware backends (gpiod, gpio-sim, expander) only run with an explicit --lines so a
+// bench never toggles the X-ray enable line by accident; gpio-sim takes its
+// chip from AMUST_GPIO_CHIP, expander its bus from AMUST_GPIO_EXPANDER_BUS
+// (fake = in-memory expander, which runs without --lines).
+//
+// --check runs headless checks instead and exits non-zero if one fails:
+//   - exposure edges: start/pause/resume/stop through GpioOutputThread on a
+//     simulated chip leave exactly the expected GpioEdgeLog sequence.
+//   - safety inputs: a simulated interlock or e-stop edge ends an exposure
+//     in progress and refuses START while held; prints edge-to-off latency.
+//   - stale report: an exposure completes unread, then STOP and START are
+//     queued back to back; the completion still names the old start, and
+//     the new exposure reports under its own; exposureActive() follows.
+//   - pwm: on a mock /sys/class/pwm tree, SysfsPwmChannel programs a
+//     channel and then writes only the attributes that change; through
+//     GpioOutputThread (AMUST_PWM_CHANNELS) an exposure drives the mapped
+//     channels at their set duty and the unmapped laser in software.
+//   - expander mcp23017/pca9555: on a fake bus, init programs the datasheet
+//     registers, each write is one latch transfer of just the changed
+//     port(s) plus one input-port read, and a pin not following its latch
+//     fails the read-back.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <QByteArray>
+
+#include "amust_config.h"
+#include "gpio_backend.h"
+#include "gpio_chip.h"
+#include "gpio_output_thread.h"
+#include "pwm_output.h"
+#include "hw/gpio_expander.h"
+#include "hw/i2c_transport.h"
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  std::string backend = "all";
+  std::vector<int> lines;
+  int count = 100'000;
+  bool check = false;
+};
+
+bool parseLines(const char *arg, std::vector<int> &out) {
+  out.clear();
+  const char *p = arg;
+  while (*p) {
+    char *end = nullptr;
+    const long v = std::strtol(p, &end, 10);
+    if (end == p || v < 0)
+      return false;
+    out.push_back(static_cast<int>(v));
+    p = *end == ',' ? end + 1 : end;
+  }
+  return !out.empty() && out.size() <= GpioOutputLines::kMaxLines;
+}
+
+bool parseArgs(int argc, char **argv, Options &opt) {
+  for (int i = 1; i < argc; i++) {
+    const bool hasValue = i + 1 < argc;
+    if (!std::strcmp(argv[i], "--backend") && hasValue) {
+      opt.backend = argv[++i];
+    } else if (!std::strcmp(argv[i], "--lines") && hasValue) {
+      if (!parseLines(argv[++i], opt.lines))
+        return false;
+    } else if (!std::strcmp(argv[i], "--count") && hasValue) {
+      opt.count = std::atoi(argv[++i]);
+      if (opt.count <= 0)
+        return false;
+    } else if (!std::strcmp(argv[i], "--check")) {
+      opt.check = true;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+int64_t percentileNs(const std::vector<int64_t> &sorted, double p) {
+  const size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+  return sorted[std::min(index, sorted.size() - 1)];
+}
+
+// `mask` selects the lines flipped on every write: one line, or all of them.
+void runPass(GpioOutputLines &lines, const char *pass, uint32_t mask, int count) {
+  std::vector<int64_t> samples(static_cast<size_t>(count));
+  uint32_t levels = lines.levels();
+  const uint64_t syscallsBefore = lines.syscallCount();
+  int failures = 0;
+
+  const auto begin = Clock::now();
+  for (int i = 0; i < count; i++) {
+    levels ^= mask;
+    const auto t0 = Clock::now();
+    if (!lines.write(levels))
+      failures++;
+    samples[static_cast<size_t>(i)] =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+  }
+  const double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+  lines.write(0);
+
+  std::sort(samples.begin(), samples.end());
+  std::printf("  %-10s %10.0f writes/s  p50 %7.2f us  p99 %7.2f us  max %8.2f us  "
+              "syscalls %llu%s\n",
+              pass, count / seconds, percentileNs(samples, 0.50) / 1e3,
+              percentileNs(samples, 0.99) / 1e3, samples.back() / 1e3,
+              static_cast<unsigned long long>(lines.syscallCount() - syscallsBefore),
+              failures ? "  (write failures)" : "");
+}
+
+bool benchBackend(const std::string &kind, const std::vector<int> &offsets, int count) {
+  std::unique_ptr<GpioBackend> backend = createGpioBackend(kind);
+  if (!backend) {
+    std::printf("%s: unavailable\n", kind.c_str());
+    return false;
+  }
+  const std::string name = backend->name();
+  GpioOutputLines lines(std::move(backend));
+  if (!lines.request(offsets, false, "amust_gpio_bench")) {
+    std::printf("%s: request failed\n", name.c_str());
+    return false;
+  }
+
+  std::printf("%s: %zu line(s), %d writes per pass\n", name.c_str(), offsets.size(), count);
+  runPass(lines, "one-line", 1u, count);
+  if (offsets.size() > 1)
+    runPass(lines, "all-lines", static_cast<uint32_t>((1ull << offsets.size()) - 1), count);
+
+  if (auto *sim = dynamic_cast<SimulatedGpioBackend *>(lines.backend())) {
+    std::printf("  edges recorded %zu, dropped %llu\n", sim->edgeLog().edges().size(),
+                static_cast<unsigned long long>(sim->edgeLog().droppedCount()));
+  }
+  if (auto *expander = dynamic_cast<I2cExpanderGpioBackend *>(lines.backend())) {
+    std::printf("  i2c transactions %llu, read-back failures %llu\n",
+                static_cast<unsigned long long>(expander->expander().transactionCount()),
+                static_cast<unsigned long long>(expander->expander().verifyFailures()));
+  }
+#if defined(AMUST_HAVE_GPIOD)
+  if (auto *sim = dynamic_cast<KernelGpioSimBackend *>(lines.backend()))
+    std::printf("  read-back mismatches %llu\n",
+                static_cast<unsigned long long>(sim->mismatchCount()));
+#endif
+  return true;
+}
+
+bool checkFailed(const char *check, const char *what) {
+  std::printf("%s: FAILED: %s\n", check, what);
+  return false;
+}
+
+// Polls `done` for up to `timeoutMs`; the application waits on notifyFd().
+template <typename Done> bool waitFor(Done done, int timeoutMs = 2'000) {
+  const auto until = Clock::now() + std::chrono::milliseconds(timeoutMs);
+  while (!done()) {
+    if (Clock::now() >= until)
+      return false;
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+  return true;
+}
+
+// The distinct output lines, in the order GpioController requests them.
+std::vector<int> outputLines() {
+  std::vector<int> lines;
+  for (int line : {AmustConfig::kGpioLaserLine, AmustConfig::kGpioLed1Line,
+                   AmustConfig::kGpioLed2Line, AmustConfig::kGpioXrayEnableLine}) {
+    if (line >= 0 && std::find(lines.begin(), lines.end(), line) == lines.end())
+      lines.push_back(line);
+  }
+  return lines;
+}
+
+bool checkExposureEdges() {
+  const char *check = "exposure edges";
+  auto backend = std::make_unique<SimulatedGpioBackend>();
+  const SimulatedGpioBackend *sim = backend.get();
+  GpioOutputThread gpio(std::move(backend));
+  if (!gpio.isInitialized())
+    return checkFailed(check, "no output lines");
+  gpio.start();
+
+  // Every output line moves together: low on request, then high while
+  // exposing and low while not.
+  const std::vector<int> lines = outputLines();
+  std::vector<GpioEdge> expected;
+  auto expect = [&](bool high) {
+    for (int line : lines)
+      expected.push_back({line, high, 0});
+  };
+  auto step = [&](bool queued, bool high) {
+    if (!queued)
+      return false;
+    expect(high);
+    return waitFor([&]() { return sim->edgeLog().edges().size() >= expected.size(); });
+  };
+  expect(false);
+  ExposureReport report;
+  const bool ran = step(gpio.startExposure(int64_t{10} * 1'000'000'000), true) &&
+                   step(gpio.pauseExposure(), false) && step(gpio.resumeExposure(), true) &&
+                   step(gpio.stopExposure(), false) &&
+                   waitFor([&]() { return gpio.takeExposureReport(report); });
+  gpio.stopAndWait();
+  if (!ran)
+    return checkFailed(check, "an edge or the report did not arrive");
+
+  const std::vector<GpioEdge> edges = sim->edgeLog().edges();
+  if (edges.size() != expected.size())
+    return checkFailed(check, "unexpected number of edges");
+  for (size_t i = 0; i < edges.size(); i++) {
+    if (edges[i].offset != expected[i].offset || edges[i].high != expected[i].high)
+      return checkFailed(check, "edge sequence differs");
+    if (i > 0 && edges[i].timestampNs < edges[i - 1].timestampNs)
+      return checkFailed(check, "edge timestamps go backwards");
+  }
+  if (report.completed || report.interlocked || report.segments != 2 || report.deliveredNs <= 0)
+    return checkFailed(check, "report does not describe a stopped two-segment exposure");
+
+  std::printf("%s: ok, %zu edges on %zu line(s), %lld us delivered in %d segments\n", check,
+              edges.size(), lines.size(), static_cast<long long>(report.deliveredNs / 1000),
+              report.segments);
+  return true;
+}
+
+bool checkSafetyInputs() {
+  const char *check = "safety inputs";
+  auto backend = std::make_unique<SimulatedGpioBackend>();
+  const SimulatedGpioBackend *sim = backend.get();
+  GpioOutputThread gpio(std::move(backend));
+  SimulatedGpioInputs *inputs = gpio.simulatedInputs();
+  if (!gpio.isInitialized() || !inputs)
+    return checkFailed(check, "no output lines or simulated inputs");
+  gpio.start();
+
+  const int64_t durationNs = int64_t{10} * 1'000'000'000;
+  auto outputsHigh = [&]() {
+    const std::vector<GpioEdge> edges = sim->edgeLog().edges();
+    return !edges.empty() && edges.back().high;
+  };
+  ExposureReport report;
+  auto takeReport = [&]() { return waitFor([&]() { return gpio.takeExposureReport(report); }); };
+  const char *failure = nullptr;
+  for (GpioInput input : {GpioInput::Interlock, GpioInput::EmergencyStop}) {
+    // The exposure ends on the thread that sees the edge.
+    if (!gpio.startExposure(durationNs) || !waitFor(outputsHigh)) {
+      failure = "exposure did not start";
+      break;
+    }
+    inputs->inject(input, true);
+    if (!takeReport() || !report.interlocked || report.completed || outputsHigh() ||
+        !gpio.safetyTripped()) {
+      failure = "trip did not end the exposure";
+      break;
+    }
+    // START is refused while the input is held, without touching a line.
+    const size_t edgesBefore = sim->edgeLog().edges().size();
+    if (!gpio.startExposure(durationNs) || !takeReport() || !report.interlocked ||
+        report.deliveredNs != 0 || sim->edgeLog().edges().size() != edgesBefore) {
+      failure = "START was not refused while tripped";
+      break;
+    }
+    inputs->inject(input, false);
+    if (!waitFor([&]() { return !gpio.safetyTripped(); })) {
+      failure = "release was not seen";
+      break;
+    }
+  }
+  // Released, exposures run again.
+  if (!failure && (!gpio.startExposure(durationNs) || !waitFor(outputsHigh) ||
+                   !gpio.stopExposure() || !takeReport() || report.interlocked))
+    failure = "exposure refused after release";
+  const GpioLatencyStats latency = gpio.safetyLatency();
+  gpio.stopAndWait();
+  if (failure)
+    return checkFailed(check, failure);
+  if (latency.count != 2)
+    return checkFailed(check, "edge-to-off latency not recorded for each trip");
+
+  std::printf("%s: ok, interlock and e-stop ended the exposure and blocked START; "
+              "edge-to-off p50 %lld us max %lld us\n",
+              check, static_cast<long long>(latency.p50Us), static_cast<long long>(latency.maxUs));
+  return true;
+}
+
+bool checkStaleReport() {
+  const char *check = "stale report";
+  auto backend = std::make_unique<SimulatedGpioBackend>();
+  const SimulatedGpioBackend *sim = backend.get();
+  GpioOutputThread gpio(std::move(backend));
+  if (!gpio.isInitialized())
+    return checkFailed(check, "no output lines");
+  gpio.start();
+
+  auto edgeCount = [&]() { return sim->edgeLog().edges().size(); };
+  auto outputsHigh = [&]() {
+    const std::vector<GpioEdge> edges = sim->edgeLog().edges();
+    return !edges.empty() && edges.back().high;
+  };
+  ExposureReport report;
+  auto takeReport = [&]() { return waitFor([&]() { return gpio.takeExposureReport(report); }); };
+  const char *failure = nullptr;
+  // A short exposure runs out on the thread; its report stays queued while
+  // the GUI, not having read it yet, stops and starts again.
+  if (!gpio.startExposure(1'000'000) || !waitFor(outputsHigh) ||
+      !waitFor([&]() { return !outputsHigh(); }) ||
+      !waitFor([&]() { return !gpio.exposureActive(); })) {
+    failure = "first exposure did not run out";
+  } else {
+    const uint32_t firstStart = gpio.lastStartSeq();
+    const size_t edgesBefore = edgeCount();
+    if (!gpio.stopExposure() || !gpio.startExposure(int64_t{10} * 1'000'000'000) ||
+        !waitFor([&]() { return edgeCount() > edgesBefore && outputsHigh(); })) {
+      failure = "second exposure did not start";
+    } else if (!takeReport() || !report.completed || report.startSeq != firstStart ||
+               report.startSeq == gpio.lastStartSeq()) {
+      failure = "completion does not name the start it ended";
+    } else if (gpio.takeExposureReport(report)) {
+      failure = "STOP of a finished exposure queued a report";
+    } else if (!gpio.exposureActive()) {
+      failure = "running exposure not reported active";
+    } else if (!gpio.stopExposure() || !takeReport() || report.completed ||
+               report.startSeq != gpio.lastStartSeq()) {
+      failure = "second exposure did not report under its own start";
+    }
+  }
+  gpio.stopAndWait();
+  if (failure)
+    return checkFailed(check, failure);
+
+  std::printf("%s: ok, a completion read after STOP+START names the earlier start\n", check);
+  return true;
+}
+
+// Leading number of a sysfs attribute; -1 if unreadable. pwrite() at 0 can
+// leave the tail of a longer old value behind the newline.
+long long readAttribute(const std::string &path) {
+  std::ifstream in(path);
+  long long value = -1;
+  in >> value;
+  return in ? value : -1;
+}
+
+bool checkPwm(const std::string &root);
+
+bool checkPwm() {
+#if defined(__linux__)
+  char dirTemplate[] = "/tmp/amust-pwm-XXXXXX";
+  if (!::mkdtemp(dirTemplate))
+    return checkFailed("pwm", "no temporary directory");
+  const bool ok = checkPwm(dirTemplate);
+  std::error_code ignored;
+  std::filesystem::remove_all(dirTemplate, ignored);
+  return ok;
+#else
+  std::printf("pwm: skipped (needs Linux)\n");
+  return true;
+#endif
+}
+
+bool checkPwm(const std::string &root) {
+  const char *check = "pwm";
+  if (!createMockPwmSysfs(root, 0, 2))
+    return checkFailed(check, "mock sysfs not created");
+  auto attr = [&](int channel, const char *name) {
+    return readAttribute(root + "/pwmchip0/pwm" + std::to_string(channel) + "/" + name);
+  };
+
+  {
+    SysfsPwmChannel channel(root);
+    if (!channel.open(0, 0, 1'000'000) || attr(0, "period") != 1'000'000 ||
+        attr(0, "duty_cycle") != 0 || attr(0, "enable") != 1 || channel.writeCount() != 3)
+      return checkFailed(check, "open did not program duty, period, enable");
+    struct Step {
+      int64_t periodNs;
+      int64_t dutyNs;
+      uint64_t writes;
+    };
+    const Step steps[] = {
+        {1'000'000, 250'000, 1}, // duty only
+        {1'000'000, 250'000, 0}, // unchanged: nothing written
+        {500'000, 400'000, 2},   // period and duty
+        {100'000, 50'000, 2},
+    };
+    for (const Step &step : steps) {
+      const uint64_t before = channel.writeCount();
+      if (!channel.apply(step.periodNs, step.dutyNs) ||
+          channel.writeCount() - before != step.writes || attr(0, "period") != step.periodNs ||
+          attr(0, "duty_cycle") != step.dutyNs)
+        return checkFailed(check, "apply wrote the wrong attributes");
+    }
+    channel.close();
+    if (attr(0, "enable") != 0)
+      return checkFailed(check, "close left the channel enabled");
+  }
+
+  // LED1 and LED2 on channels 0 and 1; the laser, sharing their GPIO line,
+  // is left to software PWM.
+  qputenv("AMUST_PWM_SYSFS", QByteArray(root.c_str()));
+  qputenv("AMUST_PWM_CHANNELS", "led1=0:0,led2=0:1");
+  auto backend = std::make_unique<SimulatedGpioBackend>();
+  const SimulatedGpioBackend *sim = backend.get();
+  GpioOutputThread gpio(std::move(backend));
+  qputenv("AMUST_PWM_CHANNELS", "");
+  if (!gpio.isInitialized() || !gpio.hasHardwarePwm(PwmOutput::Led1) ||
+      !gpio.hasHardwarePwm(PwmOutput::Led2) || gpio.hasHardwarePwm(PwmOutput::Laser))
+    return checkFailed(check, "AMUST_PWM_CHANNELS not applied");
+  gpio.start();
+
+  const int64_t periodNs = int64_t{AmustConfig::kPwmSoftMinPeriodUs} * 2'000;
+  auto laserEdges = [&]() {
+    size_t count = 0;
+    for (const GpioEdge &edge : sim->edgeLog().edges())
+      count += edge.offset == AmustConfig::kGpioLaserLine;
+    return count;
+  };
+  const char *failure = nullptr;
+  ExposureReport report;
+  if (!gpio.setPwm(PwmOutput::Led1, {1'000'000, 250'000}) ||
+      !gpio.setPwm(PwmOutput::Laser, {periodNs, periodNs / 2}) ||
+      !gpio.startExposure(int64_t{10} * 1'000'000'000)) {
+    failure = "commands not queued";
+  } else if (!waitFor([&]() {
+               return attr(0, "duty_cycle") == 250'000 && attr(1, "duty_cycle") == 1'000'000;
+             })) {
+    failure = "exposure did not drive the channels at their duty";
+  } else if (!waitFor([&]() { return laserEdges() >= 8; })) {
+    failure = "laser line not modulated in software";
+  } else if (!gpio.stopExposure() ||
+             !waitFor([&]() { return gpio.takeExposureReport(report); }) ||
+             !waitFor([&]() { return attr(0, "duty_cycle") == 0 && attr(1, "duty_cycle") == 0; })) {
+    failure = "stop did not zero the channels";
+  }
+  const size_t edgesAfterStop = laserEdges();
+  std::this_thread::sleep_for(std::chrono::nanoseconds(periodNs * 3));
+  if (!failure && laserEdges() != edgesAfterStop)
+    failure = "laser line still toggling after stop";
+  gpio.stopAndWait();
+  qputenv("AMUST_PWM_SYSFS", "");
+  if (failure)
+    return checkFailed(check, failure);
+  if (attr(0, "enable") != 0 || attr(1, "enable") != 0)
+    return checkFailed(check, "channels left enabled after shutdown");
+
+  std::printf("%s: ok, minimal sysfs writes; exposure drove 2 channels and a %lld us soft wave\n",
+              check, static_cast<long long>(periodNs / 1000));
+  return true;
+}
+
+// Forwards to a fake bus, recording the register and length of each transfer.
+class RecordingTransport final : public I2cTransport {
+public:
+  struct Transfer {
+    bool write = false;
+    uint16_t reg = 0;
+    size_t len = 0;
+  };
+
+  explicit RecordingTransport(FakeI2cTransport &bus) : bus_(bus) {}
+
+  bool writeRegisters(uint8_t address, uint16_t reg, int indexBytes, const uint8_t *data,
+                      size_t len) override {
+    transfers.push_back({true, reg, len});
+    return bus_.writeRegisters(address, reg, indexBytes, data, len);
+  }
+  bool readRegisters(uint8_t address, uint16_t reg, int indexBytes, uint8_t *out,
+                     size_t len) override {
+    transfers.push_back({false, reg, len});
+    return bus_.readRegisters(address, reg, indexBytes, out, len);
+  }
+
+  std::vector<Transfer> transfers;
+
+private:
+  FakeI2cTransport &bus_;
+};
+
+// Port 0 registers from the datasheets; port 1 follows each at +1.
+struct ExpanderLayout {
+  GpioExpander::Model model;
+  const char *name;
+  uint8_t direction;
+  uint8_t polarity;
+  uint8_t latch;
+  uint8_t input;
+};
+constexpr ExpanderLayout kExpanderLayouts[] = {
+    {GpioExpander::Model::Mcp23017, "mcp23017", 0x00, 0x02, 0x14, 0x12},
+    {GpioExpander::Model::Pca9555, "pca9555", 0x06, 0x04, 0x02, 0x00},
+};
+
+bool checkExpander(const ExpanderLayout &layout) {
+  const std::string name = std::string("expander ") + layout.name;
+  const char *check = name.c_str();
+  constexpr uint8_t kAddress = 0x20;
+  FakeI2cTransport bus;
+  installFakeGpioExpander(bus, kAddress, layout.model);
+  RecordingTransport transport(bus);
+  GpioExpander expander(transport, layout.model, kAddress);
+  auto reg = [&](uint8_t base, int port) {
+    return bus.peek(kAddress, static_cast<uint16_t>(base + port));
+  };
+
+  // Pins 0..3 (port 0) and 9 (port 1) are outputs, starting low.
+  if (!expander.init(0x020F, 0))
+    return checkFailed(check, "init failed");
+  if (reg(layout.direction, 0) != 0xF0 || reg(layout.direction, 1) != 0xFD ||
+      reg(layout.polarity, 0) != 0 || reg(layout.polarity, 1) != 0 || reg(layout.latch, 0) != 0 ||
+      reg(layout.latch, 1) != 0)
+    return checkFailed(check, "init left the wrong register contents");
+
+  struct Step {
+    uint16_t levels;
+    uint16_t changed;
+    int firstPort;
+    int portCount;
+  };
+  const Step steps[] = {
+      {0x0001, 0x0001, 0, 1}, // port 0 only
+      {0x0201, 0x0200, 1, 1}, // port 1 only
+      {0x0008, 0x0209, 0, 2}, // both
+  };
+  for (const Step &step : steps) {
+    transport.transfers.clear();
+    if (!expander.writeOutputs(step.levels, step.changed, true))
+      return checkFailed(check, "write or read-back failed");
+    const std::vector<RecordingTransport::Transfer> &t = transport.transfers;
+    const auto count = static_cast<size_t>(step.portCount);
+    if (t.size() != 2 || !t[0].write || t[0].reg != layout.latch + step.firstPort ||
+        t[0].len != count || t[1].write || t[1].reg != layout.input + step.firstPort ||
+        t[1].len != count)
+      return checkFailed(check, "not one latch write and one input read of the changed ports");
+    if (reg(layout.latch, 0) != (step.levels & 0xFF) || reg(layout.latch, 1) != step.levels >> 8)
+      return checkFailed(check, "latch does not hold the levels");
+  }
+
+  // Pin 9 stops following its latch (here: back to an input reading low).
+  // The latch alone would still read back high.
+  bus.poke(kAddress, static_cast<uint16_t>(layout.direction + 1), 0xFF);
+  if (expander.writeOutputs(0x0208, 0x0200, true) || expander.verifyFailures() != 1)
+    return checkFailed(check, "a pin stuck low passed the read-back");
+
+  std::printf("%s: ok, register layout, per-port transfers and pin read-back\n", check);
+  return true;
+}
+
+bool runChecks() {
+  // Deasserted simulated inputs, whatever the host has wired.
+  qputenv("AMUST_GPIO_INPUTS", "sim");
+  bool ok = true;
+  ok = checkExposureEdges() && ok;
+  ok = checkSafetyInputs() && ok;
+  ok = checkStaleReport() && ok;
+  ok = checkPwm() && ok;
+  for (const ExpanderLayout &layout : kExpanderLayouts)
+    ok = checkExpander(layout) && ok;
+  return ok;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  Options opt;
+  if (!parseArgs(argc, argv, opt)) {
+    std::fprintf(stderr, "usage: %s [--backend sim|gpiod|gpio-sim|expander|all] [--lines 17,27] "
+                         "[--count N] | --check\n",
+                 argv[0]);
+    return 2;
+  }
+  if (opt.check)
+    return runChecks() ? 0 : 1;
+
+  const bool explicitLines = !opt.lines.empty();
+  const std::vector<int> simLines = explicitLines ? opt.lines : std::vector<int>{0, 1, 2, 3};
+  std::vector<std::string> kinds;
+  if (opt.backend == "all")
+    kinds = {"sim", "gpiod", "gpio-sim", "expander"};
+  else
+    kinds = {opt.backend};
+
+  bool ok = true;
+  for (const std::string &kind : kinds) {
+    const bool fakeExpander =
+        kind == "expander" && qgetenv("AMUST_GPIO_EXPANDER_BUS").toLower() == "fake";
+    if (kind != "sim" && !fakeExpander && !explicitLines) {
+      if (opt.backend != "all")
+        ok = false;
+      std::printf("%s: skipped (needs --lines)\n", kind.c_str());
+      continue;
+    }
+    const bool ran = benchBackend(kind, simLines, opt.count);
+    if (opt.backend != "all")
+      ok = ok && ran;
+  }
+  return ok ? 0 : 1;
+}
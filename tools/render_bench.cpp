@@ -0,0 +1,392 @@
+// Paint cost and pixel output of the UI, headless (QT_QPA_PLATFORM=offscreen
+// unless set). BootScreenWidget and MainMenuWidget are shown at 1024x600
+// with their clocks frozen and the menu driven through every DeviceState,
+// every ToF status and both safety trips; a menu-sized ProgressPill is
+// shown empty, part-filled and full. Each scene is repainted N times and
+// the per-frame paint time (whole widget tree, synchronous repaint())
+// reported as percentiles, the first frame separately.
+//
+//   amust_render_bench [--frames N] [--dpr 1,2] [--golden DIR [--record]]
+//                      [--tolerance T] [--out DIR] [--verbose]
+//
+// --golden compares each scene with DIR/<scene>@<dpr>x.png, allowing a
+// per-channel difference of T (default 0); --record writes the goldens
+// instead. --out saves every rendered scene. Text rendering depends on the
+// installed fonts, so goldens are recorded on the image they are checked
+// on. Each device pixel ratio runs in its own process (QT_SCALE_FACTOR is
+// only read at start-up). Exits non-zero when a scene differs from its
+// golden or has none.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <QApplication>
+#include <QDir>
+#include <QImage>
+#include <QPixmap>
+
+#include "amust_config.h"
+#include "boot_screen_widget.h"
+#include "main_menu_widget.h"
+#include "progress_pill.h"
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+constexpr int kScreenW = 1024;
+constexpr int kScreenH = 600;
+
+struct Options {
+  int frames = 200;
+  std::vector<double> dprs{1.0};
+  const char *dprArg = nullptr;
+  std::string golden;
+  bool record = false;
+  int tolerance = 0;
+  std::string out;
+  bool verbose = false;
+};
+
+bool parseDprs(const char *arg, std::vector<double> &out) {
+  out.clear();
+  const char *p = arg;
+  while (*p) {
+    char *end = nullptr;
+    const double v = std::strtod(p, &end);
+    if (end == p || v <= 0.0 || v > 4.0)
+      return false;
+    out.push_back(v);
+    p = *end == ',' ? end + 1 : end;
+  }
+  return !out.empty();
+}
+
+bool parseArgs(int argc, char **argv, Options &opt) {
+  for (int i = 1; i < argc; i++) {
+    const bool hasValue = i + 1 < argc;
+    if (!std::strcmp(argv[i], "--frames") && hasValue) {
+      opt.frames = std::atoi(argv[++i]);
+      if (opt.frames <= 0)
+        return false;
+    } else if (!std::strcmp(argv[i], "--dpr") && hasValue) {
+      opt.dprArg = argv[++i];
+      if (!parseDprs(opt.dprArg, opt.dprs))
+        return false;
+    } else if (!std::strcmp(argv[i], "--golden") && hasValue) {
+      opt.golden = argv[++i];
+    } else if (!std::strcmp(argv[i], "--record")) {
+      opt.record = true;
+    } else if (!std::strcmp(argv[i], "--tolerance") && hasValue) {
+      opt.tolerance = std::atoi(argv[++i]);
+      if (opt.tolerance < 0)
+        return false;
+    } else if (!std::strcmp(argv[i], "--out") && hasValue) {
+      opt.out = argv[++i];
+    } else if (!std::strcmp(argv[i], "--verbose")) {
+      opt.verbose = true;
+    } else {
+      return false;
+    }
+  }
+  return !opt.record || !opt.golden.empty();
+}
+
+// Re-runs this binary once per DPR with the same arguments but that DPR.
+int runPerDpr(int argc, char **argv, const Options &opt) {
+  int status = 0;
+  for (double dpr : opt.dprs) {
+    char dprText[16];
+    std::snprintf(dprText, sizeof dprText, "%g", dpr);
+    std::vector<char *> args(argv, argv + argc);
+    for (size_t i = 0; i < args.size(); i++) {
+      if (args[i] == opt.dprArg)
+        args[i] = dprText;
+    }
+    args.push_back(nullptr);
+
+    std::fflush(stdout);
+    const pid_t pid = ::fork();
+    if (pid < 0) {
+      std::perror("fork");
+      return 1;
+    }
+    if (pid == 0) {
+      ::execvp(args[0], args.data());
+      std::perror("execvp");
+      ::_exit(127);
+    }
+    int wstatus = 0;
+    if (::waitpid(pid, &wstatus, 0) < 0 || !WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != 0)
+      status = 1;
+  }
+  return status;
+}
+
+int64_t percentileNs(const std::vector<int64_t> &sorted, double p) {
+  const size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+  return sorted[std::min(index, sorted.size() - 1)];
+}
+
+struct Scene {
+  std::string name;
+  QWidget *widget = nullptr;
+  std::function<void()> show; // puts the widget into the scene's state
+};
+
+// Largest per-channel difference and how many pixels exceed `tolerance`;
+// false if the sizes differ.
+bool compareImages(const QImage &actual, const QImage &golden, int tolerance, int64_t &pixels,
+                   int &maxDelta) {
+  pixels = 0;
+  maxDelta = 0;
+  if (actual.size() != golden.size())
+    return false;
+  const QImage a = actual.convertToFormat(QImage::Format_ARGB32);
+  const QImage g = golden.convertToFormat(QImage::Format_ARGB32);
+  for (int y = 0; y < a.height(); y++) {
+    const auto *ra = reinterpret_cast<const QRgb *>(a.constScanLine(y));
+    const auto *rg = reinterpret_cast<const QRgb *>(g.constScanLine(y));
+    for (int x = 0; x < a.width(); x++) {
+      if (ra[x] == rg[x])
+        continue;
+      const int delta = std::max({std::abs(qRed(ra[x]) - qRed(rg[x])),
+                                  std::abs(qGreen(ra[x]) - qGreen(rg[x])),
+                                  std::abs(qBlue(ra[x]) - qBlue(rg[x])),
+                                  std::abs(qAlpha(ra[x]) - qAlpha(rg[x]))});
+      maxDelta = std::max(maxDelta, delta);
+      if (delta > tolerance)
+        pixels++;
+    }
+  }
+  return true;
+}
+
+// Result is "-" (no --golden), "ok", "recorded", or why the frame does not
+// match, in which case it returns false.
+bool checkGolden(const Options &opt, const QString &file, const QImage &frame,
+                 std::string &result) {
+  if (opt.golden.empty()) {
+    result = "-";
+    return true;
+  }
+  const QString path = QDir(QString::fromStdString(opt.golden)).filePath(file);
+  if (opt.record) {
+    const bool saved = frame.save(path, "PNG");
+    result = saved ? "recorded" : "write failed";
+    return saved;
+  }
+  const QImage golden(path);
+  if (golden.isNull()) {
+    result = "missing";
+    return false;
+  }
+  int64_t pixels = 0;
+  int maxDelta = 0;
+  if (!compareImages(frame, golden, opt.tolerance, pixels, maxDelta)) {
+    result = "size mismatch";
+    return false;
+  }
+  if (pixels == 0) {
+    result = "ok";
+    return true;
+  }
+  char text[64];
+  std::snprintf(text, sizeof text, "%lld px differ (max %d)", static_cast<long long>(pixels),
+                maxDelta);
+  result = text;
+  return false;
+}
+
+bool runScene(const Options &opt, double dpr, const Scene &scene) {
+  scene.show();
+  // Layout requests and pending updates from the state change; the frames
+  // below only measure painting.
+  QApplication::processEvents();
+
+  std::vector<int64_t> samples(static_cast<size_t>(opt.frames));
+  for (int i = 0; i < opt.frames; i++) {
+    const auto t0 = Clock::now();
+    scene.widget->repaint();
+    samples[static_cast<size_t>(i)] =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+  }
+  const int64_t firstNs = samples.front();
+  std::vector<int64_t> rest(samples.begin() + (samples.size() > 1 ? 1 : 0), samples.end());
+  std::sort(rest.begin(), rest.end());
+
+  const QImage frame = scene.widget->grab().toImage();
+  char dprText[16];
+  std::snprintf(dprText, sizeof dprText, "%g", dpr);
+  const QString file = QString::fromStdString(scene.name) + "@" + dprText + "x.png";
+  if (!opt.out.empty())
+    frame.save(QDir(QString::fromStdString(opt.out)).filePath(file), "PNG");
+  std::string result;
+  const bool ok = checkGolden(opt, file, frame, result);
+
+  std::printf("  %-26s first %7.2f ms  p50 %6.2f  p90 %6.2f  p99 %6.2f  max %6.2f ms  "
+              "golden %s\n",
+              scene.name.c_str(), firstNs / 1e6, percentileNs(rest, 0.50) / 1e6,
+              percentileNs(rest, 0.90) / 1e6, percentileNs(rest, 0.99) / 1e6, rest.back() / 1e6,
+              result.c_str());
+  return ok;
+}
+
+SessionSnapshot sessionIn(DeviceState state) {
+  SessionSnapshot s;
+  s.state = state;
+  s.setDurationMs = 120'000;
+  s.runDurationMs = 120'000;
+  switch (state) {
+  case DeviceState::Ready:
+    s.remainingMs = s.setDurationMs;
+    break;
+  case DeviceState::Running:
+  case DeviceState::Paused:
+    s.remainingMs = 75'000;
+    s.progressPercent = 37;
+    break;
+  case DeviceState::Done:
+    s.remainingMs = 0;
+    s.progressPercent = 100;
+    break;
+  }
+  return s;
+}
+
+MainMenuStill tofOk(DeviceState state) {
+  MainMenuStill still;
+  still.session = sessionIn(state);
+  still.tofState = TofSensorState::Running;
+  still.tofZone = TofZone::Ok;
+  still.tofDistanceMm = (AmustConfig::kTofMinMm + AmustConfig::kTofMaxMm) / 2;
+  return still;
+}
+
+std::vector<Scene> buildScenes(BootScreenWidget &boot, MainMenuWidget &menu, ProgressPill &pill) {
+  std::vector<Scene> scenes;
+  scenes.push_back({"boot", &boot, [&boot]() { boot.showStill(QStringLiteral("12:00"), 0.0); }});
+
+  auto addMenu = [&](const char *name, const MainMenuStill &still) {
+    scenes.push_back({name, &menu, [&menu, still]() { menu.showStill(still); }});
+  };
+  addMenu("menu-ready", tofOk(DeviceState::Ready));
+  addMenu("menu-running", tofOk(DeviceState::Running));
+  addMenu("menu-paused", tofOk(DeviceState::Paused));
+  addMenu("menu-done", tofOk(DeviceState::Done));
+
+  MainMenuStill still = tofOk(DeviceState::Ready);
+  still.interlockOpen = true;
+  addMenu("menu-interlock-open", still);
+  still = tofOk(DeviceState::Running);
+  still.emergencyStop = true;
+  addMenu("menu-estop", still);
+
+  still = tofOk(DeviceState::Ready);
+  still.tofZone = TofZone::NoTarget;
+  still.tofDistanceMm = -1;
+  const struct {
+    TofSensorState state;
+    const char *name;
+  } kSensorStates[] = {
+      {TofSensorState::Stopped, "menu-tof-not-detected"},
+      {TofSensorState::Starting, "menu-tof-starting"},
+      {TofSensorState::Restarting, "menu-tof-restarting"},
+      {TofSensorState::Running, "menu-tof-no-target"},
+  };
+  for (const auto &s : kSensorStates) {
+    still.tofState = s.state;
+    addMenu(s.name, still);
+  }
+  still = tofOk(DeviceState::Ready);
+  still.tofZone = TofZone::TooClose;
+  still.tofDistanceMm = AmustConfig::kTofMinMm - 30;
+  addMenu("menu-tof-too-close", still);
+  still.tofZone = TofZone::TooFar;
+  still.tofDistanceMm = AmustConfig::kTofMaxMm + 60;
+  addMenu("menu-tof-too-far", still);
+  still = tofOk(DeviceState::Ready);
+  still.tofTiltDeg = AmustConfig::kTofMaxTiltDeg + 3.0;
+  addMenu("menu-tof-tilted", still);
+  still.tofTiltDeg = AmustConfig::kTofMaxTiltDeg - 2.0;
+  addMenu("menu-tof-level", still);
+
+  for (int permille : {0, 374, 1000}) {
+    scenes.push_back({"pill-" + std::to_string(permille), &pill,
+                      [&pill, permille]() { pill.setProgress(permille); }});
+  }
+  return scenes;
+}
+
+bool gVerbose = false;
+
+// The widgets' PaintTimer and FrameScheduler reports would interleave with
+// the table; only warnings and worse get through unless --verbose.
+void quietMessages(QtMsgType type, const QMessageLogContext &, const QString &msg) {
+  if (!gVerbose && (type == QtDebugMsg || type == QtInfoMsg))
+    return;
+  std::fprintf(stderr, "%s\n", qPrintable(msg));
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options opt;
+  if (!parseArgs(argc, argv, opt)) {
+    std::fprintf(stderr,
+                 "usage: %s [--frames N] [--dpr 1,2] [--golden DIR [--record]] [--tolerance T] "
+                 "[--out DIR] [--verbose]\n",
+                 argv[0]);
+    return 2;
+  }
+  if (opt.dprs.size() > 1)
+    return runPerDpr(argc, argv, opt);
+
+  const double dpr = opt.dprs.front();
+  char scale[16];
+  std::snprintf(scale, sizeof scale, "%g", dpr);
+  qputenv("QT_SCALE_FACTOR", scale);
+  if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  // No hardware: simulated outputs, no inputs, no ToF sensor.
+  if (qEnvironmentVariableIsEmpty("AMUST_GPIO_BACKEND"))
+    qputenv("AMUST_GPIO_BACKEND", "sim");
+  if (qEnvironmentVariableIsEmpty("AMUST_GPIO_INPUTS"))
+    qputenv("AMUST_GPIO_INPUTS", "off");
+  qputenv("AMUST_ENABLE_TOF", "0");
+  gVerbose = opt.verbose;
+  qInstallMessageHandler(quietMessages);
+
+  QApplication app(argc, argv);
+  for (const std::string &dir : {opt.golden, opt.out}) {
+    if (!dir.empty())
+      QDir().mkpath(QString::fromStdString(dir));
+  }
+
+  BootScreenWidget boot;
+  MainMenuWidget menu;
+  ProgressPill pill;
+  boot.resize(kScreenW, kScreenH);
+  menu.resize(kScreenW, kScreenH);
+  pill.resize(620, 30);
+  for (QWidget *w : {static_cast<QWidget *>(&boot), static_cast<QWidget *>(&menu),
+                     static_cast<QWidget *>(&pill)})
+    w->show();
+  QApplication::processEvents();
+
+  std::printf("render bench: %s, %dx%d at dpr %g (widget reports %g), %d frames per scene\n",
+              qPrintable(QApplication::platformName()), kScreenW, kScreenH, dpr,
+              menu.devicePixelRatioF(), opt.frames);
+  bool ok = true;
+  for (const Scene &scene : buildScenes(boot, menu, pill))
+    ok = runScene(opt, dpr, scene) && ok;
+  return ok ? 0 : 1;
+}
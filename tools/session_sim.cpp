@@ -0,0 +1,423 @@
+// Runs exposure sessions through SessionEngine on a simulated clock, as fast
+// as the host allows, with random pauses, resumes, stops and interlock trips
+// at random times (some commands refused, as by a full GPIO queue), and
+// checks after every step that:
+//   - each wakeup at nextDeadlineNs() shows a change (no wasted ticks),
+//   - the shown remaining time and progress match the exposure actually
+//     delivered, and never move backwards within a session,
+//   - a completed session delivered exactly the requested time,
+//   - a refused command leaves the session where it was,
+//   - a completion read only after STOP and a new START (both in one GUI
+//     event-loop pass) leaves the new session running,
+//   - a successful STOP leaves no exposure active.
+// Then it ticks one long session in 1 ms steps the way MainMenuWidget does
+// (advance, rebuild the MainMenuView on change, diff it) and checks that no
+// tick allocates.
+//
+//   amust_session_sim [--sessions N] [--seed S] [--verbose]
+//
+// Exits non-zero on the first failed check.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+
+#include "main_menu_view.h"
+#include "session_engine.h"
+
+// Every allocation in the process, for the steady-state check.
+namespace {
+std::atomic<long> gAllocations{0};
+} // namespace
+
+void *operator new(std::size_t size) {
+  gAllocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept {
+  std::free(p);
+}
+void operator delete(void *p, std::size_t) noexcept {
+  std::free(p);
+}
+
+namespace {
+
+constexpr int64_t kNsPerMs = 1'000'000;
+constexpr int64_t kNsPerSecond = 1'000'000'000;
+
+struct Options {
+  long sessions = 10'000;
+  unsigned seed = 1;
+  bool verbose = false;
+};
+
+bool parseArgs(int argc, char **argv, Options &opt) {
+  for (int i = 1; i < argc; i++) {
+    const bool hasValue = i + 1 < argc;
+    if (!std::strcmp(argv[i], "--sessions") && hasValue) {
+      opt.sessions = std::atol(argv[++i]);
+      if (opt.sessions <= 0)
+        return false;
+    } else if (!std::strcmp(argv[i], "--seed") && hasValue) {
+      opt.seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (!std::strcmp(argv[i], "--verbose")) {
+      opt.verbose = true;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Stands in for GpioOutputThread: on-time accounted on the same clock, and
+// a deadline at which the exposure completes on its own.
+class SimulatedExposure final : public SessionExposure {
+public:
+  explicit SimulatedExposure(const ManualSessionClock &clock) : clock_(clock) {}
+
+  bool start(int64_t durationNs) override {
+    if (takeRefusal())
+      return false;
+    active_ = true;
+    startSeq_++;
+    requestedNs_ = durationNs;
+    deliveredNs_ = 0;
+    onSinceNs_ = clock_.nowNs();
+    exposing_ = true;
+    segments_ = 1;
+    return true;
+  }
+  bool pause() override {
+    if (takeRefusal())
+      return false;
+    if (exposing_) {
+      deliveredNs_ += clock_.nowNs() - onSinceNs_;
+      exposing_ = false;
+    }
+    return true;
+  }
+  bool resume() override {
+    if (takeRefusal())
+      return false;
+    if (active_ && !exposing_) {
+      onSinceNs_ = clock_.nowNs();
+      exposing_ = true;
+      segments_++;
+    }
+    return true;
+  }
+  bool stop() override {
+    if (takeRefusal())
+      return false;
+    if (active_)
+      finish(false);
+    return true;
+  }
+
+  // The next command is refused, as a full GPIO command queue would.
+  void refuseNext(bool refuse) { refuseNext_ = refuse; }
+
+  bool exposing() const { return exposing_; }
+  int64_t deadlineNs() const { return onSinceNs_ + (requestedNs_ - deliveredNs_); }
+  int64_t deliveredNs() const override {
+    return deliveredNs_ + (exposing_ ? clock_.nowNs() - onSinceNs_ : 0);
+  }
+  uint32_t startSeq() const override { return startSeq_; }
+  bool isActive() const override { return active_; }
+
+  ExposureReport finish(bool completed) {
+    ExposureReport report;
+    report.requestedNs = requestedNs_;
+    report.deliveredNs = deliveredNs();
+    report.errorNs = report.deliveredNs - requestedNs_;
+    report.segments = segments_;
+    report.completed = completed;
+    report.startSeq = startSeq_;
+    active_ = false;
+    exposing_ = false;
+    deliveredNs_ = report.deliveredNs;
+    return report;
+  }
+
+private:
+  const ManualSessionClock &clock_;
+  bool active_ = false;
+  bool exposing_ = false;
+  uint32_t startSeq_ = 0;
+  int64_t requestedNs_ = 0;
+  int64_t deliveredNs_ = 0;
+  int64_t onSinceNs_ = 0;
+  int segments_ = 0;
+  bool refuseNext_ = false;
+
+  bool takeRefusal() {
+    const bool refuse = refuseNext_;
+    refuseNext_ = false;
+    return refuse;
+  }
+};
+
+struct Totals {
+  long completed = 0;
+  long stopped = 0;
+  long interlocked = 0;
+  long wakeups = 0;
+  long changes = 0;
+  long actions = 0;
+  long refused = 0;
+  long stale = 0;
+};
+
+class Simulator {
+public:
+  explicit Simulator(const Options &opt)
+      : opt_(opt), rng_(opt.seed), exposure_(clock_), engine_(clock_, exposure_) {
+    engine_.setChangeCallback([this](const SessionSnapshot &snapshot) { onChange(snapshot); });
+    engine_.setErrorCallback([this](const char *) { refused_++; });
+  }
+
+  bool run(Totals &totals) {
+    for (long i = 0; i < opt_.sessions; i++) {
+      session_ = i;
+      if (!runSession(totals))
+        return false;
+    }
+    totals.refused = refused_;
+    return true;
+  }
+
+private:
+  bool fail(const char *what) {
+    std::fprintf(stderr, "session %ld at t=%lld ns: %s\n", session_,
+                 static_cast<long long>(clock_.nowNs()), what);
+    failed_ = true;
+    return false;
+  }
+
+  void onChange(const SessionSnapshot &s) {
+    changes_++;
+    if (s.state != DeviceState::Running && s.state != DeviceState::Paused)
+      return;
+    // The display is taken from the exposure, so it must match exactly.
+    const int64_t runNs = int64_t{s.runDurationMs} * kNsPerMs;
+    const int64_t delivered = exposure_.deliveredNs();
+    const int64_t remainingNs = std::max<int64_t>(0, runNs - delivered);
+    if (s.remainingMs != remainingNs / kNsPerSecond * 1000)
+      fail("remaining time does not match the exposure");
+    if (s.progressPercent != std::min<int64_t>(100, 100 * delivered / runNs))
+      fail("progress does not match the exposure");
+    if (s.remainingMs > lastRemainingMs_ || s.progressPercent < lastProgress_)
+      fail("display moved backwards");
+    lastRemainingMs_ = s.remainingMs;
+    lastProgress_ = s.progressPercent;
+  }
+
+  bool runSession(Totals &totals) {
+    std::uniform_int_distribution<int> steps(-60, 60);
+    engine_.adjustSetDuration(steps(rng_) * 10'000);
+    lastRemainingMs_ = engine_.snapshot().setDurationMs;
+    lastProgress_ = 0;
+
+    if (refusal_(rng_)) {
+      exposure_.refuseNext(true);
+      if (engine_.start() || engine_.snapshot().state != DeviceState::Ready ||
+          exposure_.exposing())
+        return fail("refused start left Ready");
+    }
+
+    std::bernoulli_distribution viaFootswitch(0.5);
+    if (viaFootswitch(rng_))
+      engine_.footswitch();
+    else if (!engine_.start())
+      return fail("start refused in Ready");
+    if (engine_.snapshot().state != DeviceState::Running)
+      return fail("not running after start");
+
+    // Mean gap between operator actions, relative to the session length.
+    const int64_t runNs = int64_t{engine_.snapshot().runDurationMs} * kNsPerMs;
+    std::exponential_distribution<double> actionGap(3.0 / static_cast<double>(runNs));
+    std::uniform_int_distribution<int> actionKind(0, 99);
+    int64_t actionAtNs = clock_.nowNs() + static_cast<int64_t>(actionGap(rng_)) + 1;
+
+    while (engine_.snapshot().state == DeviceState::Running ||
+           engine_.snapshot().state == DeviceState::Paused) {
+      int64_t next = actionAtNs;
+      const int64_t deadline = engine_.nextDeadlineNs();
+      if (deadline != 0)
+        next = std::min(next, deadline);
+      if (exposure_.exposing())
+        next = std::min(next, exposure_.deadlineNs());
+      if (next < clock_.nowNs())
+        return fail("deadline in the past");
+      clock_.set(next);
+
+      if (exposure_.exposing() && next == exposure_.deadlineNs()) {
+        // The hardware side ends the exposure first, as GpioOutputThread does.
+        const ExposureReport report = exposure_.finish(true);
+        if (report.errorNs != 0)
+          return fail("completed exposure delivered the wrong time");
+        if (stale_(rng_)) {
+          // STOP and START land before the report is read: it is stale.
+          if (!engine_.stop() || exposure_.isActive())
+            return fail("stop before a stale report failed");
+          lastRemainingMs_ = engine_.snapshot().setDurationMs;
+          lastProgress_ = 0;
+          if (!engine_.start())
+            return fail("start before a stale report failed");
+          engine_.exposureEnded(report);
+          if (engine_.snapshot().state != DeviceState::Running || !exposure_.exposing() ||
+              engine_.deliveredNs() != 0)
+            return fail("stale report moved the new session");
+          totals.stale++;
+          continue;
+        }
+        engine_.exposureEnded(report);
+        if (engine_.deliveredNs() != report.deliveredNs)
+          return fail("session and exposure disagree on delivered time");
+        totals.completed++;
+      } else if (next == actionAtNs) {
+        totals.actions++;
+        const int kind = actionKind(rng_);
+        // Now and then the command meets a full queue: nothing may move.
+        const bool refuse = refusal_(rng_) && kind < 96;
+        exposure_.refuseNext(refuse);
+        const DeviceState stateBefore = engine_.snapshot().state;
+        const bool exposingBefore = exposure_.exposing();
+        const long refusedBefore = refused_;
+        if (kind < 80) {
+          engine_.pauseOrResume();
+        } else if (kind < 90) {
+          engine_.footswitch();
+        } else if (kind < 96) {
+          if (engine_.stop()) {
+            if (exposure_.isActive())
+              return fail("stop left the exposure active");
+            totals.stopped++;
+          }
+        } else {
+          ExposureReport report = exposure_.finish(false);
+          report.interlocked = true;
+          engine_.exposureEnded(report);
+          totals.interlocked++;
+        }
+        exposure_.refuseNext(false);
+        if (refused_ != refusedBefore &&
+            (engine_.snapshot().state != stateBefore || exposure_.exposing() != exposingBefore))
+          return fail("refused command moved the session");
+        if (refuse && engine_.snapshot().state != stateBefore)
+          return fail("state changed although the command was refused");
+        actionAtNs = clock_.nowNs() + static_cast<int64_t>(actionGap(rng_)) + 1;
+      } else {
+        const long before = changes_;
+        engine_.advance();
+        totals.wakeups++;
+        if (changes_ == before)
+          return fail("deadline wakeup changed nothing");
+      }
+      if (failed_)
+        return false;
+    }
+
+    if (engine_.snapshot().state == DeviceState::Done) {
+      if (engine_.snapshot().remainingMs != 0 || engine_.snapshot().progressPercent != 100)
+        return fail("done without full progress");
+      if (engine_.nextDeadlineNs() != 0)
+        return fail("deadline armed after the session ended");
+      engine_.stop();
+    }
+    if (exposure_.isActive())
+      return fail("exposure still active after the session");
+    if (engine_.snapshot().state != DeviceState::Ready || engine_.nextDeadlineNs() != 0)
+      return fail("not idle in Ready after the session");
+    totals.changes = changes_;
+    if (opt_.verbose)
+      std::printf("session %ld: run %d ms, %ld changes so far\n", session_,
+                  engine_.snapshot().runDurationMs, changes_);
+    return !failed_;
+  }
+
+  const Options &opt_;
+  std::mt19937 rng_;
+  ManualSessionClock clock_;
+  SimulatedExposure exposure_;
+  SessionEngine engine_;
+  std::bernoulli_distribution refusal_{0.05};
+  std::bernoulli_distribution stale_{0.05};
+  long session_ = 0;
+  long changes_ = 0;
+  long refused_ = 0;
+  int lastRemainingMs_ = 0;
+  int lastProgress_ = 0;
+  bool failed_ = false;
+};
+
+// A 10-minute session ticked every millisecond: nearly every tick changes
+// nothing, and none of them, changed or not, may allocate.
+bool checkSteadyState() {
+  constexpr long kTicks = 600'000;
+  ManualSessionClock clock;
+  SimulatedExposure exposure(clock);
+  SessionEngine engine(clock, exposure);
+  MainMenuView view = MainMenuView::from(engine.snapshot(), false, false);
+  long viewChanges = 0;
+  engine.setChangeCallback([&](const SessionSnapshot &snapshot) {
+    const MainMenuView next = MainMenuView::from(snapshot, false, false);
+    if (MainMenuView::diff(view, next) != 0)
+      viewChanges++;
+    view = next;
+  });
+  engine.adjustSetDuration(AmustConfig::kOutputMaxMs);
+  engine.start();
+
+  const long before = gAllocations.load();
+  for (long i = 0; i < kTicks - 1; i++) {
+    clock.advance(kNsPerMs);
+    engine.advance();
+  }
+  const long allocations = gAllocations.load() - before;
+
+  std::printf("steady state: %ld ticks, %ld view changes, %ld allocations\n", kTicks - 1,
+              viewChanges, allocations);
+  if (std::strcmp(view.timeText, "0:00") != 0 || view.progressPercent != 99) {
+    std::fprintf(stderr, "steady state: ended at %s, %d%%\n", view.timeText,
+                 view.progressPercent);
+    return false;
+  }
+  return allocations == 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options opt;
+  if (!parseArgs(argc, argv, opt)) {
+    std::fprintf(stderr, "usage: %s [--sessions N] [--seed S] [--verbose]\n", argv[0]);
+    return 2;
+  }
+
+  Totals totals;
+  Simulator sim(opt);
+  const auto begin = std::chrono::steady_clock::now();
+  const bool ok = sim.run(totals);
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+  std::printf("%s: %ld sessions in %.3f s (%.0f sessions/s)\n", ok ? "ok" : "FAILED",
+              opt.sessions, seconds, opt.sessions / std::max(seconds, 1e-9));
+  std::printf("  completed %ld, stopped %ld, interlocked %ld, stale reports %ld; "
+              "%ld operator actions\n",
+              totals.completed, totals.stopped, totals.interlocked, totals.stale, totals.actions);
+  std::printf("  %ld deadline wakeups, %ld snapshot changes, %ld commands refused\n",
+              totals.wakeups, totals.changes, totals.refused);
+  if (!ok)
+    return 1;
+  return checkSteadyState() ? 0 : 1;
+}